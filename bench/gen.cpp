@@ -0,0 +1,39 @@
+#include "generator.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using std::cout, std::cerr, std::endl;
+
+
+int main(int argc, char *argv[]) {
+    bool drawing = argc > 1 && std::string(argv[argc - 1]) == "--drawing";
+    if (drawing)
+        argc--;
+
+    if (argc != 3 && argc != 4) {
+        cerr << "Usage: " << argv[0] << " <kind> <size> [seed] [--drawing]\n"
+            "kinds: ripple, cla, mult (bits), dag, chain, fanout (units), "
+            "latch (latches), pipeline (stages)\n"
+            "--drawing: with shapes, paths and positions to draw" << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    std::ios_base::sync_with_stdio(false);
+
+    Generator gen { cout, argc == 4 ? (unsigned) std::stoul(argv[3]) : 1,
+                    drawing };
+
+    try {
+        gen.generate(argv[1], std::stoul(argv[2]));
+    } catch (std::invalid_argument &) {
+        cerr << "Unknown design kind: " << argv[1] << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/**
+ * @file generator.hpp
+ * @brief Synthetic netlist generator for benchmarks.
+ */
+
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+
+#include <cstddef>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+/** @brief Writes statements of a synthetic design into a stream. */
+class Generator {
+public:
+    /** @brief Generator writing into `os_`, with the `_shape`, `_path` and
+     * `_pos` a visualizer draws if `drawing_`. */
+    Generator(std::ostream &os_, unsigned seed, bool drawing_ = false)
+        : os { os_ }, rng { seed }, drawing { drawing_ } {
+        static const char *luts[] = {
+            "lut<1, 1> buf1 = (0b10)", "lut<1, 1> not1 = (0b01)",
+            "lut<2, 1> and2 = (0b1000)", "lut<2, 1> or2 = (0b1110)",
+            "lut<2, 1> xor2 = (0b0110)", "lut<2, 1> nand2 = (0b0111)",
+            "lut<2, 1> nor2 = (0b0001)", "reg<1, 1> dff = (0b10)",
+        };
+
+        for (const char *lut : luts) {
+            os << lut;
+
+            if (drawing)
+                os << " { _shape: [(0, 0), (10, 0), (10, 10), (0, 10), "
+                      "(0, 0)], _input: " <<
+                    (lut[4] == '1' ? "[(0, 5)]" : "[(0, 2), (0, 8)]") <<
+                    ", _output: [(10, 5)] }";
+
+            os << ";\n";
+        }
+
+        os << "\n";
+    }
+
+    /** @brief Declares a primary input. */
+    std::string input(bool state = false) {
+        std::string name = "in" + std::to_string(input_count++);
+        declare(name, state);
+
+        return name;
+    }
+
+    /** @brief Declares an internal wire. */
+    std::string wire(bool state = false) {
+        std::string name = "n" + std::to_string(wire_count++);
+        declare(name, state);
+
+        return name;
+    }
+
+    /** @brief Declares a unit driving a new wire, and returns the wire. */
+    std::string gate(const char *lut, const std::string &a) {
+        std::string out = wire();
+        unit(lut, a, out);
+
+        return out;
+    }
+
+    std::string gate(const char *lut,
+                     const std::string &a, const std::string &b) {
+        std::string out = wire();
+        unit(lut, a, b, out);
+
+        return out;
+    }
+
+    /** @brief Declares a unit driving an existing wire. */
+    void unit(const char *lut, const std::string &a, const std::string &out) {
+        os << "unit<" << lut << "> u" << unit_count << " = (" << a <<
+            ") -> (" << out << ")";
+        place();
+    }
+
+    /** @brief Declares a two-input unit driving an existing wire. */
+    void unit(const char *lut, const std::string &a, const std::string &b,
+              const std::string &out) {
+        os << "unit<" << lut << "> u" << unit_count << " = (" << a << ", " <<
+            b << ") -> (" << out << ")";
+        place();
+    }
+
+    /** @brief Full adder, returns sum and carry. */
+    std::pair<std::string, std::string> full_adder(const std::string &a,
+                                                   const std::string &b,
+                                                   const std::string &c) {
+        auto x = gate("xor2", a, b);
+        auto sum = gate("xor2", x, c);
+        auto carry = gate("or2", gate("and2", a, b), gate("and2", x, c));
+
+        return { sum, carry };
+    }
+
+    void ripple_adder(size_t bits) {
+        std::vector<std::string> a, b;
+        for (size_t i = 0; i < bits; i++) {
+            a.push_back(input());
+            b.push_back(input());
+        }
+
+        std::string carry = input();
+        for (size_t i = 0; i < bits; i++)
+            carry = full_adder(a[i], b[i], carry).second;
+    }
+
+    /** @brief Kogge-Stone parallel prefix (carry-lookahead) adder. */
+    void lookahead_adder(size_t bits) {
+        std::vector<std::string> g, p, p0;
+        for (size_t i = 0; i < bits; i++) {
+            auto a = input(), b = input();
+
+            g.push_back(gate("and2", a, b));
+            p.push_back(gate("xor2", a, b));
+        }
+        p0 = p;
+
+        for (size_t d = 1; d < bits; d *= 2) {
+            auto g_ = g, p_ = p;
+
+            for (size_t i = d; i < bits; i++) {
+                g_[i] = gate("or2", g[i], gate("and2", p[i], g[i - d]));
+                p_[i] = gate("and2", p[i], p[i - d]);
+            }
+
+            g = std::move(g_);
+            p = std::move(p_);
+        }
+
+        for (size_t i = 1; i < bits; i++)
+            gate("xor2", p0[i], g[i - 1]);
+    }
+
+    void array_multiplier(size_t bits) {
+        std::vector<std::string> a, b;
+        for (size_t i = 0; i < bits; i++) {
+            a.push_back(input());
+            b.push_back(input());
+        }
+
+        std::string zero = wire();
+
+        std::vector<std::string> acc;
+        for (size_t j = 0; j < bits; j++)
+            acc.push_back(gate("and2", a[j], b[0]));
+
+        for (size_t i = 1; i < bits; i++) {
+            std::string carry = zero;
+
+            for (size_t j = 0; j < bits; j++) {
+                auto pp = gate("and2", a[j], b[i]);
+                size_t k = i + j;
+
+                if (k >= acc.size())
+                    acc.push_back(zero);
+
+                auto [sum, carry_] = full_adder(acc[k], pp, carry);
+                acc[k] = sum;
+                carry = carry_;
+            }
+
+            acc.push_back(carry);
+        }
+    }
+
+    void random_dag(size_t units) {
+        const char *luts[] = { "and2", "or2", "xor2", "nand2", "nor2" };
+
+        std::vector<std::string> pool;
+        for (size_t i = 0; i < std::max<size_t>(16, units / 100); i++)
+            pool.push_back(input(rng() & 1));
+
+        /* most inputs are picked close to the output, like placed logic */
+        auto pick = [&]() -> const std::string & {
+            size_t window = std::min<size_t>(64, pool.size());
+
+            if (rng() % 5)
+                return pool[pool.size() - 1 - rng() % window];
+
+            return pool[rng() % pool.size()];
+        };
+
+        for (size_t i = 0; i < units; i++) {
+            auto &a = pick();
+            auto &b = pick();
+
+            pool.push_back(gate(luts[rng() % 5], a, b));
+        }
+    }
+
+    void deep_chain(size_t units) {
+        std::string w = input();
+
+        for (size_t i = 0; i < units; i++)
+            w = gate("not1", w);
+    }
+
+    void high_fanout(size_t units) {
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < 8; i++)
+            roots.push_back(input());
+
+        for (size_t i = 0; i < units; i++)
+            gate("and2", roots[i % 8], roots[(i / 8 + 1 + i) % 8]);
+    }
+
+    /** @brief Cross-coupled nand2 latches, set by an input, reset by its
+     * inverse. */
+    void latch_array(size_t latches) {
+        for (size_t i = 0; i < latches; i++) {
+            auto d = input(true);
+            auto d_ = gate("not1", d);
+
+            auto q = wire(false), q_ = wire(true);
+
+            unit("nand2", d, q_, q);
+            unit("nand2", d_, q, q_);
+        }
+    }
+
+    /** @brief 16-bit registered pipeline, its last stage is fed back into
+     * the first. */
+    void pipeline(size_t stages) {
+        const size_t width = 16;
+
+        std::vector<std::string> in;
+        for (size_t i = 0; i < width; i++)
+            in.push_back(input(rng() & 1));
+
+        std::vector<std::vector<std::string>> q(stages);
+        for (auto &stage : q)
+            for (size_t i = 0; i < width; i++)
+                stage.push_back(wire());
+
+        for (size_t s = 0; s < stages; s++) {
+            std::vector<std::string> prev;
+
+            for (size_t i = 0; i < width; i++)
+                prev.push_back(s ? q[s - 1][i]
+                                 : gate("xor2", in[i], q.back()[i]));
+
+            for (size_t i = 0; i < width; i++) {
+                auto d = gate("xor2", prev[i], gate("and2",
+                                                    prev[(i + 1) % width],
+                                                    prev[(i + 2) % width]));
+
+                unit("dff", d, q[s][i]);
+            }
+        }
+    }
+
+    /** @brief Generates a design by kind name. */
+    void generate(const std::string &kind, size_t size) {
+        if (kind == "ripple")
+            ripple_adder(size);
+        else if (kind == "cla")
+            lookahead_adder(size);
+        else if (kind == "mult")
+            array_multiplier(size);
+        else if (kind == "dag")
+            random_dag(size);
+        else if (kind == "chain")
+            deep_chain(size);
+        else if (kind == "fanout")
+            high_fanout(size);
+        else if (kind == "latch")
+            latch_array(size);
+        else if (kind == "pipeline")
+            pipeline(size);
+        else
+            throw std::invalid_argument("unknown design kind");
+    }
+
+    size_t input_count {};
+    size_t wire_count {};
+    size_t unit_count {};
+
+private:
+    void declare(const std::string &name, bool state) {
+        os << "wire " << name << " = " << state;
+
+        /* a short horizontal path on a grid, by order of declaration */
+        if (drawing) {
+            size_t i = input_count + wire_count;
+            size_t x = i % 1024 * 20, y = i / 1024 * 20;
+
+            os << " { _path: [(" << x << ", " << y << "), (" << x + 4 <<
+                ", " << y << "), (" << x + 4 << ", " << y + 8 << ")] }";
+        }
+
+        os << ";\n";
+    }
+
+    /* ends the statement of the next unit */
+    void place() {
+        if (drawing)
+            os << " { _pos: (" << unit_count % 1024 * 20 + 6 << ", " <<
+                unit_count / 1024 * 20 << ") }";
+
+        os << ";\n";
+        unit_count++;
+    }
+
+    std::ostream &os;
+
+    std::mt19937 rng;
+
+    bool drawing;
+};
+
+
+#endif
@@ -0,0 +1,136 @@
+#include "generator.hpp"
+
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::cout, std::cerr, std::endl;
+using std::string, std::stringstream;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+
+/* simulates a design for a fixed number of rounds, with wires and units laid
+ * out by connectivity or by identifier, for `perf stat` to count cache misses
+ * of one layout against the other */
+int main(int argc, char *argv[]) {
+    size_t rounds = 1000;
+    bool renumber = true;
+    bool shuffled = false;
+
+    int arg = 3;
+    for (; arg < argc; arg++) {
+        string opt = argv[arg];
+
+        if (opt == "--identifier-order")
+            renumber = false;
+        else if (opt == "--shuffled")
+            shuffled = true;
+        else if (arg == 3 && opt[0] != '-')
+            rounds = std::stoul(opt);
+        else
+            break;
+    }
+
+    if (argc < 3 || arg != argc) {
+        cerr << "Usage: " << argv[0] << " <kind> <size> [rounds]"
+            " [--identifier-order] [--shuffled]" << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    string kind = argv[1];
+    size_t size = std::stoul(argv[2]);
+
+    stringstream src;
+    try {
+        Generator { src, 1 }.generate(kind, size);
+    } catch (std::invalid_argument &) {
+        cerr << "Unknown design kind: " << kind << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    /* statements of each kind in random order, as written by tools that do
+     * not follow connectivity */
+    if (shuffled) {
+        vector<string> luts, wires, units;
+        string line;
+
+        while (std::getline(src, line)) {
+            if (line.starts_with("wire"))
+                wires.push_back(line);
+            else if (line.starts_with("unit"))
+                units.push_back(line);
+            else
+                luts.push_back(line);
+        }
+
+        std::mt19937 rng { 2 };
+        std::shuffle(wires.begin(), wires.end(), rng);
+        std::shuffle(units.begin(), units.end(), rng);
+
+        stringstream out;
+        for (auto *lines : { &luts, &wires, &units })
+            for (auto &it : *lines)
+                out << it << "\n";
+
+        src.str(out.str());
+        src.clear();
+    }
+
+    Lex lex { src };
+    Interpreter intr { global_cfg()->new_parser() };
+    Parser parser { intr, lex };
+
+    while (parser.next() != Parsed::END)
+        ;
+
+    std::set<WireId> driven;
+    for (auto &[_, unit] : intr.get_units())
+        driven.insert(unit.output_wires.begin(), unit.output_wires.end());
+
+    vector<WireId> inputs;
+    for (auto &[id, _] : intr.get_wires())
+        if (!driven.contains(id))
+            inputs.push_back(id);
+
+    Simulation sim { intr };
+    sim.set_renumbering(renumber);
+
+    /* flips random inputs, the same ones in both layouts */
+    std::mt19937 rng { 1 };
+    auto start = Clock::now();
+
+    for (size_t r = 0; r < rounds; r++) {
+        vector<Stimulus> stimuli;
+
+        for (size_t i = 0; i < std::max<size_t>(1, inputs.size() / 8); i++) {
+            WireId id = inputs[rng() % inputs.size()];
+
+            stimuli.emplace_back(id, !intr.get_wires().at(id).state);
+        }
+
+        sim.apply(stimuli);
+    }
+
+    double s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    cout << kind << " " << (renumber ? "connectivity" : "identifier") <<
+        ": " << sim.evaluation_count() << " evaluations, " <<
+        sim.evaluation_count() / s << "/s" << endl;
+
+    return EXIT_SUCCESS;
+}
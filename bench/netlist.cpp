@@ -0,0 +1,393 @@
+#include "generator.hpp"
+
+#include "../include/fourstate.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/optimize.hpp"
+#include "../include/parser.hpp"
+#include "../include/grammar.hpp"
+#include "../include/rdesc.hpp"
+#include "../include/lex.hpp"
+
+#include <rdesc/rdesc.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string, std::stringstream;
+using std::vector, std::set;
+using std::cout, std::cerr, std::endl;
+
+using Clock = std::chrono::steady_clock;
+
+
+/** @brief A design in the suite, and how its size grows with scale. */
+struct Design {
+    const char *kind;
+    size_t size;
+    bool quadratic /**< number of units grows with square of size */;
+    bool clocked /**< also measured cycle-based */;
+};
+
+static const Design suite[] = {
+    { "ripple", 4096, false, false },
+    { "cla", 2048, false, false },
+    { "mult", 48, true, false },
+    { "dag", 100000, false, false },
+    { "chain", 100000, false, false },
+    { "fanout", 100000, false, false },
+    { "latch", 30000, false, false },
+    { "pipeline", 8, false, true },
+};
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static size_t scaled(const Design &design, double scale) {
+    return design.quadratic ? design.size * std::sqrt(scale)
+                            : design.size * scale;
+}
+
+/* runs one design, returns its results as fields of a JSON object */
+static string run(const Design &design, double scale) {
+    size_t size = scaled(design, scale);
+
+    stringstream src;
+    Generator gen { src, 1 };
+    gen.generate(design.kind, size);
+
+    string text = src.str();
+
+    /* lexing only */
+    auto start = Clock::now();
+    {
+        stringstream ss { text };
+        Lex lex { ss };
+
+        struct rdesc_cfg_token tk;
+        while ((tk = lex.next()).id != TK_EOF)
+            tk_destroyer(&tk);
+    }
+    double lex_s = seconds_since(start);
+
+    /* lexing and parsing into concrete syntax trees */
+    size_t stmts = 0;
+    start = Clock::now();
+    {
+        stringstream ss { text };
+        Lex lex { ss };
+        Rdesc parser = global_cfg()->new_parser();
+        parser.start(NT_STMT);
+
+        struct rdesc_cfg_token tk;
+        while ((tk = lex.next()).id != TK_EOF) {
+            struct rdesc_node *cst = NULL;
+
+            if (parser.pump(&cst, &tk) == RDESC_READY) {
+                rdesc_node_destroy(cst, tk_destroyer);
+                parser.start(NT_STMT);
+                stmts++;
+            }
+        }
+    }
+    double parse_s = seconds_since(start);
+
+    /* full load */
+    stringstream ss { text };
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+
+    start = Clock::now();
+    struct rdesc_cfg_token tk;
+    while ((tk = lex.next()).id != TK_EOF)
+        intr.pump(tk);
+    double load_s = seconds_since(start);
+
+    /* full load, without concrete syntax trees */
+    start = Clock::now();
+    {
+        stringstream direct_ss { text };
+        Lex direct_lex { direct_ss };
+        Interpreter direct { global_cfg()->new_parser() };
+        Parser parser { direct, direct_lex };
+
+        while (parser.next() != Parsed::END)
+            ;
+    }
+    double direct_load_s = seconds_since(start);
+
+    /* writing the netlist back */
+    start = Clock::now();
+    size_t dump_bytes;
+    {
+        stringstream out;
+        intr.dump(out, lex);
+        dump_bytes = out.str().size();
+    }
+    double dump_s = seconds_since(start);
+
+    /* primary inputs are wires no unit drives */
+    set<WireId> driven;
+    for (auto &it : intr.get_units())
+        driven.insert(it.second.output_wires.begin(),
+                      it.second.output_wires.end());
+
+    vector<WireId> inputs;
+    for (auto &it : intr.get_wires())
+        if (!driven.contains(it.first))
+            inputs.push_back(it.first);
+
+    /* flips random inputs, the same ones on every call */
+    auto simulate = [&](Simulation &sim, size_t max_rounds, double max_s) {
+        std::mt19937 rng { 1 };
+        size_t rounds = 0;
+
+        auto start = Clock::now();
+        while (seconds_since(start) < max_s && rounds < max_rounds) {
+            vector<Stimulus> stimuli;
+
+            for (size_t i = 0; i < std::max<size_t>(1, inputs.size() / 8); i++) {
+                WireId id = inputs[rng() % inputs.size()];
+
+                stimuli.emplace_back(id, !intr.get_wires().at(id).state);
+            }
+
+            sim.apply(stimuli);
+            rounds++;
+        }
+
+        return rounds;
+    };
+
+    Simulation sim { intr };
+
+    start = Clock::now();
+    size_t rounds = simulate(sim, 100000, 1.0);
+    double sim_s = seconds_since(start);
+    uint64_t sim_evals = sim.evaluation_count();
+
+    uint64_t cycles = 0;
+    double cycles_s = 0;
+    double cycles_4_s = 0;
+
+    if (design.clocked) {
+        start = Clock::now();
+
+        while (seconds_since(start) < 1.0) {
+            sim.run_cycles(10000);
+            cycles += 10000;
+        }
+
+        cycles_s = cycles / seconds_since(start);
+
+        /* same states as two-state mode, not a run of unknowns */
+        FourState fs { intr, true };
+        cycles = 0;
+        start = Clock::now();
+
+        while (seconds_since(start) < 1.0) {
+            fs.run_cycles(10000);
+            cycles += 10000;
+        }
+
+        cycles_4_s = cycles / seconds_since(start);
+    }
+
+    /* the same rounds again, once dead logic is removed and chains merged */
+    OptReport opt = Optimizer { intr, lex }.run();
+    Simulation opt_sim { intr };
+
+    start = Clock::now();
+    simulate(opt_sim, rounds, INFINITY);
+    double opt_s = seconds_since(start);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    stringstream json;
+    json << "\"design\": \"" << design.kind << "\", \"size\": " << size <<
+        ", \"units\": " << opt.units_before <<
+        ", \"wires\": " << opt.wires_before <<
+        ", \"bytes\": " << text.size() <<
+        ", \"lex_mb_s\": " << text.size() / lex_s / 1e6 <<
+        ", \"parse_stmt_s\": " << stmts / parse_s <<
+        ", \"interpret_s\": " << std::max(0.0, load_s - parse_s) <<
+        ", \"load_s\": " << load_s <<
+        ", \"direct_load_s\": " << direct_load_s <<
+        ", \"dump_mb_s\": " << dump_bytes / dump_s / 1e6 <<
+        ", \"peak_rss_kb\": " << usage.ru_maxrss <<
+        ", \"sim_rounds\": " << rounds <<
+        ", \"sim_evals\": " << sim_evals <<
+        ", \"sim_evals_s\": " << sim_evals / sim_s <<
+        ", \"cycles_s\": " << cycles_s <<
+        ", \"cycles_4_s\": " << cycles_4_s <<
+        ", \"opt_units_removed\": " << opt.units_before - opt.units_after <<
+        ", \"opt_speedup\": " << sim_s / opt_s;
+
+    return json.str();
+}
+
+/* loads the design with drawing metadata, as a window would or with it
+ * stripped as a headless run does, and returns load time and peak RSS */
+static string run_load(const Design &design, double scale, bool strip) {
+    string text;
+    {
+        stringstream src;
+        Generator { src, 1, true }.generate(design.kind,
+                                            scaled(design, scale));
+        text = src.str();
+    }
+
+    stringstream ss { text };
+    auto lex = std::make_shared<Lex>(ss);
+    Interpreter intr { global_cfg()->new_parser() };
+
+    if (strip)
+        intr.strip_metadata(lex);
+
+    auto start = Clock::now();
+    {
+        Parser parser { intr, *lex };
+
+        while (parser.next() != Parsed::END)
+            ;
+    }
+    double load_s = seconds_since(start);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    const char *mode = strip ? "stripped" : "drawn";
+
+    stringstream json;
+    json << ", \"" << mode << "_bytes\": " << text.size() <<
+        ", \"" << mode << "_load_s\": " << load_s <<
+        ", \"" << mode << "_rss_kb\": " << usage.ru_maxrss;
+
+    return json.str();
+}
+
+/* loads a lut of `inputs` inputs from a literal of random decimal or hex
+ * digits, and returns the time it takes */
+static double run_literal(size_t inputs, bool decimal) {
+    size_t bits = size_t { 1 } << inputs;
+    size_t digits = decimal ? bits * std::log10(2.0) : bits / 4;
+
+    std::mt19937 rng { 1 };
+    string text = "lut<" + std::to_string(inputs) + ", 1> w = (" +
+        (decimal ? "" : "0x");
+    for (size_t i = 0; i < digits; i++)
+        text += "0123456789abcdef"[rng() % (decimal ? 10 : 16)];
+    text += ");";
+
+    stringstream ss { text };
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+
+    auto start = Clock::now();
+    {
+        Parser parser { intr, lex };
+
+        while (parser.next() != Parsed::END)
+            ;
+    }
+
+    return seconds_since(start);
+}
+
+/* each measurement runs in its own process, so that peak RSS is its own */
+template<typename F>
+static bool run_isolated(F &&measure, string &out) {
+    int fds[2];
+    if (pipe(fds) == -1)
+        return false;
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        close(fds[0]);
+
+        string res = measure();
+        if (write(fds[1], res.data(), res.size()) != (ssize_t) res.size())
+            _exit(EXIT_FAILURE);
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+
+    char buf[4096];
+    ssize_t len;
+    while ((len = read(fds[0], buf, sizeof(buf))) > 0)
+        out.append(buf, len);
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    return pid != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        cerr << "Usage: " << argv[0] << " <output.json> [scale] [commit]"
+            << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    double scale = argc > 2 ? std::stod(argv[2]) : 1;
+    string commit = argc > 3 ? argv[3] : "";
+
+    std::ofstream out { argv[1] };
+    /* truth tables as wide as a 20-input lut, from decimal and hex */
+    double decimal_s = run_literal(20, true), hex_s = run_literal(20, false);
+    cout << "wide lut: " << decimal_s << " s decimal, " << hex_s << " s hex" <<
+        endl;
+
+    out << "{\n  \"commit\": \"" << commit << "\",\n  \"scale\": " << scale <<
+        ",\n  \"wide_lut_decimal_s\": " << decimal_s <<
+        ",\n  \"wide_lut_hex_s\": " << hex_s <<
+        ",\n  \"results\": [";
+
+    bool first = true;
+    for (auto &design : suite) {
+        string res;
+
+        cout << design.kind << ": " << std::flush;
+
+        if (!run_isolated([&]() { return run(design, scale); }, res) ||
+            !run_isolated([&]() { return run_load(design, scale, false); },
+                          res) ||
+            !run_isolated([&]() { return run_load(design, scale, true); },
+                          res)) {
+            cout << "FAIL" << endl;
+
+            return EXIT_FAILURE;
+        }
+
+        res = "{ " + res + " }";
+        cout << res << endl;
+
+        out << (first ? "\n    " : ",\n    ") << res;
+        first = false;
+    }
+
+    out << "\n  ]\n}\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#include "generator.hpp"
+
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/parser.hpp"
+#include "../include/partition.hpp"
+#include "../include/placement.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::cout, std::cerr, std::endl;
+using std::string, std::stringstream;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+
+static void load(Interpreter &intr, const string &source) {
+    stringstream ss { source };
+    Lex lex { ss };
+    Parser parser { intr, lex };
+
+    while (parser.next() != Parsed::END)
+        ;
+}
+
+/* writes megabytes resident on every node, and in huge pages */
+static void dump_memory(const MemoryReport &memory) {
+    for (size_t node = 0; node < memory.node_bytes.size(); node++)
+        cout << " node" << node << " " << (memory.node_bytes[node] >> 20) <<
+            " MiB,";
+
+    cout << " huge pages " << (memory.huge_page_bytes >> 20) << " MiB\n";
+}
+
+/* applies the same random patterns to a design in one process and split into
+ * parts, and reports throughput, memory of every node, and whether states
+ * end the same */
+int main(int argc, char *argv[]) {
+    size_t patterns = 100;
+    size_t parts = 4;
+    Pinning pinning = Pinning::NONE;
+
+    int arg = 3;
+    for (; arg < argc; arg++) {
+        string opt = argv[arg];
+
+        if (opt == "--partitions" && arg + 1 < argc)
+            parts = std::stoul(argv[++arg]);
+        else if (opt == "--pin-compact")
+            pinning = Pinning::COMPACT;
+        else if (opt == "--pin-scatter")
+            pinning = Pinning::SCATTER;
+        else if (opt == "--no-huge-pages")
+            set_huge_pages(HugePages::NONE);
+        else if (opt == "--explicit-huge-pages")
+            set_huge_pages(HugePages::EXPLICIT);
+        else if (arg == 3 && opt[0] != '-')
+            patterns = std::stoul(opt);
+        else
+            break;
+    }
+
+    if (argc < 3 || arg != argc) {
+        cerr << "Usage: " << argv[0] << " <kind> <size> [patterns]"
+            " [--partitions <n>] [--pin-compact | --pin-scatter]"
+            " [--no-huge-pages | --explicit-huge-pages]" << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    string kind = argv[1];
+    stringstream src;
+
+    try {
+        Generator { src, 1 }.generate(kind, std::stoul(argv[2]));
+    } catch (std::invalid_argument &) {
+        cerr << "Unknown design kind: " << kind << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    Interpreter single { global_cfg()->new_parser() };
+    Interpreter split { global_cfg()->new_parser() };
+    load(single, src.str());
+    load(split, src.str());
+
+    /* units agree with their inputs, as states would not end the same
+     * otherwise */
+    bool loop = false;
+    try {
+        Simulation { single }.run_cycles(0);
+        Simulation { split }.run_cycles(0);
+    } catch (std::invalid_argument &) {
+        loop = true;
+    }
+
+    std::set<WireId> driven;
+    for (auto &[_, unit] : single.get_units())
+        driven.insert(unit.output_wires.begin(), unit.output_wires.end());
+
+    vector<WireId> inputs;
+    for (auto &[id, _] : single.get_wires())
+        if (!driven.contains(id))
+            inputs.push_back(id);
+
+    std::mt19937 rng { 1 };
+    vector<Pattern> set(patterns);
+
+    for (auto &pattern : set)
+        for (size_t i = 0; i < std::max<size_t>(1, inputs.size() / 8); i++)
+            pattern.emplace_back(inputs[rng() % inputs.size()], rng() & 1);
+
+    Topology topology;
+    auto start = Clock::now();
+
+    Simulation sim { single };
+    {
+        ScopedPin pin { topology.cpu_for(0, pinning) };
+
+        for (auto &pattern : set)
+            sim.apply(pattern);
+    }
+
+    auto single_memory = MemoryReport::of_self();
+    auto split_start = Clock::now();
+
+    Partition partition { split.get_wires(), split.get_units(), parts };
+    ParallelSim parallel { split, partition };
+    parallel.set_pinning(pinning);
+    parallel.run(set);
+
+    auto end = Clock::now();
+
+    size_t differ = 0;
+    auto it = split.get_wires().begin();
+    for (auto &[_, wire] : single.get_wires())
+        differ += wire.state != (it++)->second.state;
+
+    auto seconds = [](auto d) {
+        return std::chrono::duration<double>(d).count();
+    };
+
+    double single_s = seconds(split_start - start);
+    double split_s = seconds(end - split_start);
+
+    partition.dump(cout << kind << ": ");
+    cout << kind << ": single " << single_s << " s, " <<
+        sim.evaluation_count() / single_s << " evaluations/s,";
+    dump_memory(single_memory);
+
+    cout << kind << ": " << parts << " parts " << split_s << " s, " <<
+        parallel.evaluation_count() / split_s << " evaluations/s,";
+    dump_memory(parallel.memory());
+
+    cout << kind << ": " << parallel.message_count() << " messages, " <<
+        differ << " wires differ" << (loop ? " (not settled, loops)" : "") <<
+        endl;
+
+    return differ && !loop ? EXIT_FAILURE : EXIT_SUCCESS;
+}
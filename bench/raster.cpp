@@ -0,0 +1,87 @@
+#include "../include/raster.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::cout, std::cerr, std::endl;
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+
+/* rasterizes frames of short wire segments and dots scattered over a screen,
+ * as a large design zoomed out draws them, and reports frames per second */
+int main(int argc, char *argv[]) {
+    size_t frames = 20;
+    size_t threads = 0;
+
+    int arg = 4;
+    for (; arg < argc; arg++) {
+        string opt = argv[arg];
+
+        if (opt == "--threads" && arg + 1 < argc)
+            threads = std::stoul(argv[++arg]);
+        else if (arg == 4 && opt[0] != '-')
+            frames = std::stoul(opt);
+        else
+            break;
+    }
+
+    if (argc < 4 || arg != argc) {
+        cerr << "Usage: " << argv[0] << " <width> <height> <capsules> [frames]"
+            " [--threads <n>]" << endl;
+
+        return EXIT_FAILURE;
+    }
+
+    int width = std::stoi(argv[1]);
+    int height = std::stoi(argv[2]);
+    size_t count = std::stoul(argv[3]);
+
+    std::mt19937 rng { 1 };
+    std::uniform_real_distribution<float> x { 0, float(width) };
+    std::uniform_real_distribution<float> y { 0, float(height) };
+
+    vector<Capsule> capsules;
+    for (size_t i = 0; i < count; i++) {
+        float x0 = x(rng), y0 = y(rng);
+
+        /* every fourth is a dot, the rest horizontal or vertical segments */
+        if (i % 4 == 0)
+            capsules.push_back(Capsule { x0, y0, x0, y0, 5, 0x00ff00 });
+        else if (i % 2)
+            capsules.push_back(Capsule { x0, y0, x0 + 30, y0, 1.5, 0 });
+        else
+            capsules.push_back(Capsule { x0, y0, x0, y0 + 30, 1.5, 0 });
+    }
+
+    vector<uint32_t> pixels(size_t(width) * height);
+    Raster raster { threads };
+
+    auto start = Clock::now();
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        raster.begin(pixels.data(), width, height, width, 0xffffff);
+
+        for (auto &c : capsules)
+            raster.capsule(c.x0, c.y0, c.x1, c.y1, c.radius, c.color);
+
+        raster.end();
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start)
+        .count();
+
+    cout << width << "x" << height << ", " << count << " capsules: " <<
+        seconds / frames * 1e3 << " ms/frame, " <<
+        frames / seconds << " frames/s, " <<
+        count * frames / seconds << " capsules/s" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -8,11 +8,18 @@
 
 #include "Xdraw.hpp"
 #include "interpreter.hpp"
+#include "activity.hpp"
+#include "profile.hpp"
+#include "reload.hpp"
 
 #include <X11/Xlib.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 class Lex /* defined in lex.hpp */;
 
@@ -21,7 +28,13 @@ class App;
 
 Window create_window(App *app);
 
-/** @brief Manages the dedicated event processing thread. */
+/**
+ * @brief Manages the dedicated event processing thread.
+ *
+ * Queued events are drained together: pans and zooms move the view, clicks
+ * on wire tips are collected, and the frame is drawn once afterwards, at most
+ * once per `FRAME_INTERVAL`, with collected toggles applied in one batch.
+ */
 class EvLoop {
 public:
     /** @brief Constructs an event loop associated with a specific App. */
@@ -33,12 +46,31 @@ public:
     /** @brief Spawns the worker thread and begins execution. */
     void start();
 
+    static constexpr std::chrono::milliseconds FRAME_INTERVAL { 16 };
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     /** @brief The entry point for the thread. */
     void run();
 
+    /**
+     * @brief Blocks until an X event is queued or `timeout` milliseconds
+     * pass, -1 to wait for an event, reloading file meanwhile.
+     */
+    void wait_event(int timeout);
+
+    /** @brief Applies an event to the view, or collects its toggles. */
+    void handle(XEvent &ev);
+
     void toggle_wire(int x, int y);
 
+    /** @brief Applies collected toggles, and draws a frame. */
+    void redraw();
+
+    /** @brief Writes frame time, primitives and simulation rate. */
+    void draw_hud();
+
     std::shared_ptr<Interpreter> intr_FOR_RC;
     Simulation sim;
 
@@ -48,9 +80,26 @@ private:
 
     Draw draw;
 
-    std::jthread evloop;
+    HotReload reload;
+
+    std::shared_ptr<Profile> profile;
+    std::shared_ptr<Activity> activity;
 
-    TableKeyId k_path;
+    Atom wm_delete_win {};
+
+    bool quit {};
+    bool ctrl_hold {};
+    bool dirty {} /**< something changed since the last frame */;
+
+    std::vector<Stimulus> toggles /**< collected since the last frame */;
+
+    bool hud;
+
+    Clock::time_point last_frame {};
+    Clock::duration frame_time {} /**< of drawing the last frame */;
+    double evaluation_rate {} /**< of applying the last toggles */;
+
+    std::jthread evloop;
 };
 
 /** @brief Main Application orchestrator and X11 resource manager. */
@@ -66,8 +115,13 @@ private:
     };
 
 public:
-    App(auto intr_, auto lex_) :
-        intr { intr_ }, lex { lex_ },
+    App(auto intr_, auto lex_, std::string path_,
+        std::shared_ptr<Profile> profile_ = nullptr,
+        std::shared_ptr<Activity> activity_ = nullptr,
+        bool raster_ = false, bool hud_ = false) :
+        intr { intr_ }, lex { lex_ }, path { std::move(path_) },
+        profile { profile_ }, activity { activity_ }, raster { raster_ },
+        hud { hud_ },
         dpy { std::shared_ptr<Display>(XOpenDisplay(NULL),
                                        App::DisplayDeleter {}) },
         scr { XDefaultScreenOfDisplay(dpy.get()) },
@@ -89,6 +143,14 @@ private:
     std::shared_ptr<Interpreter> intr;
     std::shared_ptr<Lex> lex;
 
+    std::string path /**< simulation file, watched for changes */;
+
+    std::shared_ptr<Profile> profile /**< null unless profiling */;
+    std::shared_ptr<Activity> activity /**< null unless collecting */;
+
+    bool raster /**< draws with the software rasterizer into shared memory */;
+    bool hud /**< writes frame statistics over the window */;
+
     std::shared_ptr<Display> dpy;
 
     Screen *scr;
@@ -106,7 +168,15 @@ inline EvLoop::EvLoop(App *app)
     : intr_FOR_RC { app->intr }, sim { *app->intr.get() },
       dpy { app->dpy }, win { app->win },
       draw { dpy, app->scr, win, app->intr, app->lex },
-      k_path { app->lex->get_ident_id("_path") } {}
+      reload { app->path, app->intr, app->lex },
+      profile { app->profile }, activity { app->activity },
+      hud { app->hud } {
+    sim.set_profile(profile.get());
+    sim.set_activity(activity.get());
+
+    if (app->raster)
+        draw.use_raster();
+}
 
 
 #endif
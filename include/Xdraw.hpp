@@ -7,12 +7,19 @@
 #define XDRAW_HPP
 
 
+#include "raster.hpp"
 #include "table.hpp"
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
 class EvLoop /* defined in Xapp.hpp */;
 class Interpreter /* defined in interpreter.hpp */;
@@ -23,6 +30,83 @@ class Wire /* defined in core.hpp */;
 class Unit /* defined in core.hpp */;
 
 
+/** @brief Absolute position in simulation coordinates. */
+struct GeoPoint {
+    int x;
+    int y;
+};
+
+/** @brief Polyline spanning a range of compiled points. */
+struct GeoLine {
+    size_t first;
+    size_t count;
+    const bool *state /**< state of the wire, nullptr for unit shapes */;
+};
+
+/** @brief Filled circle at a loose end of a wire path. */
+struct GeoDot {
+    size_t point;
+    const bool *state;
+};
+
+/** @brief Toggleable tip of a wire (first point of its first path). */
+struct GeoTip {
+    size_t point;
+    size_t wire_id;
+};
+
+/**
+ * @brief Image of the window in MIT-SHM shared memory, which the server reads
+ * a whole frame from with a single request.
+ */
+class ShmImage {
+public:
+    ShmImage(Display *dpy_, Screen *scr_)
+        : dpy { dpy_ }, scr { scr_ } {}
+
+    ~ShmImage()
+        { release(); }
+
+    ShmImage(const ShmImage &) = delete;
+    ShmImage &operator=(const ShmImage &) = delete;
+
+    /** @brief Whether the server has the MIT-SHM extension. It may still
+     * fail to attach memory, if it runs on another machine. */
+    static bool supported(Display *dpy);
+
+    /**
+     * @brief Makes the image `width` x `height`. Returns false if the server
+     * cannot attach shared memory, or pixels of the screen are not 32-bit
+     * words in the order of this machine.
+     */
+    bool resize(int width, int height);
+
+    /** @brief Shows the image, and waits until the server has read it. */
+    void put(Window win, GC gc) const;
+
+    uint32_t *pixels() const
+        { return reinterpret_cast<uint32_t *>(image->data); }
+    /** @brief Pixels between the starts of two rows. */
+    size_t stride() const
+        { return image->bytes_per_line / 4; }
+
+    int width() const
+        { return image ? image->width : 0; }
+    int height() const
+        { return image ? image->height : 0; }
+
+private:
+    void release();
+
+    Display *dpy;
+    Screen *scr;
+
+    XShmSegmentInfo info {};
+    XImage *image {};
+
+    bool attached {} /**< by the server */;
+};
+
 /** @brief Draws the simulatoin into X graphics context */
 class Draw {
 public:
@@ -38,13 +122,36 @@ public:
         XAllocColor(dpy.get(), cmap, &inactive_color);
 
         init_key_ids();
+        compile();
     }
 
-    void draw(const Lut &, int x, int y) const;
-    void draw(const Wire &) const;
-    void draw(const Unit &) const;
+    /**
+     * @brief Resolves metadata tables of the netlist into flat geometry.
+     *
+     * Invalid or missing metadata is reported once here, redraws only walk
+     * the compiled arrays.
+     */
+    void compile();
+
+    /**
+     * @brief Draws into shared memory with the software rasterizer from now
+     * on. Returns false, and keeps drawing with Xlib, if the server has no
+     * MIT-SHM.
+     */
+    bool use_raster();
+
+    /** @brief Sets the size of the window, which the rasterizer fills. */
+    void resize(int width_, int height_)
+        { width = width_, height = height_; }
+
+    void redraw();
+
+    /** @brief Primitives of the last frame, as X requests or capsules. */
+    size_t primitive_count() const
+        { return primitives; }
 
-    void redraw() const;
+    /** @brief Writes lines of text over the top left corner of the frame. */
+    void overlay(std::span<const std::string> text);
 
     int scale_x(double x) const
         { return offset_x + x * scale; }
@@ -56,10 +163,21 @@ public:
     double scale { 10 };
 
 private:
+    friend EvLoop;
+
     void init_key_ids();
 
-    /* helper function to draw one path in a wire */
-    void draw(const Wire &, const std::vector<std::unique_ptr<TVPoint>> &) const;
+    void compile(const Lut &, int x, int y);
+    void compile(const Wire &);
+    void compile(const Unit &);
+
+    /* helper function to compile one path in a wire */
+    void compile(const Wire &, std::span<const TablePoint>);
+
+    void redraw_xlib();
+
+    /* false if the image cannot take the size of the window */
+    bool redraw_raster();
 
     std::shared_ptr<Display> dpy;
 
@@ -80,6 +198,23 @@ private:
 
     XColor active_color;
     XColor inactive_color;
+
+    std::vector<GeoPoint> points;
+    std::vector<GeoLine> lines;
+    std::vector<GeoDot> dots;
+    std::vector<GeoTip> tips;
+
+    size_t wire_line_count {} /**< lines before this index belong to wires */;
+
+    std::vector<XPoint> screen_points;
+
+    std::unique_ptr<ShmImage> shm /**< null while drawing with Xlib */;
+    Raster raster;
+
+    int width {};
+    int height {};
+
+    size_t primitives {};
 };
 
 
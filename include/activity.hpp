@@ -0,0 +1,87 @@
+/**
+ * @file activity.hpp
+ * @brief Switching activity of wires, for power estimation.
+ */
+
+#ifndef ACTIVITY_HPP
+#define ACTIVITY_HPP
+
+
+#include "core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/**
+ * @brief Toggle counts and time spent at 1 of every wire, filled by
+ * `Simulation` while attached to it.
+ *
+ * Time is counted in generations of `Simulation::advance`. Counters are dense
+ * arrays indexed by wire identifiers. Time at 1 is kept as times of falls
+ * less times of rises, wrapping around, so that a toggle is two additions
+ * and open intervals are closed by adding the time they are read at.
+ */
+class Activity {
+public:
+    /** @brief Starts counting from current states of `wires` at `now`. */
+    void begin(const std::map<WireId, Wire> &wires, uint64_t now);
+
+    void toggle(WireId id, bool state, uint64_t now) {
+        if (id >= level.size())
+            fit(id);
+
+        toggles[id]++;
+        high_time[id] += state ? -now : now;
+
+        level[id] = state;
+    }
+
+    /**
+     * @brief Counts `count` toggles of a wire at once, the last to `state`,
+     * `sum` being the times of its falls less the times of its rises.
+     */
+    void toggle_sum(WireId id, uint64_t count, uint64_t sum, bool state) {
+        if (id >= level.size())
+            fit(id);
+
+        toggles[id] += count;
+        high_time[id] += sum;
+
+        level[id] = state;
+    }
+
+    /** @brief Ends counting, at `now`. */
+    void finish(uint64_t now)
+        { stop = now; }
+
+    /** @brief Time at 1 of each wire up to `now`, including open intervals. */
+    std::vector<uint64_t> time_at_1(uint64_t now) const;
+
+    /**
+     * @brief Writes activity between `start` and `stop` in SAIF form, nets
+     * keyed by `Lex::ident_name`, with a generation as time unit.
+     */
+    std::ostream &dump_saif(std::ostream &os, const Lex &lex) const;
+
+    uint64_t start {};
+    uint64_t stop {};
+
+    std::vector<WireId> wire_ids /**< wires present since `begin` */;
+
+    /* indexed by wire identifiers */
+    std::vector<uint64_t> toggles;
+    std::vector<uint64_t> high_time /**< falls less rises */;
+    std::vector<uint8_t> level;
+
+private:
+    void fit(WireId id);
+};
+
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file bdd.hpp
+ * @brief Decision diagrams of wide truth tables.
+ */
+
+#ifndef BDD_HPP
+#define BDD_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+/**
+ * @brief Truth tables of the outputs of a lut as one reduced ordered decision
+ * diagram, whose terminals are words holding the table of the 6 least
+ * significant inputs.
+ *
+ * Equal subtables share a node, across outputs too. A lookup splits the
+ * input index once into a word index and a bit, then takes one step per
+ * level, at most `input_size - 6` of them, each selecting a child by a bit of
+ * the word index without a branch. Nodes are numbered in depth-first order
+ * from the roots, so that children mostly follow their parents in the array;
+ * a node shared with an earlier output is behind.
+ */
+class Bdd {
+public:
+    Bdd() = default;
+
+    /** @brief Diagram of packed truth tables, `word_count` words for each
+     * output in order, `word_count` being a power of two. */
+    Bdd(std::span<const uint64_t> words, size_t word_count, size_t output_size);
+
+    bool empty() const
+        { return roots.empty(); }
+
+    /** @brief Word `w` of the truth table of an output, as packed. */
+    uint64_t word(size_t output, size_t w) const {
+        uint32_t ref = roots[output];
+
+        while (!(ref & LEAF)) {
+            const Node &node = nodes[ref];
+            ref = node.next[(w >> node.var) & 1];
+        }
+
+        return leaves[ref & ~LEAF];
+    }
+
+    bool lookup(size_t input_index, size_t output) const
+        { return (word(output, input_index / 64) >> (input_index % 64)) & 1; }
+
+    size_t node_count() const
+        { return nodes.size(); }
+
+    size_t bytes() const {
+        return nodes.size() * sizeof(Node) + leaves.size() * sizeof(uint64_t) +
+            roots.size() * sizeof(uint32_t);
+    }
+
+private:
+    /* tags references to `leaves` */
+    static constexpr uint32_t LEAF = UINT32_C(1) << 31;
+
+    struct Node {
+        uint32_t var /**< bit of word index tested */;
+        uint32_t next[2] /**< children where the bit is 0 and 1 */;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint64_t> leaves;
+    std::vector<uint32_t> roots /**< of every output */;
+};
+
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file bytecode.hpp
+ * @brief Netlist compiled into threaded code for event-driven simulation.
+ */
+
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+
+#include "core.hpp"
+#include "placement.hpp"
+#include "renumber.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <utility>
+#include <vector>
+
+class Activity /* defined in activity.hpp */;
+class Profile /* defined in profile.hpp */;
+
+
+/**
+ * @brief Combinational units compiled into direct-threaded code, run the same
+ * way as `Simulation::advance` until no wire changes.
+ *
+ * The code of a unit loads its inputs from wire states into an
+ * index, then for every output looks the index up, compares it with the
+ * state of its wire, and stores it and schedules the wire if they differ. A
+ * scheduled wire schedules the units it affects in the next generation,
+ * through fan-out lists of dense unit indices. Instructions are addresses of
+ * labels in the dispatch loop, which jumps to the next one with a computed
+ * goto, a GNU extension.
+ *
+ * Wire states are copied into bytes in the order of a `Renumbering`, and
+ * code of units is laid out in that order, so that units evaluated together
+ * and the wires they read are close in memory. Wires toggled are written
+ * back to the interpreter after each generation, and the code is compiled
+ * again once objects are added or removed.
+ *
+ * While counting, wires toggled in every generation are logged in order,
+ * which only copies the list of them, and evaluations are tallied by index.
+ * Once a run ends or the log grows long, it is walked back from the states
+ * wires ended in into tallies by index, and tallies are added to a `Profile`
+ * and an `Activity` by identifier, so that a wire toggling many times in a
+ * run is translated once.
+ */
+class Bytecode {
+public:
+    Bytecode(const std::map<LutId, Lut> &luts,
+             std::map<WireId, Wire> &wires,
+             const std::map<UnitId, Unit> &units,
+             uint64_t revision_, bool renumber = true);
+
+    struct Run {
+        uint64_t generations;
+        uint64_t evaluations;
+    };
+
+    /** @brief Where a run counts, either may be null. */
+    struct Counters {
+        Profile *profile;
+        Activity *activity;
+        uint64_t now /**< generation before the first one of the run */;
+    };
+
+    /**
+     * @brief Evaluates units affected by `changed` wires, generation after
+     * generation until no wire changes.
+     *
+     * Original states of wires toggled are appended to `record` if it is not
+     * null, and marked in `recorded`, by identifier, unless already marked.
+     * Toggles and evaluations are counted into `counters`, as
+     * `Simulation::advance` counts them.
+     */
+    Run stabilize(std::span<const WireId> changed,
+                  std::vector<std::pair<WireId, bool>> *record,
+                  std::vector<bool> &recorded,
+                  const Counters &counters_ = {});
+
+    /**
+     * @brief Sets a wire to `state`, so that the next `step` evaluates units
+     * it affects if it toggles. Throws `std::out_of_range` on unknown wires.
+     */
+    void apply(WireId id, bool state);
+
+    /**
+     * @brief Evaluates one generation, units affected by wires changed since
+     * the last one, and returns how many.
+     */
+    size_t step();
+
+    /** @brief Whether no wire changed since the last `step`. */
+    bool settled() const
+        { return changed_wires.empty(); }
+
+    /** @brief Appends wires toggled by the last `step`, with their new
+     * states. */
+    void toggled(std::vector<std::pair<WireId, bool>> &out) const;
+
+    /** @brief Copies every wire state again, once they are written other
+     * than through `set`. */
+    void load();
+
+    /** @brief Packs wire states into words, a bit per wire in identifier
+     * order. */
+    void pack(std::vector<uint64_t> &words) const;
+
+    /**
+     * @brief Sets wire states to words `pack` returned, a word at a time,
+     * writing back to the interpreter only wires that differ.
+     */
+    void unpack(std::span<const uint64_t> words);
+
+    /** @brief Copies the new state of a wire. */
+    void set(WireId id, bool state)
+        { values[numbering.wire(id)] = state; }
+
+    size_t code_size() const
+        { return code.size(); }
+
+    const uint64_t revision /**< of the interpreter it is built from */;
+
+private:
+    /* an instruction, or one of its operands */
+    union Slot {
+        const void *op;
+        const Lut *lut;
+        uint64_t word /**< truth table of a lut with up to 6 inputs */;
+        uint32_t num;
+    };
+
+    enum Op { FIRST, LOAD, STORE, STORE_WIDE, NEXT, OP_COUNT };
+
+    /* runs the code of `batch` units in order, or only returns addresses of
+     * instructions if `batch` is null */
+    const void *const *execute(const uint32_t *batch, size_t size);
+
+    void schedule(uint32_t wire);
+
+    /* counts since the last `flush` */
+    struct WireTally {
+        uint64_t toggles;
+        uint64_t sum /**< times of falls less times of rises */;
+        bool end /**< state the wire ended in, read once */;
+    };
+
+    struct UnitTally {
+        uint32_t evaluations;
+        uint32_t useful /**< with an output toggled */;
+    };
+
+    void tally_unit(uint32_t entry);
+
+    /* tallies the log, adds tallies to `counters`, clears both and moves
+     * `base` to `now` */
+    void flush();
+
+    static const size_t FLUSH_TOGGLES = 1 << 20 /**< log length flushed at */;
+
+    StateVector<Slot> code;
+    StateVector<uint32_t> entries /**< code offset of every unit */;
+    std::vector<const Unit *> entry_units /**< unit of every entry */;
+
+    StateVector<uint32_t> fanout_first /**< by wire, offset in `fanout` */;
+    StateVector<uint32_t> fanout /**< combinational units affected */;
+
+    Renumbering numbering;
+
+    StateVector<uint8_t> values /**< wire states, by index */;
+    StateVector<bool *> states /**< of wires in the interpreter, by index */;
+    StateVector<uint32_t> ordered /**< index of every wire, by identifier */;
+
+    /* wires toggled in the current generation, and units of the next */
+    StateVector<uint32_t> changed_wires;
+    StateVector<uint8_t> pending /**< wires in `changed_wires` */;
+    StateVector<uint32_t> wires /**< of the generation `step` runs */;
+    StateVector<uint32_t> scheduled_units;
+    StateVector<uint8_t> scheduled /**< units in `scheduled_units` */;
+
+    std::vector<std::pair<WireId, bool>> *record {};
+    std::vector<bool> *recorded {};
+
+    Counters counters {} /**< of the current run */;
+    uint64_t now {} /**< generation being run */;
+    uint64_t base {} /**< generation the log starts after */;
+
+    StateVector<uint32_t> toggle_log /**< wires toggled, in order */;
+    StateVector<uint32_t> generation_ends /**< of each in `toggle_log` */;
+    StateVector<WireTally> wire_tallies /**< by index */;
+    StateVector<UnitTally> unit_tallies /**< by entry */;
+    StateVector<uint32_t> tallied_wires /**< toggled since `flush` */;
+    StateVector<uint32_t> tallied_units /**< evaluated since `flush` */;
+};
+
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file checkpoint.hpp
+ * @brief Snapshots of simulation state.
+ */
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+
+#include "core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+
+/**
+ * @brief Wire states bit-packed in identifier order, with pending events,
+ * time and cycles of a `Simulation`.
+ *
+ * Only meaningful for a netlist with the same sets of wires and units, which
+ * is checked on restore by a digest of their identifiers.
+ */
+struct Checkpoint {
+    uint64_t time {};
+    uint64_t evaluations {};
+    uint64_t cycles {};
+
+    uint64_t wire_count {};
+    uint64_t unit_count {};
+    uint64_t layout {} /**< digest of wire and unit identifiers */;
+
+    std::vector<uint64_t> states;
+
+    std::vector<WireId> changed_wires;
+    std::vector<UnitId> scheduled_units;
+
+    /** @brief Writes a binary file, in host byte order. */
+    std::ostream &write(std::ostream &os) const;
+
+    /**
+     * @brief Reads what `write` wrote, throws `std::invalid_argument` on
+     * malformed input.
+     *
+     * Lists are no longer than the wire and unit counts, and are read in
+     * chunks, so that sizes in a truncated file allocate no more than it
+     * holds.
+     */
+    static Checkpoint read(std::istream &is);
+};
+
+
+#endif
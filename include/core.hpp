@@ -7,13 +7,16 @@
 #define CORE_HPP
 
 
+#include "bdd.hpp"
 #include "table.hpp"
 
 #include <rdesc/cfg.h>
 #include <rdesc/rdesc.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <set>
+#include <span>
 #include <utility>
 #include <vector>
 
@@ -27,21 +30,67 @@ typedef size_t UnitId;
 /** @brief New-type pattern for wire identifiers. */
 typedef size_t WireId;
 
-/** @brief Lookup table component. */
+/**
+ * @brief Lookup table component.
+ *
+ * Truth tables of luts with at least `BDD_INPUTS` inputs are kept as a
+ * decision diagram instead of packed words, if it takes at most a quarter of
+ * their memory.
+ */
 class Lut {
 public:
+    /**
+     * @brief Lut of packed truth tables, `word_count()` words for each
+     * output in order. Value of input index `i` is bit `i % 64` of word
+     * `i / 64` of an output.
+     */
     Lut(Table table, LutId id_, size_t input_size_, size_t output_size_,
-        std::vector<bool> &&lut_)
-        : table { std::move(table) },
-          id { id_ }, input_size { input_size_ }, output_size { output_size_ },
-          lut { std::move(lut_) } {}
+        std::vector<uint64_t> &&words_, bool clocked_ = false);
+
+    /** @brief Lut of truth tables of outputs one after another. */
+    Lut(Table table, LutId id_, size_t input_size_, size_t output_size_,
+        const std::vector<bool> &lut, bool clocked_ = false);
 
     std::vector<bool> lookup(const std::vector<bool> &) const;
 
+    /** @brief Value of an output for inputs packed into `input_index`. */
+    bool lookup(size_t input_index, size_t output) const {
+        if (!bdd.empty())
+            return bdd.lookup(input_index, output);
+
+        return (words[output * word_count() + input_index / 64] >>
+                (input_index % 64)) & 1;
+    }
+
+    /** @brief Word `w` of the packed truth table of an output. */
+    uint64_t word(size_t output, size_t w) const {
+        if (!bdd.empty())
+            return bdd.word(output, w);
+
+        return words[output * word_count() + w];
+    }
+
+    /** @brief Whether truth tables are kept as a decision diagram. */
+    bool compressed() const
+        { return !bdd.empty(); }
+
+    /** @brief Memory taken by truth tables. */
+    size_t table_bytes() const
+        { return compressed() ? bdd.bytes() : words.size() * sizeof(uint64_t); }
+
     std::ostream &dump(std::ostream &os, const Lex &lex) const;
 
     size_t input_variant_count() const
-        { return (1 << input_size); }
+        { return size_t { 1 } << input_size; }
+
+    /** @brief Words of the truth table of an output. */
+    size_t word_count() const
+        { return (input_variant_count() + 63) / 64; }
+
+    /** @brief Most inputs of a lut, whose tables take 32 MiB per output. */
+    static constexpr size_t MAX_INPUTS = 28;
+    /** @brief Fewest inputs of a lut whose tables may be compressed. */
+    static constexpr size_t BDD_INPUTS = 16;
 
     const Table table;
 
@@ -49,8 +98,12 @@ public:
     const size_t input_size;
     const size_t output_size;
 
+    const bool clocked /**< declared with `reg`, outputs change only on
+                            clock edges */;
+
 private:
-    std::vector<bool> lut;
+    std::vector<uint64_t> words /**< empty if compressed */;
+    Bdd bdd;
 };
 
 /** @brief Wire representing pyhsical connections. */
@@ -0,0 +1,82 @@
+/**
+ * @file cycle.hpp
+ * @brief Levelized netlist for cycle-based simulation.
+ */
+
+#ifndef CYCLE_HPP
+#define CYCLE_HPP
+
+
+#include "core.hpp"
+#include "renumber.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+
+/**
+ * @brief Units flattened into arrays, combinational ones in topological order
+ * so that a single pass settles them, and registers apart.
+ *
+ * Wire values are bytes in the order of a `Renumbering`, and so are indices
+ * in `ports`, so that units read wires close to each other. Outputs of luts
+ * are bytes too, up to `TABLE_INPUTS` inputs, and wider luts, which are
+ * often kept as diagrams, are looked up in place.
+ */
+class Levelized {
+public:
+    Levelized(const std::map<LutId, Lut> &luts,
+              const std::map<WireId, Wire> &wires,
+              const std::map<UnitId, Unit> &units,
+              uint64_t revision_, bool renumber = true);
+
+    /** @brief Evaluates every combinational unit once. */
+    void settle();
+
+    /** @brief Latches every register at once, from current values. */
+    void latch();
+
+    size_t comb_count() const
+        { return comb.size(); }
+
+    const uint64_t revision /**< of the interpreter it is built from */;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /* widest lut with a byte table */
+    static constexpr size_t TABLE_INPUTS = 12;
+
+    bool loop {} /**< combinational units form a cycle, and are not all in
+                      topological order */;
+
+    std::vector<UnitId> registers /**< units of clocked luts */;
+
+    std::vector<uint8_t> values;
+    std::vector<uint32_t> slots /**< index in `values` of every wire, in
+                                     identifier order */;
+
+    /* a unit, its ports are in `ports`, inputs first */
+    struct Op {
+        uint32_t table /**< offset of its lut in `tables`, or NONE */;
+        uint32_t first_port;
+        uint32_t input_size;
+        uint32_t output_size;
+        const Lut *lut /**< looked up if it has no table */;
+    };
+
+private:
+    friend class FourState;
+
+    std::vector<Op> comb;
+    std::vector<Op> regs;
+
+    std::vector<uint32_t> ports /**< wire indices in `values` */;
+    std::vector<uint8_t> tables /**< output bytes, by output then input */;
+
+    std::vector<uint8_t> next /**< register outputs being latched */;
+};
+
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file drivers.hpp
+ * @brief Index of units driving each wire.
+ */
+
+#ifndef DRIVERS_HPP
+#define DRIVERS_HPP
+
+
+#include "core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <span>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/** @brief Output port of a unit. */
+struct Port {
+    UnitId unit;
+    size_t pin;
+
+    bool operator==(const Port &) const = default;
+};
+
+/**
+ * @brief Driving ports of every wire in compressed sparse row form, the
+ * backward counterpart of `Wire::affects`.
+ *
+ * Wires that no unit drives are inputs, unless no unit reads them either.
+ */
+class Drivers {
+public:
+    Drivers(const std::map<WireId, Wire> &wires,
+            const std::map<UnitId, Unit> &units,
+            uint64_t revision_);
+
+    /** @brief Ports driving a wire, in unit identifier order. */
+    std::span<const Port> of(WireId id) const {
+        if (id + 1 >= first.size())
+            return {};
+
+        return { ports.data() + first[id], ports.data() + first[id + 1] };
+    }
+
+    /**
+     * @brief Units whose outputs reach any of `wires`, directly or through
+     * other units, in identifier order.
+     */
+    std::vector<UnitId> cone(std::span<const WireId> wires) const;
+
+    /** @brief Writes a warning for every problem found. */
+    std::ostream &dump_problems(std::ostream &os, const Lex &lex) const;
+
+    const uint64_t revision /**< of the interpreter it is built from */;
+
+    std::vector<WireId> multiply_driven /**< wires of many driving ports */;
+    std::vector<WireId> floating /**< wires neither driven nor read */;
+
+private:
+    const std::map<UnitId, Unit> &units;
+
+    std::vector<size_t> first /**< by wire identifier, into `ports` */;
+    std::vector<Port> ports;
+};
+
+
+#endif
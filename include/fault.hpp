@@ -0,0 +1,136 @@
+/**
+ * @file fault.hpp
+ * @brief Bit-parallel stuck-at fault simulation.
+ */
+
+#ifndef FAULT_HPP
+#define FAULT_HPP
+
+
+#include "core.hpp"
+#include "interpreter.hpp"
+#include "placement.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/** @brief A line stuck at a constant value. */
+struct Fault {
+    enum Site { WIRE, INPUT, OUTPUT };
+
+    Site site;
+    size_t id /**< wire, or unit for its input and output ports */;
+    size_t pin /**< port index of unit */;
+    bool value;
+
+    std::ostream &dump(std::ostream &os, const Lex &lex) const;
+};
+
+/** @brief Stimuli applied together, observed after stabilization. */
+typedef std::vector<Stimulus> Pattern;
+
+/** @brief Faults and which of them a pattern set detects. */
+struct FaultReport {
+    std::vector<Fault> faults;
+    std::vector<bool> detected;
+
+    size_t detected_count {};
+
+    double coverage() const
+        { return faults.size() ? 100.0 * detected_count / faults.size() : 100; }
+
+    /** @brief Writes coverage, and undetected faults. */
+    std::ostream &dump(std::ostream &os, const Lex &lex) const;
+};
+
+/**
+ * @brief Simulates 64 faulty machines in lanes of 64-bit words, in every
+ * thread.
+ *
+ * Netlist is compiled at construction, and later changes to `intr` are not
+ * seen. A fault is detected once an observed wire differs from the good
+ * machine after a pattern, which is simulated once beforehand. A lane whose
+ * fault is detected, or that ran every pattern, restarts from the settled
+ * initial state of the good machine with the next fault not taken by any
+ * thread, and faults are injected there. Units are evaluated in
+ * an order where drivers come first, so a unit outside of loops is
+ * evaluated once per pattern whatever pattern each lane is at. Every thread
+ * fills the state of its own machine, once pinned as `set_pinning` says.
+ */
+class FaultSim {
+public:
+    /**
+     * @brief Observes `observed` wires, or wires that affect no unit if
+     * empty.
+     */
+    FaultSim(const Interpreter &intr, std::vector<WireId> observed = {});
+
+    /** @brief Pins threads of `run`, the calling one until it returns. */
+    void set_pinning(Pinning pinning_)
+        { pinning = pinning_; }
+
+    /** @brief Stuck-at-0 and 1 faults of every wire and unit port. */
+    std::vector<Fault> faults() const;
+
+    /** @brief Runs `patterns` in order against every fault of `faults()`. */
+    FaultReport run(std::span<const Pattern> patterns,
+                    unsigned threads = 0) const;
+
+    /** @brief Runs `patterns` in order against `faults`. */
+    FaultReport run(std::vector<Fault> faults,
+                    std::span<const Pattern> patterns,
+                    unsigned threads = 0) const;
+
+    static constexpr size_t LANES = 64;
+
+private:
+    class Machine;
+
+    struct CUnit {
+        const Lut *lut;
+        size_t first_input /**< in `inputs`, also index of its input ports */;
+        size_t first_output /**< in `outputs`, also index of its output ports */;
+        UnitId id;
+        size_t table /**< lanes of every input index in `tables`, or
+                          SIZE_MAX for luts of more than 6 inputs */;
+    };
+
+    size_t index_of(WireId id) const;
+
+    std::vector<WireId> wire_ids /**< dense index to identifier */;
+    std::vector<size_t> wire_index /**< identifier to dense index */;
+    std::vector<bool> initial;
+
+    std::vector<CUnit> units /**< in order of evaluation */;
+    std::vector<size_t> inputs, outputs /**< dense wire indices of ports */;
+    std::vector<size_t> unit_index /**< unit identifier to `units` index */;
+
+    /* truth tables of luts of up to 6 inputs, a word of all or no lanes for
+     * every input index of every output */
+    std::vector<uint64_t> tables;
+
+    /* units affected by a wire, in compressed sparse row form */
+    std::vector<size_t> fanout_first;
+    std::vector<size_t> fanout;
+
+    std::vector<size_t> observed;
+
+    Pinning pinning = Pinning::NONE;
+};
+
+/**
+ * @brief Reads one pattern per line, as space separated `wire=0` or `wire=1`
+ * assignments. Throws `std::invalid_argument` on unknown wires.
+ */
+std::vector<Pattern> read_patterns(std::istream &is, Lex &lex,
+                                   const Interpreter &intr);
+
+
+#endif
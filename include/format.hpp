@@ -0,0 +1,94 @@
+/**
+ * @file format.hpp
+ * @brief Buffered writer of the netlist text format.
+ */
+
+#ifndef FORMAT_HPP
+#define FORMAT_HPP
+
+
+#include "core.hpp"
+#include "table.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+class Interpreter /* defined in interpreter.hpp */;
+class Lex /* defined in lex.hpp */;
+
+
+/** @brief Options of `Writer`, defaults give the format of `dump`. */
+struct WriteOptions {
+    bool ids = true /**< comments of identifiers after names */;
+    bool metadata = true /**< tables of statements */;
+    bool hex = false /**< truth tables as hexadecimal instead of binary */;
+};
+
+/**
+ * @brief Writes statements into a buffer, which is written to the stream in
+ * blocks of `BLOCK_SIZE` bytes and once the writer is destroyed.
+ *
+ * Truth tables are written a word at a time, and a nibble at a time within
+ * words. With default options, output is the same as `dump` of each object,
+ * which is written through a writer.
+ */
+class Writer {
+public:
+    Writer(std::ostream &os_, const Lex &lex_, WriteOptions options_ = {})
+        : os { os_ }, lex { lex_ }, options { options_ }
+        { buf.reserve(BLOCK_SIZE + BLOCK_SIZE / 4); }
+
+    Writer(const Writer &) = delete;
+
+    ~Writer()
+        { flush(); }
+
+    /** @brief Luts, wires and units, each kind in identifier order. */
+    Writer &write(const Interpreter &intr);
+
+    Writer &write(const Lut &lut);
+    Writer &write(const Wire &wire);
+    Writer &write(const Unit &unit);
+
+    /** @brief Table of a statement, nothing if empty or without metadata. */
+    Writer &write(const Table &table);
+
+    Writer &write(std::string_view text) {
+        buf.append(text);
+        if (buf.size() >= BLOCK_SIZE)
+            flush();
+
+        return *this;
+    }
+
+    /** @brief Writes the buffer to the stream. */
+    void flush();
+
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+private:
+    void put(std::string_view text)
+        { buf.append(text); }
+    void put(char c)
+        { buf.push_back(c); }
+    void put_num(uint64_t num);
+
+    /* name of an identifier, and its id after `kind` in a comment */
+    void put_ident(size_t id, char kind);
+    void put_point(const TablePoint &point);
+
+    /* packed truth table of an output, most significant bit first */
+    void put_truth_table(const Lut &lut, size_t output);
+
+    std::ostream &os;
+    const Lex &lex;
+    WriteOptions options;
+
+    std::string buf;
+};
+
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file fourstate.hpp
+ * @brief Four-state (0, 1, X, Z) logic simulation.
+ */
+
+#ifndef FOURSTATE_HPP
+#define FOURSTATE_HPP
+
+
+#include "core.hpp"
+#include "cycle.hpp"
+#include "interpreter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <span>
+#include <utility>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/**
+ * @brief Value of a wire in two bits, low bit is its value and high bit is
+ * set if unknown.
+ */
+enum class Logic : uint8_t { L0, L1, X, Z };
+
+/** @brief New state of a wire, applied by `FourState::apply`. */
+typedef std::pair<WireId, Logic> Stimulus4;
+
+/**
+ * @brief Cycle-based simulation of a netlist in four-state logic.
+ *
+ * Wire values are a byte each rather than bits of words, so that units
+ * writing neighbouring wires do not wait for each other, and are scanned
+ * eight at once as 64-bit words. Lookup tables propagate X pessimistically:
+ * an output is known only if it is the same for every value of unknown
+ * inputs, and a Z input reads as X. Outputs of units driving the same wire
+ * resolve to X if they disagree, Z if none drives it.
+ *
+ * Netlist is compiled at construction, and later changes to `intr` are not
+ * seen.
+ */
+class FourState {
+public:
+    /**
+     * @brief Wires driven by a unit start at X, and others at their declared
+     * state, unless every wire starts at its declared state if `declared`.
+     */
+    FourState(const Interpreter &intr, bool declared = false);
+
+    /** @brief Throws `std::invalid_argument` on unknown wires. */
+    Logic get(WireId id) const
+        { return get_at(index_of(id)); }
+
+    /** @brief Sets a wire, until a unit driving it is evaluated. */
+    void set(WireId id, Logic value)
+        { set_at(index_of(id), value); }
+
+    /** @brief Sets wires, and settles. */
+    void apply(std::span<const Stimulus4> stimuli);
+
+    /**
+     * @brief Evaluates combinational units until no wire changes.
+     *
+     * A netlist without loops settles in a single pass. Wires that keep
+     * changing after as many passes as there are units become X.
+     */
+    void settle();
+
+    /** @brief Runs `n` clock cycles, latching every register at once. */
+    void run_cycles(uint64_t n);
+
+    /** @brief Wires at X or Z, in identifier order. */
+    std::vector<WireId> unknown_wires() const;
+
+    /** @brief Writes unknown wires, one per line. */
+    std::ostream &dump_unknown(std::ostream &os, const Lex &lex) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /* widest lut with a table of every input combination including X */
+    static constexpr size_t X_TABLE_INPUTS = 6;
+
+    Logic get_at(uint32_t wire) const
+        { return static_cast<Logic>(codes[wire]); }
+
+    void set_at(uint32_t wire, Logic logic)
+        { codes[wire] = static_cast<uint8_t>(logic); }
+
+    /* a unit of `Levelized` */
+    struct Op {
+        uint32_t table /**< offset of its lut in `Levelized::tables`, or
+                            NONE */;
+        uint32_t x_table /**< offset in `x_tables`, or NONE */;
+        uint32_t first_port;
+        uint16_t input_size;
+        uint16_t output_size;
+        bool shared /**< drives a wire that others also drive */;
+        const Lut *lut /**< looked up if it has no table */;
+    };
+
+    Op compile(const Levelized::Op &op);
+
+    uint32_t index_of(WireId id) const;
+
+    /* two-bit codes of inputs of a unit, packed in input order */
+    size_t read_inputs(const Op &op) const;
+
+    /* value of an output, for packed codes of inputs */
+    Logic lookup(const Op &op, uint32_t output, size_t packed) const;
+
+    /* writes an output port of a unit, resolving other drivers of its wire;
+     * returns whether the wire has changed if `track` */
+    template<bool track>
+    bool drive(uint32_t port, Logic logic);
+
+    /* a single pass over combinational units */
+    template<bool track>
+    bool pass();
+
+    void latch();
+
+    Levelized net;
+
+    std::vector<WireId> wire_ids /**< dense index to identifier */;
+    std::vector<uint32_t> wire_index /**< identifier to dense index */;
+
+    /* wire values by dense index, padded to whole words */
+    std::vector<uint8_t> codes;
+
+    std::vector<Op> comb /**< in order of `Levelized::comb` */;
+    std::vector<Op> regs;
+
+    std::map<const Lut *, uint32_t> x_table_of /**< by lut */;
+    std::vector<Logic> x_tables /**< by output, then packed codes of
+                                     inputs */;
+
+    /* output ports driving each wire in compressed sparse row form, empty
+     * for wires with a single driver */
+    std::vector<uint32_t> shared_first;
+    std::vector<uint32_t> shared;
+    std::vector<Logic> driven /**< last output of each port */;
+
+    std::vector<Logic> next /**< register outputs being latched */;
+
+    bool pessimistic {} /**< changing wires become X */;
+};
+
+
+#endif
@@ -21,7 +21,7 @@ class Cfg;  /* defined in rdesc.hpp */
 #include <rdesc/bnf_dsl.h>
 
 /** @brief Total number of tokens. */
-#define TK_COUNT 20
+#define TK_COUNT 21
 
 /** @brief Total number of non-terminals. */
 #define NT_COUNT 19
@@ -49,7 +49,7 @@ enum tk {
     TK_RARROW,
 
     /* keywords and reserved names */
-    TK_LUT, TK_WIRE, TK_UNIT,
+    TK_LUT, TK_WIRE, TK_UNIT, TK_REG,
 };
 
 /** @brief Non-terminal IDs. */
@@ -84,7 +84,7 @@ const char *const tk_names[TK_COUNT] = {
 
     "->",
 
-    "lut", "wire", "unit",
+    "lut", "wire", "unit", "reg",
 };
 
 /** @brief Token names with symbols escaped for dotlang graph. */
@@ -102,7 +102,7 @@ const char *const tk_names_escaped[TK_COUNT] = {
 
     "-\\>",
 
-    "lut", "wire", "unit",
+    "lut", "wire", "unit", "reg",
 };
 
 /** @brief non-terminal names (for debugging/printing CST) */
@@ -137,6 +137,11 @@ grammar[NT_COUNT][NT_VARIANT_COUNT][NT_BODY_LENGTH] = {
         TK(RANGLE_BRACKET), TK(IDENT), TK(EQ),
         TK(LPAREN), NT(NUM_LS), TK(RPAREN),
         NT(OPTTABLE),
+    alt TK(REG), TK(LANGLE_BRACKET),
+        TK(NUM), TK(COMMA), TK(NUM),
+        TK(RANGLE_BRACKET), TK(IDENT), TK(EQ),
+        TK(LPAREN), NT(NUM_LS), TK(RPAREN),
+        NT(OPTTABLE),
     ),
     /* <wire> ::= */ r(
         TK(WIRE), TK(IDENT), TK(EQ), TK(NUM), NT(OPTTABLE),
@@ -6,29 +6,50 @@
 #ifndef INTERPRETER_HPP
 #define INTERPRETER_HPP
 
+#include "activity.hpp"
+#include "checkpoint.hpp"
 #include "core.hpp"
 #include "rdesc.hpp"
 #include "grammar.hpp"
+#include "profile.hpp"
 
 #include <rdesc/rdesc.h>
 
 #include <map>
 #include <memory>
 #include <ostream>
+#include <cstdint>
+#include <initializer_list>
 #include <set>
+#include <span>
+#include <string>
+#include <vector>
 
 class EvLoop /* defined in Xapp.hpp */;
 class Draw /* defined in Xdraw.hpp */;
 class Lex /* defined in lex.hpp */;
+class NumInfo /* defined in lex.hpp */;
 
 
 class Simulation;
+class HotReload /* defined in reload.hpp */;
+class Levelized /* defined in cycle.hpp */;
+class Bytecode /* defined in bytecode.hpp */;
+class Drivers /* defined in drivers.hpp */;
+
+/** @brief Source text of a statement and the object it defines. */
+struct Stmt {
+    enum nt kind /**< NT_LUT, NT_WIRE or NT_UNIT */;
+    size_t id;
+    std::string text;
+};
 
 /** @brief Interprets concrete syntax into simulation objects. */
 class Interpreter {
 public:
     Interpreter(Rdesc &&rdesc_)
-        : rdesc { std::move(rdesc_) }
+        : metadata { std::make_unique<Metadata>() },
+          rdesc { std::move(rdesc_) }
         { rdesc.start(START_SYM); };
 
     enum rdesc_result pump(struct rdesc_cfg_token tk);
@@ -38,43 +59,255 @@ public:
     void interpret_unit(struct rdesc_node &);
 
     Table interpret_table(struct rdesc_node &);
-    std::unique_ptr<TableValue> interpret_table_value(struct rdesc_node &);
+
+    /**
+     * @brief Drops metadata entries (keys starting with '_') while loading,
+     * for runs without visualizer.
+     */
+    void strip_metadata(std::shared_ptr<Lex> lex);
+
+    /**
+     * @brief Replaces objects defined by `removed` statements with the ones in
+     * `added`, keeping every other object and its state.
+     *
+     * Statements are lexed with `lex`'s identifiers. Wires whose dependent
+     * units should be re-evaluated are appended to `dirty`. Throws like
+     * `pump` on invalid statements, leaving the netlist unchanged.
+     */
+    void patch(const std::vector<Stmt> &removed,
+               const std::vector<Stmt> &added,
+               Lex &lex, std::vector<WireId> &dirty);
 
     std::ostream &dump(std::ostream &os, const Lex &lex) const;
 
+    /** @brief Times parsing and interpretation into `profile_`, or stops
+     * timing if null. */
+    void set_profile(Profile *profile_)
+        { profile = profile_; }
+
+    const std::map<LutId, Lut> &get_luts() const
+        { return luts; }
+    const std::map<WireId, Wire> &get_wires() const
+        { return wires; }
+    const std::map<UnitId, Unit> &get_units() const
+        { return units; }
+
+    /** @brief Driving ports of wires, built again once objects are added or
+     * removed. */
+    const Drivers &drivers() const;
+
 private:
     friend Simulation;
     friend Draw;
+    friend class Optimizer;
+    friend class ParallelSim;
+    friend class Parser;
+
+    /* objects of statements, validated the same way whichever parser reads
+     * them */
+    void define_lut(LutId id, size_t input_size, size_t output_size,
+                    std::span<const NumInfo> outputs, Table table,
+                    bool clocked);
+    void define_wire(WireId id, bool state, Table table);
+    void define_unit(UnitId id, LutId lut_id,
+                     std::vector<WireId> &&input_wires,
+                     std::vector<WireId> &&output_wires, Table table);
 
     std::map<LutId, Lut> luts;
     std::map<WireId, Wire> wires;
     std::map<UnitId, Unit> units;
 
+    std::unique_ptr<Metadata> metadata /**< storage of all tables */;
+
+    enum class MetadataMode { FULL, STRIP };
+
+    MetadataMode metadata_mode = MetadataMode::FULL;
+
+    /* whether entries of the key are stored */
+    bool keeps(TableKeyId key) const;
+    std::shared_ptr<Lex> lex /**< source of tokens, unless mode is full */;
+
     static const enum nt START_SYM = NT_STMT;
 
+    uint64_t revision {} /**< changes whenever an object is added or
+                              removed */;
+
+    mutable std::shared_ptr<Drivers> driver_index;
+
+    Profile *profile {};
+
     Rdesc rdesc;
 };
 
+/** @brief New state of a wire, applied by `Simulation::apply`. */
+typedef std::pair<WireId, bool> Stimulus;
+
 /** @brief core simulation engine. */
 class Simulation {
 public:
     Simulation(Interpreter &intr)
-        : luts { intr.luts }, wires { intr.wires }, units { intr.units } {}
+        : luts { intr.luts }, wires { intr.wires }, units { intr.units },
+          revision { intr.revision } {}
 
     void set_wire_state(WireId id, bool state);
 
+    /** @brief Re-evaluates units affected by the wire on next `advance`. */
+    void schedule(WireId id);
+
+    /**
+     * @brief Applies a batch of changes and stabilizes.
+     *
+     * Units in the union fan-out cone are evaluated at most once per
+     * generation. Returns wires whose state differs from before the call.
+     */
+    std::vector<WireId> apply(std::initializer_list<Stimulus> stimuli)
+        { return apply(std::span { stimuli.begin(), stimuli.size() }); }
+
+    std::vector<WireId> apply(std::span<const Stimulus> stimuli);
+
     void advance();
 
+    /** @brief Whether no wire changed since the last `advance`. */
+    bool settled() const
+        { return changed_wires.empty(); }
+
+    /**
+     * @brief Advances until no wire changes, running units compiled into
+     * bytecode, which counts into an attached profile and activity as
+     * `advance` does.
+     */
     void stabilize();
 
+    /** @brief Total number of unit evaluations so far. */
+    uint64_t evaluation_count() const
+        { return evaluations; }
+
+    /** @brief Counts generations, evaluations and toggles into `profile_`,
+     * or stops counting if null. */
+    void set_profile(Profile *profile_)
+        { profile = profile_; }
+
+    /** @brief Collects switching activity into `activity_` from now on, or
+     * stops collecting if null. */
+    void set_activity(Activity *activity_) {
+        if (activity)
+            activity->finish(time);
+
+        activity = activity_;
+
+        if (activity)
+            activity->begin(wires, time);
+    }
+
+    /** @brief Number of generations advanced so far. */
+    uint64_t now() const
+        { return time; }
+
+    /**
+     * @brief Clock edge, stabilizes, latches every unit of a `reg` lut at
+     * once, and stabilizes again.
+     */
+    void clock();
+
+    /**
+     * @brief Runs `n` clock cycles, evaluating combinational units once per
+     * cycle in levelized order instead of by events.
+     *
+     * Every combinational unit is settled first, not only those with pending
+     * events, so wire states end as after `n` calls to `clock` only if each
+     * unit already agrees with its inputs, as in a netlist that was
+     * stabilized once. Declared states of a netlist that was not may differ.
+     *
+     * `now` advances by one per cycle, not by the generations `clock` would
+     * take, since a cycle is not split into generations here. Throws
+     * `std::invalid_argument` if combinational units form a loop. With a
+     * profile or activity attached, `clock` is used instead so that every
+     * toggle is seen.
+     */
+    void run_cycles(uint64_t n);
+
+    /** @brief Number of clock cycles run so far. */
+    uint64_t cycle_count() const
+        { return cycles; }
+
+    /**
+     * @brief Lays out compiled wires and units in breadth-first order of
+     * connectivity, which is the default, or in identifier order, for
+     * comparison.
+     */
+    void set_renumbering(bool renumbering_) {
+        renumbering = renumbering_;
+        bytecode.reset();
+        levelized.reset();
+    }
+
+    /** @brief Snapshot of wire states, pending events, time and cycles. */
+    Checkpoint checkpoint() const;
+
+    /**
+     * @brief Returns to a snapshot, by comparing its words with compiled wire
+     * states and writing back only wires that differ.
+     *
+     * Throws `std::invalid_argument` if the set of wires or units has changed
+     * since the snapshot. An attached activity starts over from restored state.
+     */
+    void restore(const Checkpoint &checkpoint);
+
 private:
     friend EvLoop;
 
+    /* grows a dense bitmap to hold an identifier */
+    static void fit(std::vector<bool> &bitmap, size_t id) {
+        if (id >= bitmap.size())
+            bitmap.resize(id + 1);
+    }
+
     const std::map<LutId, Lut> &luts;
     std::map<WireId, Wire> &wires;
     const std::map<UnitId, Unit> &units;
 
-    std::set<WireId> changed_wires;
+    std::vector<WireId> changed_wires;
+    std::vector<bool> pending /**< wires in `changed_wires` */;
+
+    std::vector<UnitId> scheduled_units;
+    std::vector<bool> scheduled /**< units in `scheduled_units` */;
+
+    /* original states of wires changed in current `apply` */
+    std::vector<std::pair<WireId, bool>> *record {};
+    std::vector<bool> recorded;
+
+    uint64_t evaluations {};
+    uint64_t time {};
+    uint64_t cycles {};
+
+    /* builds `states` again if wires are added or removed */
+    void index_states() const;
+
+    const uint64_t &revision;
+
+    /* wire states in identifier order, for cycles, and a digest of wire and
+     * unit identifiers, for checkpoints */
+    mutable std::vector<bool *> states;
+    mutable uint64_t states_revision = UINT64_MAX;
+    mutable uint64_t layout {};
+
+    /* builds `levelized` again if objects are added or removed */
+    const Levelized &levelize() const;
+
+    mutable std::shared_ptr<Levelized> levelized;
+
+    /* builds `bytecode` again if objects are added or removed */
+    Bytecode &compile() const;
+
+    /* copies wire states into `bytecode` after writing them other than
+     * through `set_wire_state` */
+    void reload_states();
+
+    mutable std::shared_ptr<Bytecode> bytecode;
+    bool renumbering = true;
+
+    Profile *profile {};
+    Activity *activity {};
 };
 
 
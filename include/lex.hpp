@@ -21,43 +21,6 @@
 #include <vector>
 
 
-/** @brief Tokenizer */
-class Lex {
-public:
-    Lex(std::istream &s_)
-        : s { s_.rdbuf() } {}
-
-    /* SAFETY: `struct rdesc` cannot shared across lexers. */
-    Lex(const Lex &other) = delete;
-
-    ~Lex() = default;
-
-    struct rdesc_cfg_token next();
-
-    const std::string &ident_name(size_t i) const;
-
-    size_t get_ident_id(const std::string &);
-
-private:
-    template<typename T>
-    friend void operator<<(Lex &lex, T i);
-
-    char skip_space();
-
-    struct rdesc_cfg_token skip_comment();
-
-    struct rdesc_cfg_token lex_num(char c);
-    struct rdesc_cfg_token lex_ident_or_keyword(char c);
-    struct rdesc_cfg_token lex_punctuation(char c);
-
-    std::iostream s;
-    enum tk lookahead = TK_NOTOKEN;
-
-    std::map<std::string, size_t> idents;
-    std::vector<std::string> ident_names;
-    size_t last_ident_id = 0;
-};
-
 /** @brief Semantic information base class. */
 class SemInfo {
 public:
@@ -91,6 +54,69 @@ public:
 };
 
 
+/** @brief Tokenizer */
+class Lex {
+public:
+    Lex(std::istream &s_)
+        : s { s_.rdbuf() }, ident_owner { this } {}
+
+    /** @brief Lexer sharing identifier ids with another lexer. */
+    Lex(std::istream &s_, Lex &ident_owner_)
+        : s { s_.rdbuf() }, ident_owner { &ident_owner_ } {}
+
+    /* SAFETY: `struct rdesc` cannot shared across lexers. */
+    Lex(const Lex &other) = delete;
+
+    ~Lex() = default;
+
+    struct rdesc_cfg_token next();
+
+    /**
+     * @brief Like `next`, without allocating semantic information. Value of
+     * the last number or identifier is kept in `num` or `ident` until the
+     * next call.
+     */
+    enum tk next_bare();
+
+    const NumInfo &num() const
+        { return last_num; }
+    size_t ident() const
+        { return last_ident; }
+
+    const std::string &ident_name(size_t i) const;
+
+    size_t get_ident_id(const std::string &);
+
+    /** @brief Byte offset of the stream just after the last token. */
+    size_t offset()
+        { return s.tellg(); }
+
+private:
+    template<typename T>
+    friend void operator<<(Lex &lex, T i);
+
+    char skip_space();
+
+    enum tk skip_comment();
+
+    enum tk lex_num(char c);
+    enum tk lex_ident_or_keyword(char c);
+    enum tk lex_punctuation(char c);
+
+    std::iostream s;
+    enum tk lookahead = TK_NOTOKEN;
+
+    Lex *ident_owner /**< lexer whose identifier table is used */;
+
+    NumInfo last_num { 10, "" };
+    size_t last_ident {};
+    std::string ident_buf /**< reused for identifiers being read */;
+
+    std::map<std::string, size_t> idents;
+    std::vector<std::string> ident_names;
+    size_t last_ident_id = 0;
+};
+
 template<typename T>
 void operator<<(Lex &lex, T i) {
     lex.s << i;
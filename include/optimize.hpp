@@ -0,0 +1,103 @@
+/**
+ * @file optimize.hpp
+ * @brief Dead logic elimination, constant folding, chain collapsing and
+ * lut fusion.
+ */
+
+#ifndef OPTIMIZE_HPP
+#define OPTIMIZE_HPP
+
+
+#include "core.hpp"
+#include "interpreter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Drivers /* defined in drivers.hpp */;
+class Lex /* defined in lex.hpp */;
+
+
+/** @brief Sizes of a netlist before and after optimization. */
+struct OptReport {
+    size_t units_before {}, wires_before {};
+    size_t units_after {}, wires_after {};
+
+    size_t dead {} /**< units reaching no observed wire */;
+    size_t folded {} /**< units of constant outputs */;
+    size_t collapsed {} /**< units merged into the unit they drive */;
+    size_t fused {} /**< units merged into a wider lut they drive */;
+
+    std::ostream &dump(std::ostream &os) const;
+};
+
+/**
+ * @brief Rewrites an interpreted netlist into a smaller one that gives the
+ * same values on observed wires.
+ *
+ * Units are removed in place, so the netlist no longer matches its source
+ * and is meant for runs without visualizer. Wires that no unit drives are
+ * kept, unless they are constants.
+ */
+class Optimizer {
+public:
+    Optimizer(Interpreter &intr_, Lex &lex_)
+        : intr { intr_ }, lex { lex_ } {}
+
+    /**
+     * @brief Observes `observed` wires, or if empty, wires that affect no
+     * unit or every wire if there are none. Wires in `constants` that no
+     * unit drives never change from their state.
+     *
+     * Units whose outputs do not depend on non-constant inputs are folded
+     * into constants, a single-input unit is merged with the unit driving
+     * its input if nothing else reads it, into a composed lut, and units
+     * not reaching an observed wire are removed.
+     *
+     * Then a unit of a single output absorbs units driving its inputs that
+     * nothing else reads, as long as it is left with at most `FUSE_INPUTS`
+     * inputs, so clusters of gates become a lut each. Observed wires are
+     * never absorbed, so wires to probe can be kept by observing them.
+     */
+    OptReport run(std::vector<WireId> observed = {},
+                  const std::vector<WireId> &constants = {});
+
+    static constexpr size_t FUSE_INPUTS = 6;
+
+private:
+    /* units other than registers, in topological order, without loops */
+    std::vector<UnitId> order(const Drivers &drivers) const;
+
+    void fold();
+    void collapse();
+    void fuse();
+
+    /* merges `driver` into `id`, which reads its output `middle` */
+    void absorb(UnitId id, UnitId driver, WireId middle,
+                std::vector<WireId> &&inputs, LutId lut_id);
+    void sweep(const std::vector<WireId> &observed);
+
+    void remove_unit(UnitId id);
+
+    /* a lut of a single output, the same one for the same table */
+    LutId lut_of(size_t input_size, std::vector<bool> &&table,
+                 const std::string &name);
+
+    Interpreter &intr;
+    Lex &lex;
+
+    OptReport report;
+
+    std::vector<int8_t> known /**< constant wire states, or -1 */;
+    std::vector<bool> pinned /**< observed wires and inputs */;
+
+    std::map<std::pair<size_t, std::vector<bool>>, LutId> lut_ids;
+};
+
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file parser.hpp
+ * @brief Single-pass parser building netlist objects without concrete syntax
+ * trees.
+ */
+
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+
+#include "core.hpp"
+#include "grammar.hpp"
+#include "interpreter.hpp"
+#include "lex.hpp"
+#include "table.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/** @brief Outcome of parsing a statement, as `pump` and lexer report it. */
+enum class Parsed { READY, NOMATCH, BAD_TOKEN, END };
+
+/**
+ * @brief Recursive descent parser of the grammar in `grammar.hpp`, reading
+ * tokens without semantic information and defining objects as soon as their
+ * statement ends.
+ *
+ * Objects are validated by the interpreter like pumped statements, and a
+ * syntax error skips the statement up to the token in error, as in `pump`.
+ * `Interpreter::pump` stays the reference, used by hot reload.
+ *
+ * Tokens are lexed in batches, so that lexing is timed apart from parsing
+ * without reading the clock for every token. A batch ends early at the end of
+ * input or a lexer error, leaving the stream there.
+ */
+class Parser {
+public:
+    Parser(Interpreter &intr_, Lex &lex_)
+        : intr { intr_ }, lex { lex_ } {}
+
+    /**
+     * @brief Parses and interprets next statement of `lex`.
+     *
+     * Returns `END` at the end of input, dropping an incomplete statement,
+     * and `BAD_TOKEN` if the lexer fails. Throws like `Interpreter::pump` on
+     * invalid statements.
+     */
+    Parsed next();
+
+private:
+    /** @brief Token with the value `Lex` keeps until the next one. */
+    struct Token {
+        enum tk id = TK_NOTOKEN;
+        size_t ident {};
+        NumInfo num { 10, "" };
+    };
+
+    static const size_t TOKEN_BATCH = 256;
+
+    /* lexes next batch of tokens */
+    void fill();
+
+    enum tk advance() {
+        if (token_at == token_count)
+            fill();
+
+        return tk = tokens[token_at++].id;
+    }
+    bool expect(enum tk id_)
+        { return advance() == id_; }
+
+    /* value of the current token, as `Lex::num` and `Lex::ident` */
+    const NumInfo &num() const
+        { return tokens[token_at - 1].num; }
+    size_t ident() const
+        { return tokens[token_at - 1].ident; }
+
+    bool parse_lut(bool clocked);
+    bool parse_wire();
+    bool parse_unit();
+
+    /* identifiers up to a closing parenthesis, after the opening one */
+    bool parse_idents(std::vector<size_t> &ids);
+
+    /* optional table and the semicolon ending a statement */
+    bool parse_end();
+
+    bool parse_table();
+    bool parse_value(TableValue &value);
+    bool parse_point(TablePoint &point);
+
+    /* stores the table just parsed, as `Interpreter::interpret_table` */
+    Table commit_table();
+
+    Interpreter &intr;
+    Lex &lex;
+
+    enum tk tk = TK_NOTOKEN /**< current token */;
+
+    std::vector<Token> tokens /**< batch being parsed */;
+    size_t token_count {}, token_at {};
+
+    /* statement being parsed */
+    enum nt kind = NT_STMT;
+    size_t id {}, lut_id {};
+    size_t input_size {}, output_size {};
+    bool clocked {}, state {};
+    std::vector<WireId> inputs, outputs;
+
+    std::vector<NumInfo> nums /**< outputs of a lut, reused */;
+    size_t num_count {};
+
+    bool has_table {};
+    bool valid_points {} /**< every point of the table fits `TablePoint` */;
+
+    /* entries of the table, paths as ranges of `points` */
+    std::vector<std::pair<TableKeyId, TableValue>> entries;
+    std::vector<TablePoint> points;
+    std::vector<bool> breaks /**< polyline ends after the point */;
+};
+
+
+#endif
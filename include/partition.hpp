@@ -0,0 +1,157 @@
+/**
+ * @file partition.hpp
+ * @brief Netlist split into parts simulated by their own processes.
+ */
+
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+
+#include "core.hpp"
+#include "fault.hpp"
+#include "interpreter.hpp"
+#include "placement.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <span>
+#include <vector>
+
+
+/**
+ * @brief Units split into parts of about the same size, with few wires
+ * between them.
+ *
+ * Parts grow one after the other, breadth first from the first unit left
+ * through wires between units, until they hold their share. Passes in the
+ * way of Fiduccia and Mattheyses then move units one at a time to the part
+ * that cuts the most wires, counting the units of `Wire::affects` and
+ * drivers, as long as parts stay within `IMBALANCE` of the mean size. Unlike
+ * theirs, a pass makes no move that cuts more wires. Wires no unit drives
+ * are not counted, since every part applies stimuli itself.
+ */
+class Partition {
+public:
+    /** @brief Throws `std::invalid_argument` unless `part_count` is from 1
+     * to `MAX_PARTS`. */
+    Partition(const std::map<WireId, Wire> &wires,
+              const std::map<UnitId, Unit> &units, size_t part_count);
+
+    /** @brief Part of a unit. Throws `std::out_of_range` on unknown
+     * units. */
+    size_t part_of(UnitId id) const;
+
+    size_t size() const
+        { return sizes.size(); }
+
+    /** @brief Units of every part. */
+    std::span<const size_t> part_sizes() const
+        { return sizes; }
+
+    /** @brief Wires driven by a unit of one part and read or driven by a
+     * unit of another. */
+    const std::vector<WireId> &cut() const
+        { return cut_wires; }
+
+    /** @brief Writes the size of every part and of the cut. */
+    std::ostream &dump(std::ostream &os) const;
+
+    static constexpr size_t MAX_PARTS = 64;
+    static constexpr double IMBALANCE = 0.05;
+    static constexpr size_t PASSES = 8;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> parts /**< by unit identifier, `NONE` if none */;
+    std::vector<size_t> sizes;
+    std::vector<WireId> cut_wires;
+};
+
+/**
+ * @brief Simulates the parts of a `Partition` in processes of their own,
+ * which exchange changes of wires in the cut through shared memory.
+ *
+ * Every process runs the units of its part generation by generation, as
+ * `Simulation::stabilize` does, on a copy of the netlist made by `fork`.
+ * Wires toggled in a generation reach the parts reading them in a queue per
+ * pair of parts, stamped with the generation that sees them. A unit takes one
+ * generation, which is the lookahead: a process that completed generation g
+ * sends nothing stamped g + 1 or earlier anymore, and says so with a null
+ * message, a clock in shared memory that it publishes after every generation.
+ * A process runs a generation once every part sending to it is past it, and a
+ * process with nothing to do moves its clock to what its senders allow, so
+ * that processes never wait for each other in a loop.
+ *
+ * A process is pinned as `set_pinning` says before it compiles its part, so
+ * that its state arrays are first written, and placed, on its own node.
+ *
+ * A pattern is settled once no part has wires to evaluate and no change is
+ * queued, which processes count together, and patterns start in every part at
+ * the same generation. Units of the same part read wires toggled earlier in
+ * the same generation, but changes from other parts only arrive in the next
+ * one, so that glitches differ from a single `Simulation`. States end the same
+ * once units agree with their inputs, such as after `run_cycles(0)`, except
+ * in loops that race and on wires driven by units of several parts. Units
+ * that do not agree yet are only evaluated where a glitch reaches them.
+ */
+class ParallelSim {
+public:
+    ParallelSim(Interpreter &intr_, const Partition &partition_);
+
+    /**
+     * @brief Applies `patterns` in order, each until stabilized, and leaves
+     * the states in the interpreter.
+     *
+     * A `Simulation` of the interpreter compiled before does not see them.
+     * Throws `std::runtime_error` if a process cannot be started or fails.
+     */
+    void run(std::span<const Pattern> patterns);
+
+    /** @brief Pins the process of every part from the next `run` on. */
+    void set_pinning(Pinning pinning_)
+        { pinning = pinning_; }
+
+    /** @brief Changes sent between parts by the last `run`. */
+    uint64_t message_count() const
+        { return messages; }
+
+    /** @brief Generations of the last `run`, the most of any part. */
+    uint64_t generation_count() const
+        { return generations; }
+
+    /** @brief Units evaluated by the last `run`, in every part. */
+    uint64_t evaluation_count() const
+        { return evaluations; }
+
+    /** @brief Memory of the processes of the last `run` as they ended, added
+     * up, including pages they share. */
+    const MemoryReport &memory() const
+        { return memory_report; }
+
+    static constexpr size_t QUEUE_SIZE = 1024;
+    static constexpr size_t MAX_NODES = 16 /**< reported by `memory` */;
+
+private:
+    class Shared;
+    class Worker;
+
+    Interpreter &intr;
+    const Partition &partition;
+
+    std::vector<uint64_t> interest /**< by wire, parts reading or driving */;
+    std::vector<uint64_t> drivers /**< by wire, parts driving */;
+    std::vector<uint32_t> owner /**< by wire, part whose state is final */;
+
+    Pinning pinning = Pinning::NONE;
+
+    uint64_t messages {};
+    uint64_t generations {};
+    uint64_t evaluations {};
+    MemoryReport memory_report;
+};
+
+
+#endif
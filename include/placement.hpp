@@ -0,0 +1,132 @@
+/**
+ * @file placement.hpp
+ * @brief Processors, memory nodes and pages of simulation workers.
+ */
+
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <sched.h>
+
+
+/** @brief How workers are pinned to processors. */
+enum class Pinning {
+    NONE /**< wherever the scheduler puts them */,
+    COMPACT /**< on processors of the first node, then of the next */,
+    SCATTER /**< on every node in turn */,
+};
+
+/** @brief Pages backing state arrays of `HUGE_PAGE_SIZE` or more. */
+enum class HugePages {
+    NONE,
+    TRANSPARENT /**< advised to the kernel, which may merge pages */,
+    EXPLICIT /**< from the reserved pool, or transparent if it is empty */,
+};
+
+/**
+ * @brief Processors the process may run on, by memory node, as listed in
+ * sysfs, or a single node if there is none.
+ */
+class Topology {
+public:
+    /** @brief Topology of this machine. */
+    Topology();
+
+    /** @brief Topology of processors of every node. */
+    explicit Topology(std::vector<std::vector<int>> nodes_);
+
+    /** @brief Processor of the `worker`th worker, or -1 to not pin it. */
+    int cpu_for(size_t worker, Pinning pinning) const;
+
+    /** @brief Node of a processor, or -1 if not listed. */
+    int node_of(int cpu) const;
+
+    std::vector<std::vector<int>> nodes /**< processors of every node with
+                                             any */;
+};
+
+/** @brief Processors of a sysfs list such as `0-3,8`. Throws
+ * `std::invalid_argument` on malformed lists. */
+std::vector<int> parse_cpu_list(std::string_view list);
+
+/**
+ * @brief Pins the calling thread to a processor, and restores the processors
+ * it may run on once destroyed. Does nothing for processor -1 or if the
+ * kernel refuses.
+ */
+class ScopedPin {
+public:
+    explicit ScopedPin(int cpu);
+    ~ScopedPin();
+
+    ScopedPin(const ScopedPin &) = delete;
+    ScopedPin &operator=(const ScopedPin &) = delete;
+
+    bool pinned() const
+        { return saved; }
+
+private:
+    cpu_set_t before;
+    bool saved {};
+};
+
+/** @brief Memory of this process, from `/proc`, empty if not available. */
+struct MemoryReport {
+    std::vector<size_t> node_bytes /**< resident on every node */;
+    size_t huge_page_bytes {} /**< of anonymous memory */;
+
+    static MemoryReport of_self();
+};
+
+/** @brief Sets pages of state arrays allocated from now on. */
+void set_huge_pages(HugePages mode);
+
+HugePages huge_pages();
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+/* pages of `PageAllocator`, which are not touched until used */
+void *allocate_pages(size_t bytes, size_t align);
+void free_pages(void *ptr, size_t bytes, size_t align);
+
+/**
+ * @brief Allocator of state arrays, which maps arrays of `HUGE_PAGE_SIZE` or
+ * more directly, aligned to huge pages and backed by them as
+ * `set_huge_pages` says.
+ *
+ * Mapped pages are only placed once first written, on the memory node of
+ * the processor that writes them, so that arrays filled by the worker that
+ * owns them end up next to it.
+ */
+template<class T>
+class PageAllocator {
+public:
+    typedef T value_type;
+
+    PageAllocator() = default;
+
+    template<class U>
+    PageAllocator(const PageAllocator<U> &) {}
+
+    T *allocate(size_t n)
+        { return static_cast<T *>(allocate_pages(n * sizeof(T), alignof(T))); }
+
+    void deallocate(T *ptr, size_t n)
+        { free_pages(ptr, n * sizeof(T), alignof(T)); }
+
+    template<class U>
+    bool operator==(const PageAllocator<U> &) const
+        { return true; }
+};
+
+/** @brief Array of simulation state, see `PageAllocator`. */
+template<class T>
+using StateVector = std::vector<T, PageAllocator<T>>;
+
+
+#endif
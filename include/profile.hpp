@@ -0,0 +1,138 @@
+/**
+ * @file profile.hpp
+ * @brief Performance counters of loading and simulation.
+ */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+
+#include "core.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/** @brief Phases of a run, timed separately. */
+enum class Phase { LEX, PARSE, INTERPRET, SIMULATE, DRAW, COUNT };
+
+/**
+ * @brief Counters filled by `Interpreter`, `Simulation` and `EvLoop` while a
+ * profile is attached to them.
+ */
+class Profile {
+public:
+    /**
+     * @brief Adds time until destruction to a phase, if `profile` is set.
+     *
+     * The time is taken back from `within`, if a timer of that phase runs
+     * around this one.
+     */
+    class Timer {
+    public:
+        Timer(Profile *profile_, Phase phase_, Phase within_ = Phase::COUNT)
+            : profile { profile_ }, phase { phase_ }, within { within_ } {
+            if (profile)
+                start = std::chrono::steady_clock::now();
+        }
+
+        /** SAFETY: time would be added twice */
+        Timer(const Timer &) = delete;
+
+        ~Timer() {
+            if (!profile)
+                return;
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            profile->phase_time[static_cast<size_t>(phase)] += elapsed;
+
+            if (within != Phase::COUNT)
+                profile->phase_time[static_cast<size_t>(within)] -= elapsed;
+        }
+
+    private:
+        Profile *profile;
+        Phase phase;
+        Phase within;
+
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void count_toggle(WireId id) {
+        toggles++;
+        fit(wire_toggles, id)++;
+    }
+
+    /** @brief Counts an evaluation, redundant if no output has toggled. */
+    void count_evaluation(const Unit &unit, bool redundant) {
+        evaluations++;
+        redundant_evaluations += redundant;
+
+        fit(unit_evaluations, unit.id)++;
+        fit(lut_evaluations, unit.lut_id)++;
+    }
+
+    /** @brief Counts toggles of a wire at once, as `Bytecode` tallies
+     * them. */
+    void count_toggles(WireId id, uint64_t count) {
+        toggles += count;
+        fit(wire_toggles, id) += count;
+    }
+
+    /** @brief Counts evaluations of a unit at once, `redundant` of them
+     * redundant. */
+    void count_evaluations(const Unit &unit, uint64_t count,
+                           uint64_t redundant) {
+        evaluations += count;
+        redundant_evaluations += redundant;
+
+        fit(unit_evaluations, unit.id) += count;
+        fit(lut_evaluations, unit.lut_id) += count;
+    }
+
+    void count_stabilize(uint64_t generations_) {
+        stabilizations++;
+        generations += generations_;
+
+        if (generations_ > max_generations)
+            max_generations = generations_;
+    }
+
+    /** @brief Writes phase times, counters and the `top` hottest luts,
+     * units and wires. */
+    std::ostream &report(std::ostream &os, const Lex &lex,
+                         size_t top = 10) const;
+
+    uint64_t stabilizations {};
+    uint64_t generations {};
+    uint64_t max_generations {} /**< longest stabilization */;
+
+    uint64_t evaluations {};
+    uint64_t redundant_evaluations {} /**< outputs did not change */;
+    uint64_t toggles {};
+
+    /* indexed by identifiers, which are dense */
+    std::vector<uint64_t> lut_evaluations;
+    std::vector<uint64_t> unit_evaluations;
+    std::vector<uint64_t> wire_toggles;
+
+    std::chrono::steady_clock::duration
+        phase_time[static_cast<size_t>(Phase::COUNT)] {};
+
+private:
+    static uint64_t &fit(std::vector<uint64_t> &counts, size_t id) {
+        if (id >= counts.size())
+            counts.resize(id + 1);
+
+        return counts[id];
+    }
+};
+
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file raster.hpp
+ * @brief Software rasterizer of wires and unit shapes.
+ */
+
+#ifndef RASTER_HPP
+#define RASTER_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Segment with a radius, which covers pixels whose center is at most
+ * `radius` away from it. Thick lines with round caps and joins are chains of
+ * capsules, dots are capsules of no length.
+ */
+struct Capsule {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+    float radius;
+    uint32_t color;
+};
+
+/**
+ * @brief Rasterizes capsules into a pixel buffer, in the order they are
+ * added.
+ *
+ * Capsules are binned into screen tiles, and threads take tiles in turn, so
+ * no two threads write the same pixel and every tile draws its capsules in
+ * order. A capsule covers an interval of every row, which is found from its
+ * edges and filled as a span.
+ */
+class Raster {
+public:
+    /** @brief Rasterizer with `threads` threads, or one per processor if
+     * 0. */
+    explicit Raster(size_t threads = 0);
+
+    /**
+     * @brief Starts a frame of `width` x `height` pixels, rows of which are
+     * `stride` pixels apart in `pixels`. The frame is cleared to
+     * `background`.
+     */
+    void begin(uint32_t *pixels, int width, int height, size_t stride,
+               uint32_t background);
+
+    void capsule(float x0, float y0, float x1, float y1, float radius,
+                 uint32_t color);
+
+    /** @brief Draws capsules added since `begin` into the buffer. */
+    void end();
+
+    /** @brief Capsules drawn by the last `end`. */
+    size_t capsule_count() const
+        { return capsules.size(); }
+
+    static const int TILE = 64 /**< width and height of a tile */;
+
+private:
+    void draw_tile(size_t tile) const;
+
+    size_t threads;
+
+    uint32_t *pixels {};
+    int width {};
+    int height {};
+    size_t stride {};
+    uint32_t background {};
+
+    std::vector<Capsule> capsules;
+
+    size_t tiles_x {};
+    size_t tiles_y {};
+
+    /* capsules of every tile, in order, as ranges of `bins` (CSR) */
+    std::vector<uint32_t> bin_first;
+    std::vector<uint32_t> bins;
+};
+
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file reload.hpp
+ * @brief Incremental reloading of simulation file.
+ */
+
+#ifndef RELOAD_HPP
+#define RELOAD_HPP
+
+
+#include "interpreter.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Lex /* defined in lex.hpp */;
+
+
+/**
+ * @brief Watches simulation file, and patches the netlist with statements
+ * whose text changed.
+ */
+class HotReload {
+public:
+    /** @brief Indexes statements of the file `intr` is loaded from. */
+    HotReload(std::string path_, std::shared_ptr<Interpreter> intr_,
+              std::shared_ptr<Lex> lex_);
+
+    /** SAFETY: owns the inotify descriptor */
+    HotReload(const HotReload &) = delete;
+
+    ~HotReload();
+
+    /** @brief inotify descriptor, readable when the file may have changed. */
+    int fd() const
+        { return inotify_fd; }
+
+    /** @brief Consumes pending events, true if the file has been rewritten. */
+    bool changed();
+
+    /**
+     * @brief Re-reads the file and applies changed statements.
+     *
+     * Wires of the affected cone are scheduled in `sim`, without stabilizing.
+     * Netlist is left unchanged and false is returned on errors.
+     */
+    bool reload(Simulation &sim);
+
+private:
+    /* splits the file into statements, false on lexical errors */
+    bool read_stmts(std::vector<Stmt> &out) const;
+
+    std::string path;
+    std::string name /**< file name without its directory */;
+
+    std::shared_ptr<Interpreter> intr;
+    std::shared_ptr<Lex> lex;
+
+    std::vector<Stmt> stmts;
+
+    int inotify_fd;
+};
+
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file renumber.hpp
+ * @brief Dense numbering of wires and units for locality.
+ */
+
+#ifndef RENUMBER_HPP
+#define RENUMBER_HPP
+
+
+#include "core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+
+/**
+ * @brief Dense indices of wires and units in breadth-first order of
+ * connectivity, for arrays of compiled netlists.
+ *
+ * Identifiers follow the first appearance of names in source text, so that
+ * the fan-out of a wire may be anywhere in an array indexed by identifier.
+ * Breadth-first order starts from undriven wires. A unit is numbered once a
+ * wire it reads is, followed by its outputs, so that units reading the same
+ * wire and outputs of the same unit end up next to each other, in about the
+ * order an event-driven simulation visits them. Units not reached, such as
+ * loops without inputs, start new searches in identifier order.
+ */
+class Renumbering {
+public:
+    /** @brief Numbering in breadth-first order, or in identifier order if not
+     * `by_connectivity`. */
+    Renumbering(const std::map<WireId, Wire> &wires,
+                const std::map<UnitId, Unit> &units,
+                bool by_connectivity = true);
+
+    /** @brief Index of a wire, `NONE` if there is no such wire. */
+    uint32_t wire(WireId id) const
+        { return id < wire_index.size() ? wire_index[id] : NONE; }
+
+    /** @brief Index of a unit, `NONE` if there is no such unit. */
+    uint32_t unit(UnitId id) const
+        { return id < unit_index.size() ? unit_index[id] : NONE; }
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<WireId> wire_ids /**< identifier of every wire index */;
+    std::vector<UnitId> unit_ids /**< identifier of every unit index */;
+
+private:
+    std::vector<uint32_t> wire_index;
+    std::vector<uint32_t> unit_index;
+};
+
+
+#endif
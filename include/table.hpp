@@ -8,133 +8,179 @@
 #define TABLE_HPP
 
 
-#include "lex.hpp"
-
-#include <map>
-#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <utility>
 #include <vector>
 #include <ostream>
 
-class Draw /* defined in Xdraw.hpp */;
+class Lex /* defined in lex.hpp */;
+class Metadata;
 
 
 typedef size_t TableKeyId;
 
-/** @brief Semantic information for table value. */
-class TableValue {
-public:
-    virtual ~TableValue() = default;
-
-    virtual std::ostream &dump(std::ostream &os, const Lex &lex) const = 0;
-};
+/**
+ * @brief Point semantic information, which can either be a position of an unit
+ * (ident) or (x, y).
+ */
+struct TablePoint {
+    /** @brief `x` value marking the point as an ident, `y` holds its id. */
+    static const uint32_t IDENT = UINT32_MAX;
 
-/** @brief Decimal table value. */
-class TVNum : public TableValue {
-public:
-    TVNum(struct rdesc_node &);
+    /** @brief Whether coordinates fit a numeric point, `x` would read as
+     * `IDENT` otherwise. Tables with other points are rejected as invalid
+     * metadata. */
+    static bool fits(uintmax_t x, uintmax_t y)
+        { return x < IDENT && y <= UINT32_MAX; }
 
-    virtual ~TVNum() = default;
+    bool is_ident() const
+        { return x == IDENT; }
 
-    std::ostream &dump(std::ostream &os,
-                       [[maybe_unused]] const Lex &lex) const override
-        { os << decimal; return os; }
+    size_t ident_id() const
+        { return y; }
 
-    size_t decimal;
+    uint32_t x;
+    uint32_t y;
 };
 
-/**
- * @brief Point semantic information, which can either be a position of an unit
- * (ident) or (x, y).
- */
-class TVPoint : public TableValue {
-public:
-    virtual ~TVPoint() = default;
+/** @brief Range of points forming one polyline of a path. */
+struct TableSubpath {
+    uint32_t first;
+    uint32_t count;
 };
 
-/** @brief Position aliasing a port of an unit. */
-class TVPointIdent : public TVPoint {
-public:
-    TVPointIdent(struct rdesc_node &);
+/** @brief Semantic information for table value, tagged by its kind. */
+struct TableValue {
+    enum Kind : uint32_t { NUM, POINT, PATH };
 
-    virtual ~TVPointIdent() = default;
+    /** @brief Decimal value, throws `std::bad_cast` for other kinds. */
+    uint64_t as_num() const;
+    /** @brief Point value, throws `std::bad_cast` for other kinds. */
+    const TablePoint &as_point() const;
+    /** @brief Subpath range, throws `std::bad_cast` for other kinds. */
+    TableSubpath as_path() const;
 
-    std::ostream &dump(std::ostream &os, const Lex &lex) const override
-        { os << lex.ident_name(id) << " /*i" << id << "*/"; return os; }
+    Kind kind;
 
-    size_t id;
+    union {
+        uint64_t num;
+        TablePoint point;
+        TableSubpath path /**< range in `Metadata` subpaths */;
+    };
 };
 
-/** @brief Numeric position. */
-class TVPointNum : public TVPoint {
+/** @brief Path of an wire or shape of a lookup table. */
+class PathView {
 public:
-    TVPointNum(struct rdesc_node &);
+    class Iterator {
+    public:
+        Iterator(const PathView &view_, size_t i_)
+            : view { view_ }, i { i_ } {}
+
+        std::span<const TablePoint> operator*() const
+            { return view[i]; }
+        Iterator &operator++()
+            { i++; return *this; }
+        bool operator!=(const Iterator &other) const
+            { return i != other.i; }
 
-    virtual ~TVPointNum() = default;
+    private:
+        const PathView &view;
+        size_t i;
+    };
 
-    std::ostream &dump(std::ostream &os,
-                       [[maybe_unused]] const Lex &lex) const override
-        { os << "(" << x << ", " << y << ")"; return os; }
+    PathView(const Metadata &store_, TableSubpath range_)
+        : store { store_ }, range { range_ } {}
 
-    size_t x;
-    size_t y;
+    size_t size() const
+        { return range.count; }
+
+    std::span<const TablePoint> operator[](size_t i) const;
+
+    Iterator begin() const
+        { return Iterator { *this, 0 }; }
+    Iterator end() const
+        { return Iterator { *this, range.count }; }
+
+private:
+    const Metadata &store;
+    TableSubpath range;
 };
 
-/** @brief Path of an wire or shape of a lookup table. */
-class TVPath : public TableValue {
+/** @brief Extra information table for statements, a view into `Metadata`. */
+class Table {
 public:
-    TVPath(struct rdesc_node &);
+    Table() = default;
 
-    virtual ~TVPath() = default;
+    Table(const Metadata *store_, uint32_t first_, uint32_t count_)
+        : store { store_ }, first { first_ }, count { count_ } {}
 
-    std::ostream &dump(std::ostream &os, const Lex &lex) const override {
-        os << "[";
+    std::ostream &dump(std::ostream &os, const Lex &lex) const;
 
-        size_t j = 0;
-        for (auto &path : paths) {
-            size_t i = 0;
-            for (auto &point_ : path) {
-                TableValue *point = point_.get();
-                point->dump(os, lex);
+    /** @brief Returns value of the key or nullptr if it is not present. */
+    const TableValue *find(TableKeyId k) const;
 
-                if (i != path.size() - 1)
-                    os << ", ";
+    /** @brief Returns value of the key, throws `std::out_of_range` if absent. */
+    const TableValue &get(TableKeyId k) const;
 
-                i++;
-            }
+    /** @brief Path value of the key, throws like `get` and `as_path`. */
+    PathView path(TableKeyId k) const;
 
-            if (j != paths.size() - 1)
-                os << "; ";
+    size_t size() const
+        { return count; }
 
-            j++;
-        }
+    TableKeyId key(size_t i) const;
+    const TableValue &value(size_t i) const;
 
-        os << "]";
+private:
+    friend class Writer;
 
-        return os;
-    }
+    const Metadata *store {};
 
-    std::vector<std::vector<std::unique_ptr<TVPoint>>> paths;
+    uint32_t first {};
+    uint32_t count {};
 };
 
-/** @brief Extra information table for statements. */
-class Table {
+/**
+ * @brief Netlist-wide storage of tables.
+ *
+ * Keys of a table are stored sorted and contiguous, values are tagged unions
+ * and points of all paths share one buffer of coordinate pairs.
+ */
+class Metadata {
 public:
-    Table(std::map<TableKeyId, std::unique_ptr<TableValue>>  table_)
-        : table { std::move(table_) } {}
+    /** @brief Starts a path value, its points are added with `push_point`. */
+    void begin_path();
 
-    Table(Table &&other)
-        : table { std::move(other.table)} {}
+    void push_point(TablePoint point)
+        { points.push_back(point); }
 
-    std::ostream &dump(std::ostream &os, const Lex &lex) const;
+    /** @brief Closes current polyline and begins another in the same path. */
+    void break_path();
 
-    const TableValue &get(TableKeyId k) const
-        { return static_cast<const TableValue &>(*table.at(k).get()); }
+    TableValue end_path();
+
+    /** @brief Stores entries as a table, first occurrence of a key wins. */
+    Table commit(std::vector<std::pair<TableKeyId, TableValue>> &entries);
+
+    PathView path(const TableValue &value) const
+        { return PathView { *this, value.as_path() }; }
 
 private:
-    friend Draw;
+    friend Table;
+    friend PathView;
+
+    void close_subpath();
+
+    std::vector<uint32_t> keys;
+    std::vector<TableValue> values;
+    std::vector<TableSubpath> subpaths;
+    std::vector<TablePoint> points;
 
-    std::map<TableKeyId, std::unique_ptr<TableValue>> table;
+    uint32_t path_first {} /**< first subpath of the path being built */;
+    uint32_t subpath_first {} /**< first point of the polyline being built */;
 };
 
 
@@ -1,17 +1,23 @@
 #include "../include/Xapp.hpp"
 #include "../include/interpreter.hpp"
-#include "../include/table.hpp"
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 
-#include <exception>
-#include <iostream>
+#include <poll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 using std::jthread;
-using std::cerr;
+using std::string;
 
 
 Window create_window(App *app) {
@@ -52,137 +58,239 @@ void EvLoop::start() {
 }
 
 void EvLoop::toggle_wire(int x, int y) {
-    for (auto &wire : sim.wires) {
-        try {
-            auto &path =
-                dynamic_cast<const TVPath &>(wire.second.table.get(k_path));
-
-            auto *tip_ = dynamic_cast<const TVPointNum *>(path.paths[0][0].get());
-
-            if (tip_ != nullptr) {
-                auto &tip = *tip_;
-
-                if (x - draw.scale <= draw.scale_x(tip.x) &&
-                    draw.scale_x(tip.x) <= x + draw.scale &&
-                    y - draw.scale <= draw.scale_y(tip.y) &&
-                    draw.scale_y(tip.y) <= y + draw.scale
-                ) {
-                    sim.set_wire_state(wire.first, !wire.second.state);
-                    sim.stabilize();
-                }
+    for (const GeoTip &tip_ : draw.tips) {
+        const GeoPoint &tip = draw.points[tip_.point];
+
+        if (x - draw.scale <= draw.scale_x(tip.x) &&
+            draw.scale_x(tip.x) <= x + draw.scale &&
+            y - draw.scale <= draw.scale_y(tip.y) &&
+            draw.scale_y(tip.y) <= y + draw.scale
+        ) {
+            /* a second click before the frame takes the first back */
+            auto it = std::find_if(toggles.begin(), toggles.end(),
+                                   [&](auto &toggle) {
+                                       return toggle.first == tip_.wire_id;
+                                   });
+
+            if (it != toggles.end())
+                toggles.erase(it);
+            else
+                toggles.emplace_back(tip_.wire_id,
+                                     !sim.wires.at(tip_.wire_id).state);
+
+            dirty = true;
+        }
+    }
+}
+
+void EvLoop::wait_event(int timeout) {
+    while (!XPending(dpy.get())) {
+        struct pollfd fds[2] = {
+            { .fd = ConnectionNumber(dpy.get()), .events = POLLIN, .revents = 0 },
+            { .fd = reload.fd(), .events = POLLIN, .revents = 0 },
+        };
+
+        if (poll(fds, reload.fd() == -1 ? 1 : 2, timeout) == 0)
+            return;
+
+        if (fds[1].revents & POLLIN && reload.changed() && reload.reload(sim)) {
+            {
+                Profile::Timer timer { profile.get(), Phase::SIMULATE };
+                sim.stabilize();
             }
-        } catch (std::exception &) {
-            cerr << "Could not toggle wire!\n";
+
+            /* clicks were on wires of the old file */
+            toggles.clear();
+
+            draw.compile();
+            dirty = true;
+
+            return;
         }
     }
 }
 
 void EvLoop::run() {
-    Atom wm_delete_win = XInternAtom(dpy.get(), "WM_DELETE_WINDOW", False);
+    wm_delete_win = XInternAtom(dpy.get(), "WM_DELETE_WINDOW", False);
     XSetWMProtocols(dpy.get(), win, &wm_delete_win, 1);
 
     XSelectInput(dpy.get(), win,
-                 ExposureMask | ButtonPressMask |
+                 ExposureMask | StructureNotifyMask | ButtonPressMask |
                  KeyPressMask | KeyReleaseMask);
 
     XEvent ev;
-    bool quit = false;
-    bool ctrl_hold = false;
 
-    draw.redraw();
+    redraw();
 
     while (!quit) {
-        XNextEvent(dpy.get(), &ev);
+        /* once there is something to draw, waits no longer than the rest of
+         * the frame interval */
+        int timeout = -1;
+        if (dirty) {
+            auto left = last_frame + FRAME_INTERVAL - Clock::now();
+
+            timeout = std::max<int64_t>(0, std::chrono::ceil<
+                std::chrono::milliseconds>(left).count());
+        }
 
-        switch (ev.type) {
-        case Expose:
-            break;
+        wait_event(timeout);
 
-        case KeyPress:
-            switch (ev.xkey.keycode) {
-            case 37: // CTRL_L
-            case 105: // CTRL_R
-                ctrl_hold = true;
-                break;
-            case 19: // 0
-                draw.offset_x -= ev.xkey.x;
-                draw.offset_x *= 10 / draw.scale;
-                draw.offset_x += ev.xkey.x;
-                draw.offset_y -= ev.xkey.y;
-                draw.offset_y *= 10 / draw.scale;
-                draw.offset_y += ev.xkey.y;
-                draw.scale = 10;
-                break;
-            default:
-                break;
-            }
+        while (!quit && XPending(dpy.get())) {
+            XNextEvent(dpy.get(), &ev);
+            handle(ev);
+        }
+
+        if (dirty && Clock::now() >= last_frame + FRAME_INTERVAL)
+            redraw();
+    }
+
+    sim.set_activity(nullptr);
+}
+
+void EvLoop::handle(XEvent &ev) {
+    switch (ev.type) {
+    case Expose:
+        dirty = true;
+        break;
+
+    case ConfigureNotify:
+        draw.resize(ev.xconfigure.width, ev.xconfigure.height);
+        dirty = true;
+        break;
+
+    case KeyPress:
+        switch (ev.xkey.keycode) {
+        case 37: // CTRL_L
+        case 105: // CTRL_R
+            ctrl_hold = true;
+            break;
+        case 19: // 0
+            draw.offset_x -= ev.xkey.x;
+            draw.offset_x *= 10 / draw.scale;
+            draw.offset_x += ev.xkey.x;
+            draw.offset_y -= ev.xkey.y;
+            draw.offset_y *= 10 / draw.scale;
+            draw.offset_y += ev.xkey.y;
+            draw.scale = 10;
+            dirty = true;
             break;
+        default:
+            break;
+        }
+        break;
 
-        case KeyRelease:
-            switch (ev.xkey.keycode) {
-            case 37: // CTRL_L
-            case 105: // CTRL_R
-                ctrl_hold = false;
-                break;
-            }
+    case KeyRelease:
+        switch (ev.xkey.keycode) {
+        case 37: // CTRL_L
+        case 105: // CTRL_R
+            ctrl_hold = false;
             break;
+        }
+        break;
 
-        case ButtonPress:
-            if (ev.xbutton.button == 1) {
-                toggle_wire(ev.xbutton.x, ev.xbutton.y);
-                break;
+    case ButtonPress:
+        if (ev.xbutton.button == 1) {
+            toggle_wire(ev.xbutton.x, ev.xbutton.y);
+            break;
+        }
+        if (ctrl_hold) {
+            switch (ev.xbutton.button) {
+            case (4):
+                    draw.offset_x -= ev.xbutton.x;
+                    draw.offset_x *= 1.25;
+                    draw.offset_x += ev.xbutton.x;
+                    draw.offset_y -= ev.xbutton.y;
+                    draw.offset_y *= 1.25;
+                    draw.offset_y += ev.xbutton.y;
+
+                    draw.scale *= 1.25;
+                    dirty = true;
+                    break;
+            case (5):
+                    draw.offset_x -= ev.xbutton.x;
+                    draw.offset_x *= 0.8;
+                    draw.offset_x += ev.xbutton.x;
+                    draw.offset_y -= ev.xbutton.y;
+                    draw.offset_y *= 0.8;
+                    draw.offset_y += ev.xbutton.y;
+
+                    draw.scale *= 0.8;
+                    dirty = true;
+                    break;
+            default: break;
             }
-            if (ctrl_hold) {
-                switch (ev.xbutton.button) {
-                case (4):
-                        draw.offset_x -= ev.xbutton.x;
-                        draw.offset_x *= 1.25;
-                        draw.offset_x += ev.xbutton.x;
-                        draw.offset_y -= ev.xbutton.y;
-                        draw.offset_y *= 1.25;
-                        draw.offset_y += ev.xbutton.y;
-
-                        draw.scale *= 1.25;
-                        break;
-                case (5):
-                        draw.offset_x -= ev.xbutton.x;
-                        draw.offset_x *= 0.8;
-                        draw.offset_x += ev.xbutton.x;
-                        draw.offset_y -= ev.xbutton.y;
-                        draw.offset_y *= 0.8;
-                        draw.offset_y += ev.xbutton.y;
-
-                        draw.scale *= 0.8;
-                        break;
-                default: break;
-                }
-            } else {
-                switch (ev.xbutton.button) {
-                case (4):
-                        draw.offset_y += draw.scale;
-                        break;
-                case (5):
-                        draw.offset_y -= draw.scale;
-                        break;
-                case (6):
-                        draw.offset_x += draw.scale;
-                        break;
-                case (7):
-                        draw.offset_x -= draw.scale;
-                        break;
-                default: break;
-                }
+        } else {
+            switch (ev.xbutton.button) {
+            case (4):
+                    draw.offset_y += draw.scale;
+                    dirty = true;
+                    break;
+            case (5):
+                    draw.offset_y -= draw.scale;
+                    dirty = true;
+                    break;
+            case (6):
+                    draw.offset_x += draw.scale;
+                    dirty = true;
+                    break;
+            case (7):
+                    draw.offset_x -= draw.scale;
+                    dirty = true;
+                    break;
+            default: break;
             }
-            break;
+        }
+        break;
 
-        case ClientMessage:
-            if (Atom(ev.xclient.data.l[0]) == wm_delete_win)
-                quit = true;
-            break;
+    case ClientMessage:
+        if (Atom(ev.xclient.data.l[0]) == wm_delete_win)
+            quit = true;
+        break;
 
-        default: break;  // GCOVR_EXCL_LINE
-        }
+    default: break;  // GCOVR_EXCL_LINE
+    }
+}
+
+void EvLoop::redraw() {
+    if (toggles.size()) {
+        Profile::Timer timer { profile.get(), Phase::SIMULATE };
 
+        auto evaluations = sim.evaluation_count();
+        auto start = Clock::now();
+
+        sim.apply(toggles);
+        toggles.clear();
+
+        std::chrono::duration<double> seconds = Clock::now() - start;
+        evaluation_rate = (sim.evaluation_count() - evaluations) /
+            std::max(seconds.count(), 1e-9);
+    }
+
+    auto start = Clock::now();
+
+    {
+        Profile::Timer timer { profile.get(), Phase::DRAW };
         draw.redraw();
     }
+
+    last_frame = Clock::now();
+    frame_time = last_frame - start;
+    dirty = false;
+
+    if (hud)
+        draw_hud();
+}
+
+void EvLoop::draw_hud() {
+    std::chrono::duration<double, std::milli> ms = frame_time;
+
+    std::ostringstream frame, primitives, rate;
+    frame << std::fixed << std::setprecision(2) << "frame " << ms.count() <<
+        " ms";
+    primitives << draw.primitive_count() << " primitives";
+    rate << std::fixed << std::setprecision(0) << "simulation " <<
+        evaluation_rate << " evaluations/s";
+
+    string text[] = { frame.str(), primitives.str(), rate.str() };
+    draw.overlay(text);
 }
@@ -1,103 +1,371 @@
 #include "../include/Xdraw.hpp"
 #include "../include/interpreter.hpp"
 #include "../include/core.hpp"
+#include "../include/lex.hpp"
+#include "../include/table.hpp"
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
 
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <typeinfo>
 #include <utility>
 #include <vector>
 
 using std::vector;
 using std::cerr;
-using std::unique_ptr;
+using std::span;
 
 
 #define p(x_, y_) scale_x(x_), scale_y(y_)
 
-void Draw::redraw() const {
+bool ShmImage::supported(Display *dpy) {
+    return XShmQueryExtension(dpy);
+}
+
+/* set by `trap_error` while attaching, as attaching fails asynchronously on
+ * servers that cannot reach our memory */
+static bool attach_failed;
+
+static int trap_error(Display *, XErrorEvent *) {
+    attach_failed = true;
+
+    return 0;
+}
+
+bool ShmImage::resize(int width, int height) {
+    if (image && image->width == width && image->height == height)
+        return true;
+
+    release();
+
+    image = XShmCreateImage(dpy, XDefaultVisualOfScreen(scr),
+                            XDefaultDepthOfScreen(scr), ZPixmap, nullptr,
+                            &info, width, height);
+
+    int byte_order = std::endian::native == std::endian::little ?
+        LSBFirst : MSBFirst;
+
+    if (!image || image->bits_per_pixel != 32 ||
+        image->byte_order != byte_order) {
+        release();
+
+        return false;
+    }
+
+    info.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height,
+                        IPC_CREAT | 0600);
+
+    if (info.shmid == -1) {
+        release();
+
+        return false;
+    }
+
+    info.shmaddr = image->data = static_cast<char *>(shmat(info.shmid,
+                                                           nullptr, 0));
+    info.readOnly = False;
+
+    if (info.shmaddr != reinterpret_cast<char *>(-1)) {
+        attach_failed = false;
+        auto handler = XSetErrorHandler(trap_error);
+
+        attached = XShmAttach(dpy, &info);
+        XSync(dpy, False);
+
+        XSetErrorHandler(handler);
+        attached = attached && !attach_failed;
+    } else {
+        info.shmaddr = image->data = nullptr;
+    }
+
+    /* the segment is freed once both sides detach it */
+    shmctl(info.shmid, IPC_RMID, nullptr);
+
+    if (!attached) {
+        release();
+
+        return false;
+    }
+
+    return true;
+}
+
+void ShmImage::put(Window win, GC gc) const {
+    XShmPutImage(dpy, win, gc, image, 0, 0, 0, 0,
+                 image->width, image->height, False);
+
+    /* the next frame is drawn into the same memory */
+    XSync(dpy, False);
+}
+
+void ShmImage::release() {
+    if (!image)
+        return;
+
+    if (attached) {
+        XShmDetach(dpy, &info);
+        XSync(dpy, False);
+    }
+
+    if (info.shmaddr)
+        shmdt(info.shmaddr);
+
+    image->data = nullptr;
+    XDestroyImage(image);
+
+    image = nullptr;
+    info = {};
+    attached = false;
+}
+
+
+bool Draw::use_raster() {
+    if (!ShmImage::supported(dpy.get())) {
+        cerr << "Warning: MIT-SHM is not available, drawing with Xlib.\n";
+
+        return false;
+    }
+
+    XWindowAttributes attributes;
+    XGetWindowAttributes(dpy.get(), win, &attributes);
+    resize(attributes.width, attributes.height);
+
+    shm = std::make_unique<ShmImage>(dpy.get(), scr);
+
+    return true;
+}
+
+void Draw::redraw() {
+    if (shm && !redraw_raster()) {
+        cerr << "Warning: MIT-SHM image cannot be attached, drawing with "
+            "Xlib.\n";
+
+        shm.reset();
+    }
+
+    if (!shm)
+        redraw_xlib();
+}
+
+bool Draw::redraw_raster() {
+    if (!shm->resize(std::max(width, 1), std::max(height, 1)))
+        return false;
+
+    float radius = static_cast<unsigned>((scale + 4) / 4) / 2.f;
+
+    /* pixel centers are half a pixel past X coordinates */
+    auto x_of = [&](double x) { return offset_x + x * scale + 0.5f; };
+    auto y_of = [&](double y) { return offset_y + y * scale + 0.5f; };
+
+    auto color = [&](const bool *state) {
+        return static_cast<uint32_t>(state && *state ? active_color.pixel :
+                                     inactive_color.pixel);
+    };
+
+    raster.begin(shm->pixels(), shm->width(), shm->height(), shm->stride(),
+                 XWhitePixelOfScreen(scr));
+
+    auto draw_lines = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const GeoLine &line = lines[i];
+            const GeoPoint *at = &points[line.first];
+
+            for (size_t j = 0; j + 1 < std::max<size_t>(line.count, 2); j++) {
+                const GeoPoint &to = at[std::min(j + 1, line.count - 1)];
+
+                raster.capsule(x_of(at[j].x), y_of(at[j].y),
+                               x_of(to.x), y_of(to.y), radius,
+                               color(line.state));
+            }
+        }
+    };
+
+    draw_lines(0, wire_line_count);
+
+    for (const GeoDot &dot : dots) {
+        const GeoPoint &at = points[dot.point];
+
+        raster.capsule(x_of(at.x), y_of(at.y), x_of(at.x), y_of(at.y),
+                       scale / 2, color(dot.state));
+    }
+
+    draw_lines(wire_line_count, lines.size());
+
+    raster.end();
+    shm->put(win, gc);
+
+    primitives = raster.capsule_count();
+
+    return true;
+}
+
+void Draw::redraw_xlib() {
     XClearWindow(dpy.get(), win);
 
     XSetLineAttributes(dpy.get(), gc, (scale + 4) / 4, LineSolid, CapRound, JoinRound);
 
-    for (const auto &wire : intr->wires) {
+    screen_points.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        screen_points[i] = XPoint(p(points[i].x, points[i].y));
+
+    auto set_color = [&](const bool *state) {
         XSetForeground(dpy.get(), gc,
-                       wire.second.state ? active_color.pixel : inactive_color.pixel);
+                       state && *state ? active_color.pixel : inactive_color.pixel);
+    };
+
+    auto draw_lines = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const GeoLine &line = lines[i];
+
+            set_color(line.state);
+            XDrawLines(dpy.get(), win, gc,
+                       &screen_points[line.first], line.count, CoordModeOrigin);
+        }
+    };
+
+    draw_lines(0, wire_line_count);
+
+    for (const GeoDot &dot : dots) {
+        const GeoPoint &at = points[dot.point];
+
+        set_color(dot.state);
+        XFillArc(dpy.get(), win, gc,
+                 p(at.x - 0.5, at.y - 0.5),
+                 scale, scale, 0, 360 * 64);
+    }
+
+    draw_lines(wire_line_count, lines.size());
+
+    primitives = lines.size() + dots.size();
+
+    XFlush(dpy.get());
+}
+
+void Draw::overlay(span<const std::string> text) {
+    const int LINE_HEIGHT = 14;
+
+    XSetForeground(dpy.get(), gc, XBlackPixelOfScreen(scr));
+    XSetBackground(dpy.get(), gc, XWhitePixelOfScreen(scr));
+
+    /* image strings fill their background, so lines stay readable over
+     * wires */
+    for (size_t i = 0; i < text.size(); i++)
+        XDrawImageString(dpy.get(), win, gc, 4, LINE_HEIGHT * (i + 1),
+                         text[i].data(), text[i].size());
+
+    XFlush(dpy.get());
+}
+
+void Draw::compile() {
+    points.clear();
+    lines.clear();
+    dots.clear();
+    tips.clear();
+
+    /* drops everything an element emitted before its metadata turned out to
+     * be invalid */
+    auto rollback = [&](size_t p, size_t l, size_t d, size_t t) {
+        points.resize(p);
+        lines.resize(l);
+        dots.resize(d);
+        tips.resize(t);
+    };
+
+    for (const auto &wire : intr->wires) {
+        size_t p = points.size(), l = lines.size(),
+               d = dots.size(), t = tips.size();
 
         try {
-            draw(wire.second);
+            compile(wire.second);
         } catch (std::bad_cast &) {
+            rollback(p, l, d, t);
             cerr << "Warning: Skipping wire " << lex->ident_name(wire.second.id)
                 << " has invalid metadata type.\n";
         } catch (std::out_of_range &) {
+            rollback(p, l, d, t);
             cerr << "Warning: Skipping wire " << lex->ident_name(wire.second.id)
                 << " missing required metadata.\n";
         }
     }
 
+    wire_line_count = lines.size();
+
     for (const auto &unit : intr->units) {
-        XSetForeground(dpy.get(), gc, inactive_color.pixel);
+        size_t p = points.size(), l = lines.size();
 
         try {
-            draw(unit.second);
+            compile(unit.second);
         } catch (std::bad_cast &) {
+            rollback(p, l, dots.size(), tips.size());
             cerr << "Warning: Skipping unit " << lex->ident_name(unit.second.id)
                 << " has invalid metadata type.\n";
         } catch (std::out_of_range &) {
+            rollback(p, l, dots.size(), tips.size());
             cerr << "Warning: Skipping unit " << lex->ident_name(unit.second.id)
                 << " missing required metadata.\n";
         }
     }
-
-    XFlush(dpy.get());
 }
 
-void Draw::draw(const Lut &lut, int x, int y) const {
-    auto &shape = dynamic_cast<const TVPath &>(lut.table.get(k_shape));
+/* numeric point of a table, ident points are not valid where this used */
+static const TablePoint &num_point(const TablePoint &point) {
+    if (point.is_ident())
+        throw std::bad_cast();
 
-    for (auto &path : shape.paths) {
-        vector<XPoint> points;
+    return point;
+}
+
+void Draw::compile(const Lut &lut, int x, int y) {
+    for (auto path : lut.table.path(k_shape)) {
+        size_t first = points.size();
 
         for (auto &point : path) {
-            auto &num_point = dynamic_cast<const TVPointNum &>(*point.get());
+            num_point(point);
 
-            points.push_back(XPoint(p(x + num_point.x, y + num_point.y)));
+            points.push_back(GeoPoint(x + point.x, y + point.y));
         }
 
-        XDrawLines(dpy.get(), win, gc,
-                   &points[0], points.size(), CoordModeOrigin);
+        lines.push_back(GeoLine(first, path.size(), nullptr));
     }
 }
 
-void Draw::draw(const Wire &wire,
-                const vector<unique_ptr<TVPoint>> &path) const {
-    vector<XPoint> points;
+void Draw::compile(const Wire &wire, span<const TablePoint> path) {
+    size_t first = points.size();
 
     size_t i = 0;
     for (auto &point : path) {
-        auto ident_point_ptr = dynamic_cast<const TVPointIdent *>(point.get());
-
-        if (ident_point_ptr != nullptr) {
+        if (point.is_ident()) {
             /* automatically connect wire to unit's port if an ident present
              * in path*/
-            auto ident_point = &*ident_point_ptr;
 
             /* unit wire connected to and its lut */
-            auto &unit = intr->units.at(ident_point->id);
+            auto &unit = intr->units.at(point.ident_id());
             auto &lut = intr->luts.at(unit.lut_id);
 
-            auto &unit_pos = dynamic_cast<const TVPointNum &>(unit.table.get(k_pos));
+            auto &unit_pos = num_point(unit.table.get(k_pos).as_point());
 
             auto get_port_position = [&](TableKeyId key, auto port_index) {
-                auto &port_path = dynamic_cast<const TVPath &>(lut.table.get(key));
-                auto &point = *port_path.paths[0][port_index].get();
-                auto &num_point = dynamic_cast<const TVPointNum &>(point);
-                points.push_back(XPoint(p(num_point.x + unit_pos.x,
-                                          num_point.y + unit_pos.y)));
+                auto ports = lut.table.path(key)[0];
+
+                if (port_index >= ports.size())
+                    throw std::out_of_range("no such port");
+
+                auto &port = num_point(ports[port_index]);
+                points.push_back(GeoPoint(port.x + unit_pos.x,
+                                          port.y + unit_pos.y));
             };
 
             for (size_t i = 0; i < unit.input_wires.size(); i++)
@@ -109,35 +377,37 @@ void Draw::draw(const Wire &wire,
                     get_port_position(k_output, i);
         } else {
             /* add point otherwise */
-            auto &num_point = dynamic_cast<const TVPointNum &>(*point.get());
-
-            points.push_back(XPoint(p(num_point.x, num_point.y)));
+            points.push_back(GeoPoint(point.x, point.y));
 
-            if (i == 0 || i == path.size() - 1) {
-                XFillArc(dpy.get(), win, gc,
-                         p(num_point.x - 0.5, num_point.y - 0.5),
-                         scale, scale, 0, 360 * 64);
-            }
+            if (i == 0 || i == path.size() - 1)
+                dots.push_back(GeoDot(points.size() - 1, &wire.state));
         }
 
         i++;
     }
 
-    XDrawLines(dpy.get(), win, gc, &points[0], points.size(), CoordModeOrigin);
+    if (points.size() > first)
+        lines.push_back(GeoLine(first, points.size() - first, &wire.state));
 }
 
-void Draw::draw(const Wire &wire) const {
-    auto &paths = dynamic_cast<const TVPath &>(wire.table.get(k_path));
+void Draw::compile(const Wire &wire) {
+    auto paths = wire.table.path(k_path);
+
+    size_t first = points.size();
+
+    for (auto path : paths)
+        compile(wire, path);
 
-    for (auto &path : paths.paths)
-        draw(wire, path);
+    /* a numeric first point is emitted first, it is the tip of the wire */
+    if (!paths[0][0].is_ident())
+        tips.push_back(GeoTip(first, wire.id));
 }
 
-void Draw::draw(const Unit &unit) const {
-    auto &pos = dynamic_cast<const TVPointNum &>(unit.table.get(k_pos));
+void Draw::compile(const Unit &unit) {
+    auto &pos = num_point(unit.table.get(k_pos).as_point());
 
-    draw(intr->luts.at(unit.lut_id),
-         static_cast<int>(pos.x), static_cast<int>(pos.y));
+    compile(intr->luts.at(unit.lut_id),
+            static_cast<int>(pos.x), static_cast<int>(pos.y));
 }
 
 void Draw::init_key_ids() {
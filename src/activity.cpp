@@ -0,0 +1,73 @@
+#include "../include/activity.hpp"
+#include "../include/lex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+using std::vector;
+using std::ostream;
+
+
+void Activity::begin(const std::map<WireId, Wire> &wires, uint64_t now) {
+    start = stop = now;
+
+    size_t size = wires.empty() ? 0 : wires.rbegin()->first + 1;
+
+    wire_ids.clear();
+    toggles.assign(size, 0);
+    high_time.assign(size, 0);
+    level.assign(size, 0);
+
+    /* wires at 1 rise as counting starts */
+    for (auto &[id, wire] : wires) {
+        wire_ids.push_back(id);
+        level[id] = wire.state;
+        high_time[id] = wire.state ? -now : 0;
+    }
+}
+
+void Activity::fit(WireId id) {
+    toggles.resize(id + 1);
+    high_time.resize(id + 1);
+    level.resize(id + 1);
+}
+
+vector<uint64_t> Activity::time_at_1(uint64_t now) const {
+    vector<uint64_t> res(high_time.size());
+
+    for (size_t i = 0; i < res.size(); i++)
+        res[i] = high_time[i] + level[i] * now;
+
+    return res;
+}
+
+ostream &Activity::dump_saif(ostream &os, const Lex &lex) const {
+    uint64_t duration = stop - start;
+    auto t1 = time_at_1(stop);
+
+    os << "(SAIFILE\n"
+          "  (SAIFVERSION \"2.0\")\n"
+          "  (DIRECTION \"backward\")\n"
+          "  (PROGRAM_NAME \"acme\")\n"
+          "  (DIVIDER / )\n"
+          "  (TIMESCALE 1 ns)\n"
+          "  (DURATION " << duration << ")\n"
+          "  (INSTANCE top\n"
+          "    (NET\n";
+
+    for (WireId id : wire_ids)
+        os << "      (" << lex.ident_name(id) << "\n"
+              "        (T0 " << duration - t1[id] << ") (T1 " << t1[id] <<
+              ") (TX 0)\n"
+              "        (TC " << toggles[id] << ") (IG 0)\n"
+              "      )\n";
+
+    os << "    )\n"
+          "  )\n"
+          ")\n";
+
+    return os;
+}
@@ -0,0 +1,92 @@
+#include "../include/bdd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::span;
+using std::unordered_map;
+using std::vector;
+
+
+Bdd::Bdd(span<const uint64_t> words, size_t word_count, size_t output_size) {
+    /* references of the subtables of every output at the current level, the
+     * first level being words */
+    vector<uint32_t> refs(words.size());
+    vector<Node> built;
+
+    unordered_map<uint64_t, uint32_t> leaf_ids;
+    for (size_t i = 0; i < words.size(); i++) {
+        auto [it, added] = leaf_ids.try_emplace(words[i], leaves.size());
+
+        if (added)
+            leaves.push_back(words[i]);
+
+        refs[i] = it->second | LEAF;
+    }
+
+    /* pairs of subtables differing in bit `var` of the word index, shared
+     * across outputs */
+    unordered_map<uint64_t, uint32_t> unique;
+    for (uint32_t var = 0; (size_t { 1 } << var) < word_count; var++) {
+        unique.clear();
+
+        for (size_t i = 0; i < refs.size() / 2; i++) {
+            uint32_t lo = refs[2 * i], hi = refs[2 * i + 1];
+
+            if (lo == hi) {
+                refs[i] = lo;
+                continue;
+            }
+
+            auto [it, added] = unique.try_emplace(uint64_t { lo } << 32 | hi,
+                                                  built.size());
+            if (added)
+                built.push_back({ var, { lo, hi } });
+
+            refs[i] = it->second;
+        }
+
+        refs.resize(refs.size() / 2);
+    }
+
+    /* nodes renumbered in depth-first order from the roots */
+    const uint32_t UNSEEN = UINT32_MAX;
+    vector<uint32_t> order(built.size(), UNSEEN);
+    vector<uint32_t> stack;
+
+    nodes.reserve(built.size());
+
+    for (size_t o = 0; o < output_size; o++) {
+        stack.push_back(refs[o]);
+
+        while (!stack.empty()) {
+            uint32_t ref = stack.back();
+            stack.pop_back();
+
+            if (ref & LEAF || order[ref] != UNSEEN)
+                continue;
+
+            order[ref] = nodes.size();
+            nodes.push_back(built[ref]);
+
+            stack.push_back(built[ref].next[1]);
+            stack.push_back(built[ref].next[0]);
+        }
+    }
+
+    auto renumber = [&](uint32_t ref) {
+        return ref & LEAF ? ref : order[ref];
+    };
+
+    for (auto &node : nodes)
+        for (uint32_t &child : node.next)
+            child = renumber(child);
+
+    roots.reserve(output_size);
+    for (size_t o = 0; o < output_size; o++)
+        roots.push_back(renumber(refs[o]));
+}
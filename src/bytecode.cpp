@@ -0,0 +1,421 @@
+#include "../include/bytecode.hpp"
+#include "../include/activity.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/profile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using std::vector, std::map, std::pair, std::span;
+
+
+Bytecode::Bytecode(const map<LutId, Lut> &luts,
+                   map<WireId, Wire> &wires,
+                   const map<UnitId, Unit> &units,
+                   uint64_t revision_, bool renumber)
+    : revision { revision_ }, numbering { wires, units, renumber } {
+    states.resize(numbering.wire_ids.size());
+    for (auto &[id, wire] : wires) {
+        states[numbering.wire(id)] = &wire.state;
+        ordered.push_back(numbering.wire(id));
+    }
+
+    values.resize(states.size());
+    pending.resize(states.size());
+    load();
+
+    vector<const Unit *> ordered(numbering.unit_ids.size());
+    for (auto &[id, unit] : units)
+        ordered[numbering.unit(id)] = &unit;
+
+    const void *const *labels = execute(nullptr, 0);
+    auto emit = [&](Slot slot) { code.push_back(slot); };
+
+    /* entry of every unit, by index */
+    vector<uint32_t> entry_of(ordered.size(), UINT32_MAX);
+
+    for (uint32_t u = 0; u < ordered.size(); u++) {
+        const Unit &unit = *ordered[u];
+        const Lut &lut = luts.at(unit.lut_id);
+
+        /* registers change only on clock edges */
+        if (lut.clocked)
+            continue;
+
+        entry_of[u] = entries.size();
+        entries.push_back(code.size());
+        entry_units.push_back(&unit);
+
+        for (uint32_t i = 0; i < unit.input_wires.size(); i++) {
+            uint32_t wire = numbering.wire(unit.input_wires[i]);
+
+            if (i == 0) {
+                emit({ .op = labels[FIRST] });
+                emit({ .num = wire });
+            } else {
+                emit({ .op = labels[LOAD] });
+                emit({ .num = wire });
+                emit({ .num = i });
+            }
+        }
+
+        for (uint32_t o = 0; o < unit.output_wires.size(); o++) {
+            uint32_t wire = numbering.wire(unit.output_wires[o]);
+            bool small = lut.input_size <= 6;
+
+            emit({ .op = labels[small ? STORE : STORE_WIDE] });
+            emit({ .num = wire });
+
+            if (small) {
+                emit({ .word = lut.word(o, 0) });
+            } else {
+                emit({ .lut = &lut });
+                emit({ .num = o });
+            }
+        }
+
+        emit({ .op = labels[NEXT] });
+    }
+
+    scheduled.resize(entries.size());
+
+    /* combinational readers of every wire in identifier order, which is the
+     * order of `Wire::affects` that `advance` evaluates, once each */
+    vector<uint32_t> last(states.size(), UINT32_MAX);
+    auto each_reader = [&](auto &&f) {
+        for (auto &[id, unit] : units) {
+            uint32_t entry = entry_of[numbering.unit(id)];
+
+            if (entry == UINT32_MAX)
+                continue;
+
+            for (WireId wire_id : unit.input_wires) {
+                uint32_t wire = numbering.wire(wire_id);
+
+                if (last[wire] != entry) {
+                    last[wire] = entry;
+                    f(wire, entry);
+                }
+            }
+        }
+
+        last.assign(last.size(), UINT32_MAX);
+    };
+
+    fanout_first.resize(states.size() + 1);
+    each_reader([&](uint32_t wire, uint32_t) { fanout_first[wire + 1]++; });
+
+    for (size_t i = 0; i < states.size(); i++)
+        fanout_first[i + 1] += fanout_first[i];
+
+    fanout.resize(fanout_first.back());
+    vector<uint32_t> fill { fanout_first.begin(), fanout_first.end() - 1 };
+    each_reader([&](uint32_t wire, uint32_t entry) {
+        fanout[fill[wire]++] = entry;
+    });
+}
+
+void Bytecode::load() {
+    for (size_t i = 0; i < states.size(); i++)
+        values[i] = *states[i];
+}
+
+void Bytecode::pack(vector<uint64_t> &words) const {
+    words.assign((ordered.size() + 63) / 64, 0);
+
+    for (size_t i = 0; i < ordered.size(); i++)
+        words[i / 64] |= uint64_t { values[ordered[i]] } << (i % 64);
+}
+
+void Bytecode::unpack(span<const uint64_t> words) {
+    for (size_t w = 0; w < words.size() && w * 64 < ordered.size(); w++) {
+        const uint32_t *wire = ordered.data() + w * 64;
+        size_t count = std::min<size_t>(ordered.size() - w * 64, 64);
+
+        uint64_t current = 0;
+        for (size_t i = 0; i < count; i++)
+            current |= uint64_t { values[wire[i]] } << i;
+
+        uint64_t mask = count == 64 ? UINT64_MAX :
+            (uint64_t { 1 } << count) - 1;
+
+        for (uint64_t diff = (current ^ words[w]) & mask; diff;
+             diff &= diff - 1) {
+            uint32_t at = wire[std::countr_zero(diff)];
+
+            values[at] ^= 1;
+            *states[at] = values[at];
+        }
+    }
+}
+
+inline void Bytecode::tally_unit(uint32_t entry) {
+    UnitTally &tally = unit_tallies[entry];
+
+    if (tally.evaluations++ == 0)
+        tallied_units.push_back(entry);
+}
+
+const void *const *Bytecode::execute(const uint32_t *batch, size_t size) {
+    static const void *const labels[OP_COUNT] = {
+        &&first, &&load, &&store, &&store_wide, &&next
+    };
+
+    if (!batch || size == 0)
+        return labels;
+
+    const uint32_t *end = batch + size;
+    const Slot *ip = code.data() + entries[*batch++];
+    size_t input_index = 0;
+
+    /* evaluations are counted by `step`, and here only those toggling an
+     * output, once each */
+    const bool counting = counters.profile || counters.activity;
+    const bool counting_units = counters.profile;
+    bool useful = false;
+
+    /* compares an output with the state of its wire, and on a toggle stores
+     * it and schedules the wire */
+    auto set = [&](uint32_t wire, bool value) {
+        if (values[wire] == value)
+            return;
+
+        WireId id = numbering.wire_ids[wire];
+        if (record && !(*recorded)[id]) {
+            (*recorded)[id] = true;
+            record->emplace_back(id, values[wire]);
+        }
+
+        values[wire] = value;
+
+        if (counting_units && !useful) {
+            unit_tallies[batch[-1]].useful++;
+            useful = true;
+        }
+
+        if (!pending[wire]) {
+            pending[wire] = true;
+            changed_wires.push_back(wire);
+        } else if (counting) {
+            /* toggled back by another driver, which the log keeps too */
+            changed_wires.push_back(wire);
+        }
+    };
+
+#define DISPATCH() goto *ip->op
+
+    DISPATCH();
+
+first:
+    input_index = values[ip[1].num];
+    ip += 2;
+    DISPATCH();
+
+load:
+    input_index |= size_t { values[ip[1].num] } << ip[2].num;
+    ip += 3;
+    DISPATCH();
+
+store:
+    set(ip[1].num, (ip[2].word >> input_index) & 1);
+    ip += 3;
+    DISPATCH();
+
+store_wide:
+    set(ip[1].num, ip[2].lut->lookup(input_index, ip[3].num));
+    ip += 4;
+    DISPATCH();
+
+next:
+    useful = false;
+
+    if (batch == end)
+        return labels;
+
+    input_index = 0;
+    ip = code.data() + entries[*batch++];
+    DISPATCH();
+
+#undef DISPATCH
+}
+
+void Bytecode::schedule(uint32_t wire) {
+    if (!pending[wire]) {
+        pending[wire] = true;
+        changed_wires.push_back(wire);
+    }
+}
+
+void Bytecode::apply(WireId id, bool state) {
+    uint32_t wire = numbering.wire(id);
+
+    if (wire == Renumbering::NONE)
+        throw std::out_of_range("unknown wire");
+
+    if (values[wire] != state) {
+        values[wire] = state;
+        schedule(wire);
+    }
+}
+
+size_t Bytecode::step() {
+    now++;
+
+    wires.swap(changed_wires);
+    changed_wires.clear();
+
+    /* union of fan-outs, so that each unit is evaluated once */
+    for (uint32_t wire : wires) {
+        pending[wire] = false;
+        *states[wire] = values[wire];
+
+        for (uint32_t r = fanout_first[wire]; r < fanout_first[wire + 1]; r++) {
+            uint32_t unit = fanout[r];
+
+            if (!scheduled[unit]) {
+                scheduled[unit] = true;
+                scheduled_units.push_back(unit);
+            }
+        }
+    }
+
+    /* units only schedule wires, so no unit is scheduled again while the
+     * batch runs */
+    for (uint32_t unit : scheduled_units) {
+        scheduled[unit] = false;
+
+        if (counters.profile)
+            tally_unit(unit);
+    }
+
+    size_t evaluated = scheduled_units.size();
+    execute(scheduled_units.data(), evaluated);
+    scheduled_units.clear();
+
+    if (counters.profile || counters.activity) {
+        toggle_log.insert(toggle_log.end(), changed_wires.begin(),
+                          changed_wires.end());
+        generation_ends.push_back(toggle_log.size());
+    }
+
+    return evaluated;
+}
+
+void Bytecode::toggled(vector<pair<WireId, bool>> &out) const {
+    for (uint32_t wire : changed_wires)
+        out.emplace_back(numbering.wire_ids[wire], values[wire]);
+}
+
+void Bytecode::flush() {
+    /* generations back from the last, each a generation after `base`, and
+     * wires toggled in them back from the states they ended in */
+    for (size_t g = generation_ends.size(); g-- > 0;) {
+        uint64_t at = base + g + 1;
+        size_t first = g ? generation_ends[g - 1] : 0;
+
+        for (size_t i = generation_ends[g]; i-- > first;) {
+            uint32_t wire = toggle_log[i];
+            WireTally &tally = wire_tallies[wire];
+
+            if (tally.toggles == 0) {
+                tally.end = values[wire];
+                tallied_wires.push_back(wire);
+            }
+
+            bool state = tally.end ^ (tally.toggles++ & 1);
+            tally.sum += state ? -at : at;
+        }
+    }
+
+    for (uint32_t wire : tallied_wires) {
+        WireTally &tally = wire_tallies[wire];
+        WireId id = numbering.wire_ids[wire];
+
+        if (counters.profile)
+            counters.profile->count_toggles(id, tally.toggles);
+
+        if (counters.activity)
+            counters.activity->toggle_sum(id, tally.toggles, tally.sum,
+                                          tally.end);
+
+        tally = {};
+    }
+
+    for (uint32_t entry : tallied_units) {
+        UnitTally &tally = unit_tallies[entry];
+
+        counters.profile->count_evaluations(*entry_units[entry],
+                                            tally.evaluations,
+                                            tally.evaluations - tally.useful);
+        tally = {};
+    }
+
+    toggle_log.clear();
+    generation_ends.clear();
+    tallied_wires.clear();
+    tallied_units.clear();
+
+    base = now;
+}
+
+Bytecode::Run Bytecode::stabilize(span<const WireId> changed,
+                                  vector<pair<WireId, bool>> *record_,
+                                  vector<bool> &recorded_,
+                                  const Counters &counters_) {
+    record = record_;
+    recorded = &recorded_;
+    counters = counters_;
+    now = base = counters.now;
+
+    /* allocated by the first run counted, and all zero between runs */
+    if ((counters.profile || counters.activity) && wire_tallies.empty()) {
+        wire_tallies.resize(values.size());
+        unit_tallies.resize(entries.size());
+    }
+
+    for (WireId id : changed) {
+        uint32_t wire = numbering.wire(id);
+
+        if (wire == Renumbering::NONE)
+            throw std::out_of_range("unknown wire");
+
+        schedule(wire);
+    }
+
+    Run run {};
+
+    for (; !changed_wires.empty(); run.generations++) {
+        if (toggle_log.size() >= FLUSH_TOGGLES)
+            flush();
+
+        run.evaluations += step();
+    }
+
+    flush();
+
+    record = nullptr;
+    recorded = nullptr;
+    counters = {};
+
+    return run;
+}
+
+Bytecode &Simulation::compile() const {
+    if (!bytecode || bytecode->revision != revision)
+        bytecode = std::make_shared<Bytecode>(luts, wires, units, revision,
+                                              renumbering);
+
+    return *bytecode;
+}
+
+void Simulation::reload_states() {
+    if (bytecode && bytecode->revision == revision)
+        bytecode->load();
+}
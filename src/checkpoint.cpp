@@ -0,0 +1,180 @@
+#include "../include/bytecode.hpp"
+#include "../include/checkpoint.hpp"
+#include "../include/interpreter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+using std::vector;
+using std::istream, std::ostream;
+
+
+static const char MAGIC[8] = { 'A', 'C', 'M', 'E', 'C', 'K', 'P', '2' };
+
+void Simulation::index_states() const {
+    if (states_revision == revision)
+        return;
+
+    states.clear();
+    states.reserve(wires.size());
+
+    /* FNV-1a of identifiers */
+    layout = 0xcbf29ce484222325;
+
+    for (auto &[id, wire] : wires) {
+        states.push_back(const_cast<bool *>(&wire.state));
+
+        layout ^= id;
+        layout *= 0x100000001b3;
+    }
+
+    for (auto &[id, _] : units) {
+        layout ^= id;
+        layout *= 0x100000001b3;
+    }
+
+    states_revision = revision;
+}
+
+Checkpoint Simulation::checkpoint() const {
+    index_states();
+
+    Checkpoint res;
+    res.time = time;
+    res.evaluations = evaluations;
+    res.cycles = cycles;
+    res.wire_count = wires.size();
+    res.unit_count = units.size();
+    res.layout = layout;
+
+    compile().pack(res.states);
+
+    res.changed_wires = changed_wires;
+    res.scheduled_units = scheduled_units;
+
+    return res;
+}
+
+void Simulation::restore(const Checkpoint &checkpoint) {
+    index_states();
+
+    if (checkpoint.wire_count != wires.size() ||
+        checkpoint.unit_count != units.size() ||
+        checkpoint.layout != layout ||
+        checkpoint.states.size() != (wires.size() + 63) / 64)
+        throw std::invalid_argument("checkpoint does not match netlist");
+
+    /* events of unknown objects would grow bitmaps to their identifiers */
+    for (WireId id : checkpoint.changed_wires)
+        if (!wires.contains(id))
+            throw std::invalid_argument("checkpoint does not match netlist");
+
+    for (UnitId id : checkpoint.scheduled_units)
+        if (!units.contains(id))
+            throw std::invalid_argument("checkpoint does not match netlist");
+
+    compile().unpack(checkpoint.states);
+
+    for (WireId id : changed_wires)
+        pending[id] = false;
+    for (UnitId id : scheduled_units)
+        scheduled[id] = false;
+
+    changed_wires = checkpoint.changed_wires;
+    scheduled_units = checkpoint.scheduled_units;
+
+    for (WireId id : changed_wires) {
+        fit(pending, id);
+        pending[id] = true;
+    }
+
+    for (UnitId id : scheduled_units) {
+        fit(scheduled, id);
+        scheduled[id] = true;
+    }
+
+    time = checkpoint.time;
+    evaluations = checkpoint.evaluations;
+    cycles = checkpoint.cycles;
+
+    if (activity)
+        activity->begin(wires, time);
+}
+
+
+template<typename T>
+static void write_words(ostream &os, const vector<T> &words) {
+    uint64_t size = words.size();
+
+    os.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    os.write(reinterpret_cast<const char *>(words.data()),
+             words.size() * sizeof(T));
+}
+
+template<typename T>
+static void read_words(istream &is, vector<T> &words, uint64_t limit) {
+    uint64_t size;
+
+    if (!is.read(reinterpret_cast<char *>(&size), sizeof(size)) ||
+        size > limit)
+        throw std::invalid_argument("malformed checkpoint");
+
+    /* grows as words arrive, a size alone allocates at most a chunk */
+    const uint64_t CHUNK = 1 << 16;
+    words.clear();
+
+    while (words.size() < size) {
+        size_t from = words.size();
+        words.resize(std::min(size, from + CHUNK));
+
+        if (!is.read(reinterpret_cast<char *>(words.data() + from),
+                     (words.size() - from) * sizeof(T)))
+            throw std::invalid_argument("malformed checkpoint");
+    }
+}
+
+ostream &Checkpoint::write(ostream &os) const {
+    uint64_t header[] = {
+        time, evaluations, cycles, wire_count, unit_count, layout
+    };
+
+    os.write(MAGIC, sizeof(MAGIC));
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    write_words(os, states);
+    write_words(os, changed_wires);
+    write_words(os, scheduled_units);
+
+    return os;
+}
+
+Checkpoint Checkpoint::read(istream &is) {
+    char magic[sizeof(MAGIC)];
+    uint64_t header[6];
+
+    if (!is.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !is.read(reinterpret_cast<char *>(header), sizeof(header)))
+        throw std::invalid_argument("malformed checkpoint");
+
+    Checkpoint res;
+    res.time = header[0];
+    res.evaluations = header[1];
+    res.cycles = header[2];
+    res.wire_count = header[3];
+    res.unit_count = header[4];
+    res.layout = header[5];
+
+    /* each wire is pending and each unit scheduled at most once */
+    read_words(is, res.states, (res.wire_count + 63) / 64);
+    read_words(is, res.changed_wires, res.wire_count);
+    read_words(is, res.scheduled_units, res.unit_count);
+
+    return res;
+}
@@ -0,0 +1,248 @@
+#include "../include/cycle.hpp"
+#include "../include/interpreter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using std::vector, std::map;
+
+
+Levelized::Levelized(const map<LutId, Lut> &luts,
+                     const map<WireId, Wire> &wires,
+                     const map<UnitId, Unit> &units,
+                     uint64_t revision_, bool renumber)
+    : revision { revision_ } {
+    Renumbering numbering { wires, units, renumber };
+
+    for (WireId id : numbering.wire_ids)
+        values.push_back(wires.at(id).state);
+
+    for (auto &[id, _] : wires)
+        slots.push_back(numbering.wire(id));
+
+    /* tables of wide luts would take megabytes each, and offsets past 32
+     * bits do not fit an op */
+    vector<uint32_t> table_of(luts.empty() ? 0 : luts.rbegin()->first + 1,
+                              NONE);
+    for (auto &[id, lut] : luts) {
+        if (lut.input_size > TABLE_INPUTS ||
+            tables.size() + lut.output_size * lut.input_variant_count() >
+            UINT32_MAX)
+            continue;
+
+        table_of[id] = tables.size();
+
+        for (size_t o = 0; o < lut.output_size; o++)
+            for (size_t m = 0; m < lut.input_variant_count(); m++)
+                tables.push_back(lut.lookup(m, o));
+    }
+
+    vector<Op> ops;
+    for (auto &[id, unit] : units) {
+        const Lut &lut = luts.at(unit.lut_id);
+
+        Op op {
+            table_of[unit.lut_id], static_cast<uint32_t>(ports.size()),
+            static_cast<uint32_t>(lut.input_size),
+            static_cast<uint32_t>(lut.output_size), &lut
+        };
+
+        for (WireId wire_id : unit.input_wires)
+            ports.push_back(numbering.wire(wire_id));
+        for (WireId wire_id : unit.output_wires)
+            ports.push_back(numbering.wire(wire_id));
+
+        if (lut.clocked) {
+            regs.push_back(op);
+            registers.push_back(id);
+        } else {
+            ops.push_back(op);
+        }
+    }
+
+    next.resize(regs.size() ? ports.size() : 0);
+
+    /* Kahn's algorithm, a unit is ready once all units driving its inputs
+     * are */
+    vector<size_t> drivers(values.size());
+    vector<size_t> reader_first(values.size() + 1);
+
+    for (auto &op : ops) {
+        for (uint32_t i = 0; i < op.input_size; i++)
+            reader_first[ports[op.first_port + i] + 1]++;
+        for (uint32_t o = 0; o < op.output_size; o++)
+            drivers[ports[op.first_port + op.input_size + o]]++;
+    }
+
+    for (size_t i = 0; i < values.size(); i++)
+        reader_first[i + 1] += reader_first[i];
+
+    vector<size_t> readers(reader_first.back());
+    vector<size_t> fill { reader_first.begin(), reader_first.end() - 1 };
+    vector<size_t> waiting(ops.size());
+
+    for (size_t u = 0; u < ops.size(); u++) {
+        for (uint32_t i = 0; i < ops[u].input_size; i++) {
+            uint32_t wire = ports[ops[u].first_port + i];
+
+            readers[fill[wire]++] = u;
+            waiting[u] += drivers[wire];
+        }
+    }
+
+    vector<size_t> order;
+    order.reserve(ops.size());
+
+    for (size_t u = 0; u < ops.size(); u++)
+        if (waiting[u] == 0)
+            order.push_back(u);
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto &op = ops[order[i]];
+
+        for (uint32_t o = 0; o < op.output_size; o++) {
+            uint32_t wire = ports[op.first_port + op.input_size + o];
+
+            for (size_t r = reader_first[wire]; r < reader_first[wire + 1]; r++)
+                if (--waiting[readers[r]] == 0)
+                    order.push_back(readers[r]);
+        }
+    }
+
+    loop = order.size() != ops.size();
+
+    /* units of loops, and units they drive, follow in declaration order */
+    if (loop)
+        for (size_t u = 0; u < ops.size(); u++)
+            if (waiting[u] != 0)
+                order.push_back(u);
+
+    comb.reserve(order.size());
+    for (size_t u : order)
+        comb.push_back(ops[u]);
+}
+
+/* evaluates `ops`, writing outputs through `out`, which is indexed by wires
+ * or by ports */
+template<bool by_port>
+static void evaluate(const std::vector<Levelized::Op> &ops,
+                     const uint8_t *values, const uint32_t *ports,
+                     const uint8_t *tables, uint8_t *out) {
+    for (auto &op : ops) {
+        const uint32_t *port = ports + op.first_port;
+
+        size_t index = 0;
+        for (uint32_t i = 0; i < op.input_size; i++)
+            index |= size_t { values[port[i]] } << i;
+
+        port += op.input_size;
+
+        for (uint32_t o = 0; o < op.output_size; o++) {
+            uint8_t value = op.table == Levelized::NONE ?
+                op.lut->lookup(index, o) :
+                tables[op.table + (o << op.input_size) + index];
+
+            if constexpr (by_port)
+                out[port - ports + o] = value;
+            else
+                out[port[o]] = value;
+        }
+    }
+}
+
+void Levelized::settle() {
+    evaluate<false>(comb, values.data(), ports.data(), tables.data(),
+                    values.data());
+}
+
+void Levelized::latch() {
+    evaluate<true>(regs, values.data(), ports.data(), tables.data(),
+                   next.data());
+
+    for (auto &op : regs) {
+        uint32_t outputs = op.first_port + op.input_size;
+
+        for (uint32_t o = 0; o < op.output_size; o++)
+            values[ports[outputs + o]] = next[outputs + o];
+    }
+}
+
+
+const Levelized &Simulation::levelize() const {
+    if (!levelized || levelized->revision != revision)
+        levelized = std::make_shared<Levelized>(luts, wires, units, revision,
+                                                renumbering);
+
+    return *levelized;
+}
+
+void Simulation::clock() {
+    stabilize();
+
+    vector<Stimulus> next;
+
+    for (UnitId id : levelize().registers) {
+        const Unit &unit = units.at(id);
+        const Lut &lut = luts.at(unit.lut_id);
+
+        size_t input_index = 0;
+        for (size_t i = 0; i < unit.input_wires.size(); i++)
+            input_index |= size_t { wires.at(unit.input_wires[i]).state } << i;
+
+        for (size_t i = 0; i < unit.output_wires.size(); i++)
+            next.emplace_back(unit.output_wires[i], lut.lookup(input_index, i));
+    }
+
+    evaluations += levelize().registers.size();
+    cycles++;
+
+    for (auto &[id, state] : next)
+        set_wire_state(id, state);
+
+    stabilize();
+}
+
+void Simulation::run_cycles(uint64_t n) {
+    /* counters observe every toggle, which only the event-driven path has */
+    if (profile || activity) {
+        for (uint64_t i = 0; i < n; i++)
+            clock();
+
+        return;
+    }
+
+    levelize();
+    index_states();
+
+    Levelized &lv = *levelized;
+
+    if (lv.loop)
+        throw std::invalid_argument("combinational loop");
+
+    for (size_t i = 0; i < states.size(); i++)
+        lv.values[lv.slots[i]] = *states[i];
+
+    /* pending events are covered, every unit is evaluated */
+    for (WireId id : changed_wires)
+        pending[id] = false;
+    changed_wires.clear();
+
+    lv.settle();
+    for (uint64_t i = 0; i < n; i++) {
+        lv.latch();
+        lv.settle();
+    }
+
+    for (size_t i = 0; i < states.size(); i++)
+        *states[i] = lv.values[lv.slots[i]];
+
+    reload_states();
+
+    evaluations += (n + 1) * lv.comb_count() + n * lv.registers.size();
+    cycles += n;
+    time += n;
+}
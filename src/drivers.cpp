@@ -0,0 +1,108 @@
+#include "../include/drivers.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+using std::vector, std::map, std::span;
+using std::ostream;
+
+
+Drivers::Drivers(const map<WireId, Wire> &wires,
+                 const map<UnitId, Unit> &units_,
+                 uint64_t revision_)
+    : revision { revision_ }, units { units_ } {
+    size_t size = wires.empty() ? 0 : wires.rbegin()->first + 1;
+
+    first.resize(size + 1);
+    for (auto &[_, unit] : units)
+        for (WireId id : unit.output_wires)
+            first[id + 1]++;
+
+    for (size_t i = 0; i < size; i++)
+        first[i + 1] += first[i];
+
+    ports.resize(first.back());
+    vector<size_t> fill { first.begin(), first.end() - 1 };
+
+    for (auto &[id, unit] : units)
+        for (size_t pin = 0; pin < unit.output_wires.size(); pin++)
+            ports[fill[unit.output_wires[pin]]++] = { id, pin };
+
+    for (auto &[id, wire] : wires) {
+        size_t count = first[id + 1] - first[id];
+
+        if (count > 1)
+            multiply_driven.push_back(id);
+        else if (count == 0 && wire.affects.empty())
+            floating.push_back(id);
+    }
+}
+
+vector<UnitId> Drivers::cone(span<const WireId> wires) const {
+    vector<bool> seen_wire(first.size());
+    vector<bool> seen_unit(units.empty() ? 0 : units.rbegin()->first + 1);
+    vector<WireId> stack;
+    vector<UnitId> res;
+
+    for (WireId id : wires)
+        if (id < seen_wire.size() && !seen_wire[id]) {
+            seen_wire[id] = true;
+            stack.push_back(id);
+        }
+
+    while (!stack.empty()) {
+        WireId wire_id = stack.back();
+        stack.pop_back();
+
+        for (auto &port : of(wire_id)) {
+            if (seen_unit[port.unit])
+                continue;
+
+            seen_unit[port.unit] = true;
+            res.push_back(port.unit);
+
+            for (WireId id : units.at(port.unit).input_wires)
+                if (!seen_wire[id]) {
+                    seen_wire[id] = true;
+                    stack.push_back(id);
+                }
+        }
+    }
+
+    std::sort(res.begin(), res.end());
+
+    return res;
+}
+
+ostream &Drivers::dump_problems(ostream &os, const Lex &lex) const {
+    for (WireId id : multiply_driven) {
+        os << "Warning: wire " << lex.ident_name(id) << " is driven by";
+
+        for (auto &port : of(id))
+            os << " " << lex.ident_name(port.unit) << "[" << port.pin << "]";
+
+        os << "\n";
+    }
+
+    for (WireId id : floating)
+        os << "Warning: wire " << lex.ident_name(id) <<
+            " is neither driven nor read\n";
+
+    return os;
+}
+
+
+const Drivers &Interpreter::drivers() const {
+    if (!driver_index || driver_index->revision != revision)
+        driver_index = std::make_shared<Drivers>(wires, units, revision);
+
+    return *driver_index;
+}
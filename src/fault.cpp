@@ -0,0 +1,711 @@
+#include "../include/fault.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/placement.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::vector, std::span;
+using std::string;
+using std::ostream;
+
+
+static const uint64_t ALL = ~uint64_t {};
+
+/**
+ * @brief Word-parallel state of 64 faulty machines. Every lane runs the
+ * patterns from the first on its own, and takes the next fault once its own
+ * is detected or the patterns end.
+ */
+class FaultSim::Machine {
+public:
+    Machine(const FaultSim &fs_)
+        : fs { fs_ },
+          state(fs.wire_ids.size()),
+          next_state(fs.wire_ids.size()), stimulated(fs.wire_ids.size()),
+          scheduled((fs.units.size() + 63) / 64) {
+        for (bool value : { false, true }) {
+            wire_stuck[value].resize(fs.wire_ids.size());
+            input_stuck[value].resize(fs.inputs.size());
+            output_stuck[value].resize(fs.outputs.size());
+        }
+    }
+
+    /** @brief What the good machine does under a pattern set. */
+    struct Response {
+        vector<vector<std::pair<size_t, bool>>> patterns /**< with dense
+                                                             wire indices */;
+        /* states as words of all or no lanes: settled state of every wire,
+         * and observed wires after every pattern, one row of `fs.observed`
+         * after another */
+        vector<uint64_t> initial;
+        vector<uint64_t> observed;
+    };
+
+    Response respond(span<const Pattern> patterns) {
+        Response res;
+
+        for (auto &pattern : patterns) {
+            auto &dense = res.patterns.emplace_back();
+
+            for (auto &[id, value] : pattern)
+                dense.emplace_back(fs.index_of(id), value);
+        }
+
+        for (size_t i = 0; i < state.size(); i++)
+            state[i] = fs.initial[i] ? ALL : 0;
+
+        /* initial states need not agree with units */
+        for (size_t i = 0; i < fs.units.size(); i++)
+            schedule(i);
+
+        settle();
+
+        for (size_t i = 0; i < state.size(); i++)
+            res.initial.push_back(state[i] & 1 ? ALL : 0);
+
+        for (auto &pattern : res.patterns) {
+            for (auto &[wire, value] : pattern)
+                set(wire, value ? ALL : 0);
+
+            settle();
+
+            for (size_t i : fs.observed)
+                res.observed.push_back(state[i] & 1 ? ALL : 0);
+        }
+
+        return res;
+    }
+
+    /**
+     * @brief Takes faults from `next` on, until none is left, and marks the
+     * ones whose observed wires differ from `good` after some pattern.
+     */
+    void run(span<const Fault> faults, std::atomic<size_t> &next,
+             const Response &good, vector<uint8_t> &detected) {
+        size_t observed = fs.observed.size();
+        uint64_t busy = 0;
+        bool drained = false;
+
+        while (true) {
+            /* free lanes take a new fault, from the settled initial state */
+            uint64_t fresh = 0;
+            for (size_t lane = 0; lane < LANES && !drained; lane++) {
+                if (busy >> lane & 1)
+                    continue;
+
+                size_t f = next++;
+                if (f >= faults.size()) {
+                    drained = true;
+                    break;
+                }
+
+                lane_fault[lane] = f;
+                lane_pattern[lane] = 0;
+
+                busy |= uint64_t { 1 } << lane;
+                fresh |= uint64_t { 1 } << lane;
+            }
+
+            if (!busy)
+                break;
+
+            if (fresh)
+                restart(faults, fresh, good.initial);
+
+            /* lanes at the same pattern are applied and compared together */
+            auto groups = group(busy);
+
+            /* stimuli of every group are merged, and set once per wire */
+            for (auto &[p, lanes] : groups) {
+                for (auto &[wire, value] : good.patterns[p]) {
+                    if (!stimulated[wire]) {
+                        stimulated[wire] = true;
+                        stimuli.push_back(wire);
+                        next_state[wire] = state[wire];
+                    }
+
+                    next_state[wire] = (next_state[wire] & ~lanes) |
+                        (lanes & -uint64_t { value });
+                }
+            }
+
+            for (size_t wire : stimuli) {
+                stimulated[wire] = false;
+                set(wire, next_state[wire]);
+            }
+            stimuli.clear();
+
+            settle();
+
+            for (auto &[p, lanes] : groups) {
+                const uint64_t *expected = &good.observed[p * observed];
+
+                uint64_t differ = 0;
+                for (size_t i = 0; i < observed; i++)
+                    differ |= state[fs.observed[i]] ^ expected[i];
+
+                for (size_t lane = 0; lane < LANES; lane++) {
+                    if (!(lanes >> lane & 1))
+                        continue;
+
+                    bool found = differ >> lane & 1;
+
+                    if (found)
+                        detected[lane_fault[lane]] = true;
+
+                    if (found ||
+                        ++lane_pattern[lane] == good.patterns.size()) {
+                        eject(faults[lane_fault[lane]], lane);
+                        busy &= ~(uint64_t { 1 } << lane);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    uint64_t &mask(const Fault &fault) {
+        switch (fault.site) {
+        case Fault::WIRE:
+            return wire_stuck[fault.value][fs.index_of(fault.id)];
+        case Fault::INPUT:
+            return input_stuck[fault.value][
+                fs.units[fs.unit_index[fault.id]].first_input + fault.pin
+            ];
+        default:
+            return output_stuck[fault.value][
+                fs.units[fs.unit_index[fault.id]].first_output + fault.pin
+            ];
+        }
+    }
+
+    void inject(const Fault &fault, size_t lane)
+        { mask(fault) |= uint64_t { 1 } << lane; }
+
+    void eject(const Fault &fault, size_t lane)
+        { mask(fault) &= ~(uint64_t { 1 } << lane); }
+
+    /* pattern every busy lane is at, with the lanes at it */
+    vector<std::pair<size_t, uint64_t>> group(uint64_t busy) const {
+        vector<std::pair<size_t, uint64_t>> res;
+
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if (!(busy >> lane & 1))
+                continue;
+
+            auto it = std::find_if(res.begin(), res.end(), [&](auto &g) {
+                return g.first == lane_pattern[lane];
+            });
+
+            if (it == res.end())
+                it = res.emplace(res.end(), lane_pattern[lane], 0);
+
+            it->second |= uint64_t { 1 } << lane;
+        }
+
+        return res;
+    }
+
+    /*
+     * `lanes` take the settled state of the good machine, and only units
+     * around their new faults are evaluated, as every other one already
+     * agrees with its inputs
+     */
+    void restart(span<const Fault> faults, uint64_t lanes,
+                 const vector<uint64_t> &initial) {
+        for (size_t i = 0; i < state.size(); i++)
+            state[i] = (state[i] & ~lanes) | (initial[i] & lanes);
+
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if (!(lanes >> lane & 1))
+                continue;
+
+            auto &fault = faults[lane_fault[lane]];
+            inject(fault, lane);
+
+            if (fault.site == Fault::WIRE) {
+                size_t wire = fs.index_of(fault.id);
+                set(wire, state[wire]);
+            } else {
+                schedule(fs.unit_index[fault.id]);
+            }
+        }
+
+        settle();
+    }
+
+    void schedule(size_t unit) {
+        uint64_t bit = uint64_t { 1 } << unit % 64;
+
+        if (!(scheduled[unit / 64] & bit)) {
+            scheduled[unit / 64] |= bit;
+            scheduled_count++;
+        }
+    }
+
+    uint64_t force(size_t wire, uint64_t value) const
+        { return (value & ~wire_stuck[0][wire]) | wire_stuck[1][wire]; }
+
+    void set(size_t wire, uint64_t value) {
+        value = force(wire, value);
+
+        if (state[wire] != value) {
+            state[wire] = value;
+
+            for (size_t i = fs.fanout_first[wire];
+                 i < fs.fanout_first[wire + 1]; i++)
+                schedule(fs.fanout[i]);
+        }
+    }
+
+    uint64_t input(const CUnit &unit, size_t i) const {
+        size_t port = unit.first_input + i;
+
+        return (state[fs.inputs[port]] & ~input_stuck[0][port]) |
+            input_stuck[1][port];
+    }
+
+    void output(const CUnit &unit, size_t o, uint64_t value) {
+        size_t port = unit.first_output + o;
+
+        set(fs.outputs[port],
+            (value & ~output_stuck[0][port]) | output_stuck[1][port]);
+    }
+
+    void evaluate(const CUnit &unit) {
+        const Lut &lut = *unit.lut;
+        size_t input_size = lut.input_size;
+
+        /* no clock is applied, registers hold their outputs */
+        if (lut.clocked) {
+            for (size_t o = 0; o < lut.output_size; o++)
+                output(unit, o, state[fs.outputs[unit.first_output + o]]);
+
+            return;
+        }
+
+        /* wider luts are looked up lane by lane */
+        if (unit.table == SIZE_MAX) {
+            uint64_t ins[Lut::MAX_INPUTS];
+            for (size_t i = 0; i < input_size; i++)
+                ins[i] = input(unit, i);
+
+            for (size_t o = 0; o < lut.output_size; o++) {
+                uint64_t value = 0;
+
+                for (size_t lane = 0; lane < LANES; lane++) {
+                    size_t index = 0;
+                    for (size_t i = 0; i < input_size; i++)
+                        index |= (ins[i] >> lane & 1) << i;
+
+                    value |= uint64_t { lut.lookup(index, o) } << lane;
+                }
+
+                output(unit, o, value);
+            }
+
+            return;
+        }
+
+        size_t variants = lut.input_variant_count();
+        const uint64_t *table = fs.tables.data() + unit.table;
+
+        for (size_t o = 0; o < lut.output_size; o++, table += variants) {
+            uint64_t values[LANES];
+            std::copy(table, table + variants, values);
+
+            /* multiplexes truth table with one input at a time */
+            for (size_t i = 0; i < input_size; i++) {
+                uint64_t in = input(unit, i);
+
+                for (size_t m = 0; m < (variants >> (i + 1)); m++)
+                    values[m] = (in & values[2 * m + 1]) |
+                        (~in & values[2 * m]);
+            }
+
+            output(unit, o, values[0]);
+        }
+    }
+
+    /*
+     * evaluates scheduled units in passes over them in order, so that a
+     * unit outside of loops is evaluated once its inputs are, and only once
+     */
+    void settle() {
+        /* a faulty machine may oscillate, so passes are bounded */
+        size_t passes = 2 * fs.units.size() + 16;
+
+        while (scheduled_count) {
+            if (passes-- == 0) {
+                std::fill(scheduled.begin(), scheduled.end(), 0);
+                scheduled_count = 0;
+                break;
+            }
+
+            for (size_t w = 0; w < scheduled.size() && scheduled_count; w++) {
+                while (scheduled[w]) {
+                    size_t unit = w * 64 + std::countr_zero(scheduled[w]);
+
+                    scheduled[w] &= scheduled[w] - 1;
+                    scheduled_count--;
+
+                    evaluate(fs.units[unit]);
+                }
+            }
+        }
+    }
+
+    const FaultSim &fs;
+
+    StateVector<uint64_t> state;
+
+    /* lanes whose wire or port is stuck at 0 and 1 */
+    StateVector<uint64_t> wire_stuck[2];
+    StateVector<uint64_t> input_stuck[2];
+    StateVector<uint64_t> output_stuck[2];
+
+    /* fault of every busy lane, and the pattern it is at */
+    size_t lane_fault[LANES] {};
+    size_t lane_pattern[LANES] {};
+
+    /* wires set by patterns of a generation, and their states */
+    StateVector<size_t> stimuli;
+    StateVector<uint64_t> next_state;
+    vector<uint8_t> stimulated;
+
+    /* units to evaluate, a bit for each */
+    StateVector<uint64_t> scheduled;
+    size_t scheduled_count {};
+};
+
+
+FaultSim::FaultSim(const Interpreter &intr, vector<WireId> observed_) {
+    std::map<const Lut *, size_t> table_of;
+
+    for (auto &[id, wire] : intr.get_wires()) {
+        if (id >= wire_index.size())
+            wire_index.resize(id + 1, SIZE_MAX);
+
+        wire_index[id] = wire_ids.size();
+        wire_ids.push_back(id);
+        initial.push_back(wire.state);
+    }
+
+    vector<size_t> fanout_count(wire_ids.size() + 1);
+
+    for (auto &[id, unit] : intr.get_units()) {
+        if (id >= unit_index.size())
+            unit_index.resize(id + 1, SIZE_MAX);
+
+        auto &lut = intr.get_luts().at(unit.lut_id);
+
+        /* luts are shared by units, and so are their tables */
+        auto [it, inserted] = table_of.try_emplace(&lut, SIZE_MAX);
+        if (inserted && !lut.clocked && lut.input_variant_count() <= LANES) {
+            it->second = tables.size();
+
+            for (size_t o = 0; o < lut.output_size; o++)
+                for (size_t m = 0; m < lut.input_variant_count(); m++)
+                    tables.push_back(lut.lookup(m, o) ? ALL : 0);
+        }
+
+        unit_index[id] = units.size();
+        units.push_back(CUnit {
+            &lut, inputs.size(), outputs.size(), id, it->second
+        });
+
+        for (WireId wire_id : unit.input_wires) {
+            inputs.push_back(index_of(wire_id));
+            fanout_count[index_of(wire_id)]++;
+        }
+
+        for (WireId wire_id : unit.output_wires)
+            outputs.push_back(index_of(wire_id));
+    }
+
+    fanout_first.resize(wire_ids.size() + 1);
+    for (size_t i = 0; i < wire_ids.size(); i++)
+        fanout_first[i + 1] = fanout_first[i] + fanout_count[i];
+
+    fanout.resize(fanout_first.back());
+
+    vector<size_t> fill { fanout_first.begin(), fanout_first.end() - 1 };
+    for (size_t i = 0; i < units.size(); i++) {
+        auto &lut = *units[i].lut;
+
+        for (size_t j = 0; j < lut.input_size; j++) {
+            size_t wire = inputs[units[i].first_input + j];
+
+            /* a unit reading a wire twice is scheduled once */
+            if (fill[wire] == fanout_first[wire] ||
+                fanout[fill[wire] - 1] != i)
+                fanout[fill[wire]++] = i;
+        }
+    }
+
+    /* duplicate ports leave unused slots, which are closed up */
+    size_t end = 0;
+    for (size_t i = 0; i < wire_ids.size(); i++) {
+        size_t begin = fanout_first[i];
+
+        fanout_first[i] = end;
+        for (size_t j = begin; j < fill[i]; j++)
+            fanout[end++] = fanout[j];
+    }
+    fanout_first.back() = end;
+    fanout.resize(end);
+
+    /* units are renumbered in reverse postorder of a depth-first search
+     * along fanouts, so that a unit comes after the ones driving it unless
+     * they form a loop */
+    struct Frame {
+        size_t unit;
+        size_t port /**< output port whose fanout is being visited */;
+        size_t edge /**< in fanout of port */;
+    };
+
+    vector<size_t> rank(units.size());
+    vector<uint8_t> visited(units.size());
+    vector<Frame> stack;
+    size_t next_rank = units.size();
+
+    for (size_t root = 0; root < units.size(); root++) {
+        if (visited[root])
+            continue;
+
+        visited[root] = true;
+        stack.push_back({ root, 0, 0 });
+
+        while (stack.size()) {
+            Frame &frame = stack.back();
+            const CUnit &unit = units[frame.unit];
+            bool descended = false;
+
+            while (!descended && frame.port < unit.lut->output_size) {
+                size_t wire = outputs[unit.first_output + frame.port];
+                size_t edge = fanout_first[wire] + frame.edge;
+
+                if (edge == fanout_first[wire + 1]) {
+                    frame.port++;
+                    frame.edge = 0;
+                    continue;
+                }
+
+                frame.edge++;
+
+                if (!visited[fanout[edge]]) {
+                    visited[fanout[edge]] = true;
+                    stack.push_back({ fanout[edge], 0, 0 });
+                    descended = true;
+                }
+            }
+
+            if (!descended) {
+                rank[frame.unit] = --next_rank;
+                stack.pop_back();
+            }
+        }
+    }
+
+    vector<CUnit> ordered(units.size());
+    for (size_t i = 0; i < units.size(); i++)
+        ordered[rank[i]] = units[i];
+    units = std::move(ordered);
+
+    for (size_t &unit : fanout)
+        unit = rank[unit];
+
+    for (size_t &unit : unit_index)
+        if (unit != SIZE_MAX)
+            unit = rank[unit];
+
+    if (observed_.empty()) {
+        for (auto &[id, wire] : intr.get_wires())
+            if (wire.affects.empty())
+                observed.push_back(index_of(id));
+    } else {
+        for (WireId id : observed_)
+            observed.push_back(index_of(id));
+    }
+}
+
+size_t FaultSim::index_of(WireId id) const {
+    if (id >= wire_index.size() || wire_index[id] == SIZE_MAX)
+        throw std::invalid_argument("unknown wire");
+
+    return wire_index[id];
+}
+
+vector<Fault> FaultSim::faults() const {
+    vector<Fault> res;
+
+    for (WireId id : wire_ids)
+        for (bool value : { false, true })
+            res.push_back({ Fault::WIRE, id, 0, value });
+
+    /* units in order of identifiers, as they are declared */
+    for (size_t i : unit_index) {
+        if (i == SIZE_MAX)
+            continue;
+
+        size_t input_size = units[i].lut->input_size;
+        size_t output_size = units[i].lut->output_size;
+
+        for (size_t pin = 0; pin < input_size; pin++)
+            for (bool value : { false, true })
+                res.push_back({ Fault::INPUT, units[i].id, pin, value });
+
+        for (size_t pin = 0; pin < output_size; pin++)
+            for (bool value : { false, true })
+                res.push_back({ Fault::OUTPUT, units[i].id, pin, value });
+    }
+
+    return res;
+}
+
+FaultReport FaultSim::run(span<const Pattern> patterns,
+                          unsigned threads) const {
+    return run(faults(), patterns, threads);
+}
+
+FaultReport FaultSim::run(vector<Fault> faults, span<const Pattern> patterns,
+                          unsigned threads) const {
+    /* workers cannot throw, so everything is validated up front */
+    for (auto &pattern : patterns)
+        for (auto &stimulus : pattern)
+            index_of(stimulus.first);
+
+    for (auto &fault : faults) {
+        if (fault.site == Fault::WIRE) {
+            index_of(fault.id);
+            continue;
+        }
+
+        if (fault.id >= unit_index.size() || unit_index[fault.id] == SIZE_MAX)
+            throw std::invalid_argument("unknown unit");
+
+        auto &lut = *units[unit_index[fault.id]].lut;
+        if (fault.pin >= (fault.site == Fault::INPUT ? lut.input_size
+                                                     : lut.output_size))
+            throw std::out_of_range("unknown port");
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<size_t>(threads, std::max<size_t>(
+        1, (faults.size() + LANES - 1) / LANES));
+
+    vector<uint8_t> detected(faults.size());
+    std::atomic<size_t> next_fault { 0 };
+
+    Topology topology;
+
+    auto worker = [&](unsigned index, const Machine::Response &good) {
+        ScopedPin pin { topology.cpu_for(index, pinning) };
+        Machine machine { *this };
+
+        machine.run(faults, next_fault, good, detected);
+    };
+
+    if (patterns.size()) {
+        auto good = Machine { *this }.respond(patterns);
+
+        vector<std::jthread> workers;
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back(worker, i, std::cref(good));
+
+        worker(0, good);
+    }
+
+    FaultReport report;
+    report.detected.assign(detected.begin(), detected.end());
+    report.detected_count = std::count(detected.begin(), detected.end(), 1);
+
+    report.faults = std::move(faults);
+
+    return report;
+}
+
+
+ostream &Fault::dump(ostream &os, const Lex &lex) const {
+    static const char *site_names[] = { "wire", "unit", "unit" };
+
+    os << site_names[site] << " " << lex.ident_name(id);
+
+    if (site == INPUT)
+        os << " input " << pin;
+    else if (site == OUTPUT)
+        os << " output " << pin;
+
+    os << " stuck-at-" << value;
+
+    return os;
+}
+
+ostream &FaultReport::dump(ostream &os, const Lex &lex) const {
+    auto flags = os.flags();
+
+    os << "faults " << faults.size() << ", detected " << detected_count <<
+        ", coverage " << std::fixed << std::setprecision(2) << coverage() <<
+        "%\n";
+
+    os.flags(flags);
+
+    if (detected_count == faults.size())
+        return os;
+
+    os << "undetected faults:\n";
+    for (size_t i = 0; i < faults.size(); i++)
+        if (!detected[i])
+            faults[i].dump(os << "  ", lex) << "\n";
+
+    return os;
+}
+
+
+vector<Pattern> read_patterns(std::istream &is, Lex &lex,
+                              const Interpreter &intr) {
+    vector<Pattern> res;
+    string line;
+
+    while (std::getline(is, line)) {
+        std::istringstream ss { line };
+        Pattern pattern;
+        string assignment;
+
+        while (ss >> assignment) {
+            size_t eq = assignment.find('=');
+
+            if (eq == string::npos || eq + 2 != assignment.size() ||
+                (assignment[eq + 1] != '0' && assignment[eq + 1] != '1'))
+                throw std::invalid_argument("invalid assignment");
+
+            WireId id = lex.get_ident_id(assignment.substr(0, eq));
+            if (!intr.get_wires().contains(id))
+                throw std::invalid_argument("unknown wire");
+
+            pattern.emplace_back(id, assignment[eq + 1] == '1');
+        }
+
+        if (pattern.size())
+            res.push_back(std::move(pattern));
+    }
+
+    return res;
+}
@@ -1,106 +1,253 @@
+#include "../include/format.hpp"
 #include "../include/core.hpp"
 #include "../include/interpreter.hpp"
 #include "../include/lex.hpp"
+#include "../include/table.hpp"
 
-#include <ostream>
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
 
 using std::ostream;
+using std::string_view;
 
 
-ostream &Lut::dump(ostream &os, const Lex &lex) const {
-    os << "lut<" << input_size << ", " << output_size << "> " <<
-        lex.ident_name(id)<< " /*l" << id << "*/ = (0b";
+/* binary digits of every nibble */
+static const char nibble_bits[16][4] = {
+    { '0', '0', '0', '0' }, { '0', '0', '0', '1' }, { '0', '0', '1', '0' },
+    { '0', '0', '1', '1' }, { '0', '1', '0', '0' }, { '0', '1', '0', '1' },
+    { '0', '1', '1', '0' }, { '0', '1', '1', '1' }, { '1', '0', '0', '0' },
+    { '1', '0', '0', '1' }, { '1', '0', '1', '0' }, { '1', '0', '1', '1' },
+    { '1', '1', '0', '0' }, { '1', '1', '0', '1' }, { '1', '1', '1', '0' },
+    { '1', '1', '1', '1' },
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void Writer::flush() {
+    os.write(buf.data(), buf.size());
+    buf.clear();
+}
+
+void Writer::put_num(uint64_t num) {
+    char digits[20];
+    auto res = std::to_chars(digits, digits + sizeof(digits), num);
+
+    buf.append(digits, res.ptr);
+}
 
-    for (size_t i = 0; i < lut.size(); i++) {
-        if (i > 0 && i % input_variant_count() == 0)
-            os << ", 0b";
+void Writer::put_ident(size_t id, char kind) {
+    put(lex.ident_name(id));
 
-        os << lut[
-            (i / input_variant_count() + 1) * input_variant_count() -
-            (i % input_variant_count()) - 1
-        ];
+    if (options.ids) {
+        put(" /*");
+        put(kind);
+        put_num(id);
+        put("*/");
     }
+}
 
-    os << ")";
-    table.dump(os, lex) << ";";
+void Writer::put_point(const TablePoint &point) {
+    if (point.is_ident()) {
+        put_ident(point.ident_id(), 'i');
+    } else {
+        put('(');
+        put_num(point.x);
+        put(", ");
+        put_num(point.y);
+        put(')');
+    }
+}
 
-    return os;
+void Writer::put_truth_table(const Lut &lut, size_t output) {
+    size_t count = lut.input_variant_count();
+
+    put(options.hex ? "0x" : "0b");
+
+    /* nibbles never cross words, only a table narrower than a nibble has
+     * leading bits */
+    for (size_t w = lut.word_count(); w-- > 0;) {
+        uint64_t word = lut.word(output, w);
+        size_t bits = std::min<size_t>(count - w * 64, 64);
+
+        if (options.hex) {
+            for (size_t i = (bits + 3) / 4; i-- > 0;)
+                put(hex_digits[(word >> (i * 4)) & 0xf]);
+
+            continue;
+        }
+
+        for (size_t i = bits; i-- > bits / 4 * 4;)
+            put((word >> i) & 1 ? '1' : '0');
+
+        for (size_t i = bits / 4; i-- > 0;)
+            buf.append(nibble_bits[(word >> (i * 4)) & 0xf], 4);
+    }
 }
 
-ostream &Wire::dump(ostream &os, const Lex &lex) const {
-    os << "wire " << lex.ident_name(id) << " /*w" << id << "*/ = " <<
-        (state ? "1" : "0");
+Writer &Writer::write(const Lut &lut) {
+    put(lut.clocked ? "reg<" : "lut<");
+    put_num(lut.input_size);
+    put(", ");
+    put_num(lut.output_size);
+    put("> ");
+    put_ident(lut.id, 'l');
+    put(" = (");
 
-    table.dump(os, lex) << ";";
+    for (size_t o = 0; o < lut.output_size; o++) {
+        if (o > 0)
+            put(", ");
 
-    return os;
+        put_truth_table(lut, o);
+    }
+
+    put(')');
+    write(lut.table);
+
+    return write(";");
 }
 
-ostream &Unit::dump(ostream &os, const Lex &lex) const {
-    os << "unit<" << lex.ident_name(lut_id) << " /*l" << lut_id << "*/> " <<
-        lex.ident_name(id) << " /*u" << id << "*/ = (";
+Writer &Writer::write(const Wire &wire) {
+    put("wire ");
+    put_ident(wire.id, 'w');
+    put(wire.state ? " = 1" : " = 0");
+    write(wire.table);
 
-    for (size_t i = 0; i < input_wires.size(); i++) {
+    return write(";");
+}
+
+Writer &Writer::write(const Unit &unit) {
+    put("unit<");
+    put_ident(unit.lut_id, 'l');
+    put("> ");
+    put_ident(unit.id, 'u');
+    put(" = (");
+
+    for (size_t i = 0; i < unit.input_wires.size(); i++) {
         if (i > 0)
-            os << ", ";
+            put(", ");
 
-        os << lex.ident_name(input_wires[i] )<< " /*w" <<
-            input_wires[i] << "*/";
+        put_ident(unit.input_wires[i], 'w');
     }
 
-    os << ") -> (";
+    put(") -> (");
 
-    for (size_t i = 0; i < output_wires.size(); i++) {
+    for (size_t i = 0; i < unit.output_wires.size(); i++) {
         if (i > 0)
-            os << ", ";
+            put(", ");
 
-        os << lex.ident_name(output_wires[i] )<< " /*w" <<
-            output_wires[i] << "*/";
+        put_ident(unit.output_wires[i], 'w');
     }
 
-    os << ")";
-    table.dump(os, lex) << ";";
+    put(')');
+    write(unit.table);
 
-    return os;
+    return write(";");
 }
 
-ostream &Table::dump(ostream &os, const Lex &lex) const {
-    if (table.size() == 0)
-        return os;
+Writer &Writer::write(const Table &table) {
+    if (!options.metadata || table.size() == 0)
+        return *this;
 
-    os << "\n{\n";
+    put("\n{\n");
 
-    size_t i = 0;
-    for (const auto &entry : table) {
-        os << "    " << lex.ident_name(entry.first) << " /*p" << entry.first
-            << "*/: ";
+    for (size_t i = 0; i < table.size(); i++) {
+        const TableValue &value = table.value(i);
 
-        entry.second->dump(os, lex) << (i == table.size() - 1 ? "\n" : ",\n");
+        put("    ");
+        put_ident(table.key(i), 'p');
+        put(": ");
 
-        i++;
-    }
+        switch (value.kind) {
+        case TableValue::NUM:
+            put_num(value.num);
+            break;
+        case TableValue::POINT:
+            put_point(value.point);
+            break;
+        case TableValue::PATH: {
+            PathView paths = table.store->path(value);
 
-    os << "}";
+            put('[');
 
-    return os;
+            for (size_t j = 0; j < paths.size(); j++) {
+                auto path = paths[j];
+
+                for (size_t k = 0; k < path.size(); k++) {
+                    put_point(path[k]);
+
+                    if (k != path.size() - 1)
+                        put(", ");
+                }
+
+                if (j != paths.size() - 1)
+                    put("; ");
+            }
+
+            put(']');
+            break;
+        }
+        }
+
+        put(i == table.size() - 1 ? "\n" : ",\n");
+    }
+
+    return write("}");
 }
 
-ostream &Interpreter::dump(ostream &os, const Lex &lex) const {
+Writer &Writer::write(const Interpreter &intr) {
+    auto &luts = intr.get_luts();
+    auto &wires = intr.get_wires();
+    auto &units = intr.get_units();
+
     for (auto &it : luts)
-        it.second.dump(os, lex) << "\n";
+        write(it.second).write("\n");
 
     if (luts.size() && wires.size())
-        os << "\n";
+        write("\n");
 
     for (auto &it : wires)
-        it.second.dump(os, lex) << "\n";
+        write(it.second).write("\n");
 
     if (wires.size() && units.size())
-        os << "\n";
+        write("\n");
 
     for (auto &it : units)
-        it.second.dump(os, lex) << "\n";
+        write(it.second).write("\n");
+
+    return *this;
+}
+
+
+ostream &Lut::dump(ostream &os, const Lex &lex) const {
+    Writer { os, lex }.write(*this);
+
+    return os;
+}
+
+ostream &Wire::dump(ostream &os, const Lex &lex) const {
+    Writer { os, lex }.write(*this);
+
+    return os;
+}
+
+ostream &Unit::dump(ostream &os, const Lex &lex) const {
+    Writer { os, lex }.write(*this);
+
+    return os;
+}
+
+ostream &Table::dump(ostream &os, const Lex &lex) const {
+    Writer { os, lex }.write(*this);
+
+    return os;
+}
+
+ostream &Interpreter::dump(ostream &os, const Lex &lex) const {
+    Writer { os, lex }.write(*this);
 
     return os;
 }
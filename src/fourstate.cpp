@@ -0,0 +1,281 @@
+#include "../include/fourstate.hpp"
+#include "../include/cycle.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using std::vector, std::span;
+using std::ostream;
+
+
+/* value of a wire driven by both `a` and `b` */
+static Logic resolve(Logic a, Logic b) {
+    if (a == Logic::Z)
+        return b;
+    if (b == Logic::Z || a == b)
+        return a;
+
+    return Logic::X;
+}
+
+FourState::FourState(const Interpreter &intr, bool declared)
+    : net { intr.get_luts(), intr.get_wires(), intr.get_units(), 0 } {
+    auto &wires = intr.get_wires();
+
+    wire_index.resize(wires.empty() ? 0 : wires.rbegin()->first + 1, NONE);
+    wire_ids.resize(wires.size());
+
+    size_t i = 0;
+    for (auto &[id, _] : wires) {
+        wire_index[id] = net.slots[i++];
+        wire_ids[wire_index[id]] = id;
+    }
+
+    codes.resize((wire_ids.size() + 7) / 8 * 8);
+
+    vector<uint32_t> drivers(wire_ids.size());
+    for (auto *ops : { &net.comb, &net.regs })
+        for (auto &op : *ops)
+            for (uint32_t o = 0; o < op.output_size; o++)
+                drivers[net.ports[op.first_port + op.input_size + o]]++;
+
+    for (uint32_t i = 0; i < wire_ids.size(); i++)
+        set_at(i, drivers[i] && !declared ?
+            Logic::X : static_cast<Logic>(net.values[i]));
+
+    shared_first.resize(wire_ids.size() + 1);
+    for (size_t i = 0; i < wire_ids.size(); i++)
+        shared_first[i + 1] = shared_first[i] + (drivers[i] > 1 ? drivers[i] : 0);
+
+    shared.resize(shared_first.back());
+    vector<uint32_t> fill { shared_first.begin(), shared_first.end() - 1 };
+
+    for (auto *ops : { &net.comb, &net.regs })
+        for (auto &op : *ops)
+            for (uint32_t o = 0; o < op.output_size; o++) {
+                uint32_t port = op.first_port + op.input_size + o;
+                uint32_t wire = net.ports[port];
+
+                if (drivers[wire] > 1)
+                    shared[fill[wire]++] = port;
+            }
+
+    driven.assign(net.ports.size(), declared ? Logic::Z : Logic::X);
+    next.assign(net.regs.empty() ? 0 : net.ports.size(), Logic::X);
+
+    for (auto &op : net.comb)
+        comb.push_back(compile(op));
+    for (auto &op : net.regs)
+        regs.push_back(compile(op));
+}
+
+FourState::Op FourState::compile(const Levelized::Op &l_op) {
+    Op op {
+        l_op.table, NONE, l_op.first_port,
+        static_cast<uint16_t>(l_op.input_size),
+        static_cast<uint16_t>(l_op.output_size), false, l_op.lut
+    };
+
+    for (uint32_t o = 0; o < op.output_size; o++) {
+        uint32_t wire = net.ports[op.first_port + op.input_size + o];
+
+        op.shared |= shared_first[wire] != shared_first[wire + 1];
+    }
+
+    if (op.input_size > X_TABLE_INPUTS)
+        return op;
+
+    /* luts are shared by units, and so are their tables */
+    auto [it, inserted] = x_table_of.try_emplace(op.lut, x_tables.size());
+
+    if (inserted)
+        for (uint32_t o = 0; o < op.output_size; o++)
+            for (size_t c = 0; c < size_t { 1 } << 2 * op.input_size; c++)
+                x_tables.push_back(lookup(op, o, c));
+
+    op.x_table = it->second;
+
+    return op;
+}
+
+uint32_t FourState::index_of(WireId id) const {
+    if (id >= wire_index.size() || wire_index[id] == NONE)
+        throw std::invalid_argument("unknown wire");
+
+    return wire_index[id];
+}
+
+size_t FourState::read_inputs(const Op &op) const {
+    const uint32_t *port = net.ports.data() + op.first_port;
+
+    size_t packed = 0;
+    for (uint32_t i = 0; i < op.input_size; i++)
+        packed |= size_t { codes[port[i]] } << 2 * i;
+
+    return packed;
+}
+
+Logic FourState::lookup(const Op &op, uint32_t output, size_t packed) const {
+    if (op.x_table != NONE)
+        return x_tables[op.x_table + (output << 2 * op.input_size) + packed];
+
+    auto table = [&](size_t index) -> uint8_t {
+        if (op.table == NONE)
+            return op.lut->lookup(index, output);
+
+        return net.tables[op.table + (output << op.input_size) + index];
+    };
+
+    size_t index = 0, x_mask = 0;
+    for (uint32_t i = 0; i < op.input_size; i++) {
+        index |= ((packed >> 2 * i) & 1) << i;
+        x_mask |= ((packed >> (2 * i + 1)) & 1) << i;
+    }
+
+    /* Z reads as X, and every value of unknown inputs is tried, as subsets
+     * of `x_mask` */
+    index &= ~x_mask;
+
+    uint8_t known = table(index);
+
+    for (size_t sub = x_mask; sub; sub = (sub - 1) & x_mask)
+        if (table(index | sub) != known)
+            return Logic::X;
+
+    return static_cast<Logic>(known);
+}
+
+template<bool track>
+bool FourState::drive(uint32_t port, Logic logic) {
+    uint32_t wire = net.ports[port];
+    uint32_t first = shared_first[wire], last = shared_first[wire + 1];
+
+    if (first != last) {
+        driven[port] = logic;
+
+        logic = Logic::Z;
+        for (uint32_t i = first; i < last; i++)
+            logic = resolve(logic, driven[shared[i]]);
+    }
+
+    if constexpr (track) {
+        Logic old = get_at(wire);
+
+        /* a wire that becomes X stays so */
+        if (logic != old && pessimistic)
+            logic = Logic::X;
+
+        if (logic == old)
+            return false;
+    }
+
+    set_at(wire, logic);
+
+    return true;
+}
+
+template<bool track>
+bool FourState::pass() {
+    bool changed = false;
+
+    for (const Op &op : comb) {
+        size_t packed = read_inputs(op);
+        uint32_t outputs = op.first_port + op.input_size;
+
+        for (uint32_t o = 0; o < op.output_size; o++) {
+            Logic logic = lookup(op, o, packed);
+
+            if (track || op.shared)
+                changed |= drive<track>(outputs + o, logic);
+            else
+                set_at(net.ports[outputs + o], logic);
+        }
+    }
+
+    return changed;
+}
+
+void FourState::settle() {
+    if (!net.loop) {
+        pass<false>();
+
+        return;
+    }
+
+    for (size_t i = 0; i <= comb.size(); i++)
+        if (!pass<true>())
+            return;
+
+    /* wires change at most once more, to X */
+    pessimistic = true;
+    while (pass<true>()) {}
+    pessimistic = false;
+}
+
+void FourState::latch() {
+    for (const Op &op : regs) {
+        size_t packed = read_inputs(op);
+        uint32_t outputs = op.first_port + op.input_size;
+
+        for (uint32_t o = 0; o < op.output_size; o++)
+            next[outputs + o] = lookup(op, o, packed);
+    }
+
+    for (const Op &op : regs) {
+        uint32_t outputs = op.first_port + op.input_size;
+
+        for (uint32_t o = 0; o < op.output_size; o++)
+            drive<false>(outputs + o, next[outputs + o]);
+    }
+}
+
+void FourState::apply(span<const Stimulus4> stimuli) {
+    for (auto &[id, logic] : stimuli)
+        set(id, logic);
+
+    settle();
+}
+
+void FourState::run_cycles(uint64_t n) {
+    settle();
+
+    for (uint64_t i = 0; i < n; i++) {
+        latch();
+        settle();
+    }
+}
+
+vector<WireId> FourState::unknown_wires() const {
+    vector<WireId> res;
+
+    /* eight wires at once, by their unknown bits */
+    for (size_t w = 0; w < codes.size(); w += 8) {
+        uint64_t word;
+        std::memcpy(&word, &codes[w], sizeof word);
+
+        for (word &= 0x0202020202020202; word; word &= word - 1)
+            res.push_back(wire_ids[w + std::countr_zero(word) / 8]);
+    }
+
+    std::sort(res.begin(), res.end());
+
+    return res;
+}
+
+ostream &FourState::dump_unknown(ostream &os, const Lex &lex) const {
+    for (WireId id : unknown_wires())
+        os << lex.ident_name(id) << " = " <<
+            (get(id) == Logic::X ? "x" : "z") << "\n";
+
+    return os;
+}
@@ -9,17 +9,23 @@
 #include <rdesc/cfg.h>
 #include <rdesc/rdesc.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 #include <stdexcept>
 
-using std::vector, std::map;
-using std::unique_ptr, std::make_unique;
-using std::string;
+using std::vector, std::map, std::span;
+using std::string, std::string_view;
 using std::piecewise_construct, std::forward_as_tuple;
+using std::pair;
 
 
 static auto get_rrr_ident_id(struct rdesc_node *ls) {
@@ -33,111 +39,340 @@ static auto get_rrr_ident_id(struct rdesc_node *ls) {
 }  // GCOVR_EXCL_LINE
 
 
-TVNum::TVNum(struct rdesc_node &num)
-    : decimal { get_seminfo<NumInfo>(&num)->decimal() } {}
-
-TVPointIdent::TVPointIdent(struct rdesc_node &point)
-    : id { get_seminfo<IdentInfo>(point.nt.children[0])->id } {}
-
-TVPointNum::TVPointNum(struct rdesc_node &num)
-    : x { get_seminfo<NumInfo>(num.nt.children[1])->decimal() },
-      y { get_seminfo<NumInfo>(num.nt.children[3])->decimal() } {}
-
-static unique_ptr<TVPoint> interpret_tvpoint(struct rdesc_node &point) {
+/* clears `valid` instead of throwing for coordinates out of range, as
+ * semantic information of the rest of the table is still to be released */
+static TablePoint interpret_tvpoint(struct rdesc_node &point, bool &valid) {
     switch (point.nt.variant) {
     case 0: /* ident */
-        return make_unique<TVPointIdent>(point);
-    case 1: /* num, num */
-        return make_unique<TVPointNum>(point);
-    default: unreachable();  // GCOVR_EXCL_LINE
-    }
-}
-
-TVPath::TVPath(struct rdesc_node &path_ls) {
-    paths.push_back({});
-    size_t i = 0;
+        return TablePoint(
+            TablePoint::IDENT,
+            get_seminfo<IdentInfo>(point.nt.children[0])->id
+        );
+    case 1: /* num, num */ {
+        uintmax_t x = get_seminfo<NumInfo>(point.nt.children[1])->decimal();
+        uintmax_t y = get_seminfo<NumInfo>(point.nt.children[3])->decimal();
 
-    traverse_rrr_list(path_ls.nt.children[1], [&](auto *entry, auto *delim) {
-        paths[i].push_back(interpret_tvpoint(*entry));
+        if (!TablePoint::fits(x, y)) {
+            valid = false;
 
-        if (delim && delim->nt.children[0]->tk.id == TK_SEMI) {
-            paths.push_back({});
-            i++;
+            return TablePoint {};
         }
-    });
+
+        return TablePoint(x, y);
+    }
+    default: unreachable();  // GCOVR_EXCL_LINE
+    }
 }
 
-unique_ptr<TableValue> Interpreter::interpret_table_value(struct rdesc_node &tv) {
+/* interprets a table value into the store, or only releases semantic
+ * information of its tokens if store is null */
+static TableValue interpret_table_value(Metadata *store,
+                                        struct rdesc_node &tv, bool &valid) {
     struct rdesc_node &child = *tv.nt.children[0];
+    TableValue value;
+
     switch (tv.nt.variant) {
     case 0: /* num */
-        return make_unique<TVNum>(child);
+        value.kind = TableValue::NUM;
+        value.num = get_seminfo<NumInfo>(&child)->decimal();
+        break;
     case 1: /* tv_point */
-        return interpret_tvpoint(child);
+        value.kind = TableValue::POINT;
+        value.point = interpret_tvpoint(child, valid);
+        break;
     case 2: /* tv_path */
-        return make_unique<TVPath>(child);
+        if (store == nullptr) {
+            traverse_rrr_list(child.nt.children[1], [&](auto *entry) {
+                interpret_tvpoint(*entry, valid);
+            });
+
+            break;
+        }
+
+        store->begin_path();
+
+        traverse_rrr_list(child.nt.children[1], [&](auto *entry, auto *delim) {
+            store->push_point(interpret_tvpoint(*entry, valid));
+
+            if (delim && delim->nt.children[0]->tk.id == TK_SEMI)
+                store->break_path();
+        });
+
+        value = store->end_path();
+        break;
     default: unreachable();  // GCOVR_EXCL_LINE
     }
+
+    return value;
 }
 
-Table Interpreter::interpret_table(struct rdesc_node &n) {
-    map<TableKeyId, unique_ptr<TableValue>> table;
+template<typename Keep>
+static Table interpret_table_entries(Metadata &store, struct rdesc_node &n,
+                                     Keep keep) {
+    vector<pair<TableKeyId, TableValue>> table;
+    bool valid = true;
 
-    if (n.nt.child_count == 0)
-        return Table { std::move(table) };
-
-    auto ls = n.nt.children[0]->nt.children[1];
+    auto ls = n.nt.children[1];
 
     traverse_rrr_list(ls, [&](auto *entry) {
         TableKeyId key = get_seminfo<IdentInfo>(entry->nt.children[0])->id;
+        auto &value = *entry->nt.children[2];
 
-        table.emplace(
-            piecewise_construct,
-            forward_as_tuple(key),
-            forward_as_tuple(interpret_table_value(*entry->nt.children[2]))
-        );
+        if (keep(key))
+            table.emplace_back(key, interpret_table_value(&store, value,
+                                                          valid));
+        else
+            interpret_table_value(nullptr, value, valid);
     });
 
+    if (!valid)
+        throw std::invalid_argument("invalid metadata point");
+
+    return store.commit(table);
+}
+
+Table Interpreter::interpret_table(struct rdesc_node &n) {
+    if (n.nt.child_count == 0)
+        return Table {};
+
+    auto &table = *n.nt.children[0];
+
+    switch (metadata_mode) {
+    case MetadataMode::FULL:
+        return interpret_table_entries(*metadata, table,
+                                       [](TableKeyId) { return true; });
+    case MetadataMode::STRIP:
+        return interpret_table_entries(*metadata, table, [&](TableKeyId key) {
+            return keeps(key);
+        });
+    default: unreachable();  // GCOVR_EXCL_LINE
+    }
+}
+
+bool Interpreter::keeps(TableKeyId key) const {
+    return metadata_mode == MetadataMode::FULL ||
+        lex->ident_name(key)[0] != '_';
+}
+
+void Interpreter::strip_metadata(std::shared_ptr<Lex> lex_) {
+    metadata_mode = MetadataMode::STRIP;
+    lex = std::move(lex_);
+}
+
+static uint64_t digit_value(char digit) {
+    if ('0' <= digit && digit <= '9')
+        return digit - '0';
+    else if ('a' <= digit && digit <= 'f')
+        return digit - 'a' + 10;
+    else if ('A' <= digit && digit <= 'F')
+        return digit - 'A' + 10;
+    else
+        unreachable();  // GCOVR_EXCL_LINE
+}
+
+/* decimal digits converted at once, as many as a word holds */
+static const size_t DECIMAL_CHUNK = 19;
+
+/* sizes below which quadratic algorithms are faster */
+static const size_t SCHOOLBOOK_WORDS = 64;
+static const size_t SCHOOLBOOK_CHUNKS = 32;
+
+static void trim(vector<uint64_t> &x) {
+    while (x.size() && !x.back())
+        x.pop_back();
+}
+
+/* adds `x` into `out` from word `at`, dropping carries past `out` */
+static void add_at(span<uint64_t> out, span<const uint64_t> x, size_t at) {
+    unsigned __int128 carry = 0;
+
+    for (size_t i = 0; at + i < out.size() && (i < x.size() || carry); i++) {
+        carry += out[at + i];
+        carry += i < x.size() ? x[i] : 0;
+        out[at + i] = static_cast<uint64_t>(carry);
+        carry >>= 64;
+    }
+}
+
+/* subtracts `y` from `x`, which is not less than it */
+static void subtract(span<uint64_t> x, span<const uint64_t> y) {
+    bool borrow = false;
+
+    for (size_t i = 0; i < x.size() && (i < y.size() || borrow); i++) {
+        uint64_t sub = i < y.size() ? y[i] : 0;
+        bool next = x[i] < sub || (x[i] == sub && borrow);
+
+        x[i] -= sub + borrow;
+        borrow = next;
+    }
+}
+
+/* a * b into `out` of a.size() + b.size() words, which are zero; balanced
+ * halves are multiplied by Karatsuba's method */
+static void multiply(span<const uint64_t> a, span<const uint64_t> b,
+                     span<uint64_t> out) {
+    if (a.size() < b.size())
+        std::swap(a, b);
+
+    if (b.size() < SCHOOLBOOK_WORDS) {
+        for (size_t i = 0; i < b.size(); i++) {
+            unsigned __int128 carry = 0;
+
+            for (size_t j = 0; j < a.size(); j++) {
+                carry += static_cast<unsigned __int128>(a[j]) * b[i] +
+                    out[i + j];
+                out[i + j] = static_cast<uint64_t>(carry);
+                carry >>= 64;
+            }
+
+            out[i + a.size()] = static_cast<uint64_t>(carry);
+        }
+
+        return;
+    }
+
+    size_t half = (a.size() + 1) / 2;
+
+    /* b is shorter than a half of a, so a is multiplied a block at a time */
+    if (b.size() <= half) {
+        vector<uint64_t> part;
+
+        for (size_t at = 0; at < a.size(); at += b.size()) {
+            auto block = a.subspan(at, std::min(b.size(), a.size() - at));
+
+            part.assign(block.size() + b.size(), 0);
+            multiply(block, b, part);
+            add_at(out, part, at);
+        }
+
+        return;
+    }
+
+    auto a0 = a.first(half), a1 = a.subspan(half);
+    auto b0 = b.first(half), b1 = b.subspan(half);
+
+    /* low and high products side by side, and the product of sums less
+     * both in between */
+    multiply(a0, b0, out.first(2 * half));
+    multiply(a1, b1, out.subspan(2 * half));
+
+    vector<uint64_t> sum_a(half + 1), sum_b(half + 1);
+    std::copy(a0.begin(), a0.end(), sum_a.begin());
+    std::copy(b0.begin(), b0.end(), sum_b.begin());
+    add_at(sum_a, a1, 0);
+    add_at(sum_b, b1, 0);
 
-    return Table { std::move(table) };
+    vector<uint64_t> middle(2 * half + 2);
+    multiply(sum_a, sum_b, middle);
+
+    subtract(middle, out.first(2 * half));
+    subtract(middle, out.subspan(2 * half));
+    add_at(out, middle, half);
+}
+
+/* x * y modulo 2^(64 * `limit`), without high zero words */
+static vector<uint64_t> multiply(span<const uint64_t> x,
+                                 span<const uint64_t> y, size_t limit) {
+    vector<uint64_t> res(x.size() + y.size());
+    multiply(x, y, res);
+
+    res.resize(std::min(res.size(), limit));
+    trim(res);
+
+    return res;
+}
+
+/* value of decimal `digits` modulo 2^(64 * `limit`), without high zero
+ * words; `powers` are 10^19, 10^38, 10^76... computed as needed */
+static vector<uint64_t> decimal_value(string_view digits, size_t limit,
+                                      vector<vector<uint64_t>> &powers) {
+    size_t chunks = (digits.size() + DECIMAL_CHUNK - 1) / DECIMAL_CHUNK;
+
+    if (chunks <= SCHOOLBOOK_CHUNKS) {
+        /* words times 10^19 plus the next 19 digits, as long as they are,
+         * over words that are not zero yet */
+        vector<uint64_t> res(std::min(chunks, limit));
+        size_t used = 0;
+
+        for (size_t i = 0; i < digits.size();) {
+            uint64_t chunk = 0, scale = 1;
+
+            for (size_t n = 0; n < DECIMAL_CHUNK && i < digits.size();
+                 n++, i++) {
+                chunk = chunk * 10 + digit_value(digits[i]);
+                scale *= 10;
+            }
+
+            unsigned __int128 carry = chunk;
+            for (size_t w = 0; w < res.size() && (w < used || carry); w++) {
+                carry += static_cast<unsigned __int128>(res[w]) * scale;
+                res[w] = static_cast<uint64_t>(carry);
+                carry >>= 64;
+
+                used = std::max(used, w + 1);
+            }
+        }
+
+        trim(res);
+
+        return res;
+    }
+
+    /* low digits are the largest power of two chunks there are more than,
+     * and the high ones, fewer, are scaled past them */
+    size_t k = std::bit_width(chunks - 1) - 1;
+    size_t low_size = DECIMAL_CHUNK << k;
+
+    if (powers.empty())
+        powers.push_back({ 10'000'000'000'000'000'000u });
+    while (powers.size() <= k)
+        powers.push_back(multiply(powers.back(), powers.back(), limit));
+
+    auto high = decimal_value(digits.substr(0, digits.size() - low_size),
+                              limit, powers);
+    auto low = decimal_value(digits.substr(digits.size() - low_size), limit,
+                             powers);
+
+    auto res = multiply(high, powers[k], limit);
+    res.resize(std::max(res.size(), std::min(low.size() + 1, limit)));
+    add_at(res, low, 0);
+    trim(res);
+
+    return res;
 }
 
-static void parse_lut_num_info(vector<bool> &table,
-                               size_t input_variant_count,
-                               const NumInfo &info) {
+/* decodes a literal into the packed truth table of `bit_count` bits in
+ * `words`, dropping bits past them */
+static void decode_literal(span<uint64_t> words, size_t bit_count,
+                           const NumInfo &info) {
+    const string &num_str = info.num;
+
     if (info.base == 10) {
-        uintmax_t value = info.decimal();
-        for (size_t i = 0; i < input_variant_count; i++)
-            table.push_back((value >> i) & 1);
+        vector<vector<uint64_t>> powers;
+        auto value = decimal_value(num_str, words.size(), powers);
+
+        std::copy(value.begin(), value.end(), words.begin());
     } else {
-        const string &num_str = info.num;
+        int bits_per_digit = (info.base == 2) ? 1 : (info.base == 8) ? 3 : 4;
         size_t bit_index = 0;
 
         for (auto it = num_str.rbegin();
-             it != num_str.rend() && bit_index < input_variant_count;
-             ++it) {
-            char digit = *it;
-            uintmax_t digit_value = 0;
-
-            if ('0' <= digit && digit <= '9')
-                digit_value = digit - '0';
-            else if ('a' <= digit && digit <= 'f')
-                digit_value = digit - 'a' + 10;
-            else if ('A' <= digit && digit <= 'F')
-                digit_value = digit - 'A' + 10;
-            else
-                unreachable();  // GCOVR_EXCL_LINE
-
-            int bits_per_digit = (info.base == 2) ? 1 : (info.base == 8) ? 3 : 4;
-            for (int b = 0;
-                 b < bits_per_digit && bit_index < input_variant_count;
-                 b++, bit_index++)
-                table.push_back((digit_value >> b) & 1);
-        }
+             it != num_str.rend() && bit_index < bit_count;
+             ++it, bit_index += bits_per_digit) {
+            uint64_t value = digit_value(*it);
+            size_t shift = bit_index % 64;
 
-        for (; bit_index < input_variant_count; bit_index++)
-            table.push_back(false);
+            words[bit_index / 64] |= value << shift;
+
+            /* octal digits may cross words */
+            if (shift + bits_per_digit > 64 &&
+                bit_index / 64 + 1 < words.size())
+                words[bit_index / 64 + 1] |= value >> (64 - shift);
+        }
     }
+
+    if (bit_count < 64)
+        words[0] &= (uint64_t { 1 } << bit_count) - 1;
 }
 
 void Interpreter::interpret_lut(struct rdesc_node &lut) {
@@ -147,29 +382,13 @@ void Interpreter::interpret_lut(struct rdesc_node &lut) {
     size_t output_size = get_seminfo<NumInfo>(nt.children[4])->decimal();
     LutId id = get_seminfo<IdentInfo>(nt.children[6])->id;
 
-    auto lookup_table_ = get_rrr_seminfo<NumInfo>(nt.children[9]);
+    vector<NumInfo> outputs;
+    for (auto &info : get_rrr_seminfo<NumInfo>(nt.children[9]))
+        outputs.push_back(std::move(*info));
     /* end of serialization */
 
-    if (lookup_table_.size() != output_size)
-        throw std::length_error("lookup table does not match output size "
-                                "with lut");
-    /* end of validation */
-
-    vector<bool> lookup_table;
-    lookup_table.reserve((1 << input_size) * output_size);
-
-    for (auto &output_values : lookup_table_)
-        parse_lut_num_info(lookup_table, 1 << input_size, *output_values);
-
-    luts.emplace(
-        piecewise_construct,
-        forward_as_tuple(id),
-        forward_as_tuple(
-            interpret_table(*nt.children[11]),
-            id, input_size, output_size,
-            std::move(lookup_table)
-        )
-    );
+    define_lut(id, input_size, output_size, outputs,
+               interpret_table(*nt.children[11]), nt.variant == 1);
 };
 
 void Interpreter::interpret_wire(struct rdesc_node &wire) {
@@ -178,15 +397,8 @@ void Interpreter::interpret_wire(struct rdesc_node &wire) {
     WireId id = get_seminfo<IdentInfo>(nt.children[1])->id;
     bool state = get_seminfo<NumInfo>(nt.children[3])->decimal() != 0;
     /* end of serialization */
-    /* end of validation */
 
-    wires.emplace(
-        piecewise_construct,
-        forward_as_tuple(id),
-        forward_as_tuple(
-            interpret_table(*nt.children[4]), id, state
-        )
-    );
+    define_wire(id, state, interpret_table(*nt.children[4]));
 };
 
 void Interpreter::interpret_unit(struct rdesc_node &unit) {
@@ -199,6 +411,52 @@ void Interpreter::interpret_unit(struct rdesc_node &unit) {
     auto output_wires = get_rrr_ident_id(nt.children[11]);
     /* end of serialization */
 
+    define_unit(id, lut_id, std::move(input_wires), std::move(output_wires),
+                interpret_table(*nt.children[13]));
+};
+
+void Interpreter::define_lut(LutId id, size_t input_size, size_t output_size,
+                             std::span<const NumInfo> outputs, Table table,
+                             bool clocked) {
+    if (outputs.size() != output_size)
+        throw std::length_error("lookup table does not match output size "
+                                "with lut");
+    if (input_size > Lut::MAX_INPUTS)
+        throw std::length_error("lut has too many inputs");
+    /* end of validation */
+
+    size_t word_count = ((size_t { 1 } << input_size) + 63) / 64;
+    vector<uint64_t> words(word_count * output_size);
+
+    for (size_t o = 0; o < output_size; o++)
+        decode_literal(span { words.data() + o * word_count, word_count },
+                       size_t { 1 } << input_size, outputs[o]);
+
+    revision++;
+    luts.emplace(
+        piecewise_construct,
+        forward_as_tuple(id),
+        forward_as_tuple(
+            table, id, input_size, output_size,
+            std::move(words), clocked
+        )
+    );
+}
+
+void Interpreter::define_wire(WireId id, bool state, Table table) {
+    /* end of validation */
+
+    revision++;
+    wires.emplace(
+        piecewise_construct,
+        forward_as_tuple(id),
+        forward_as_tuple(table, id, state)
+    );
+}
+
+void Interpreter::define_unit(UnitId id, LutId lut_id,
+                              vector<WireId> &&input_wires,
+                              vector<WireId> &&output_wires, Table table) {
     auto validate_input_wires = [this](const auto &wire_ids) {
         for (auto &id : wire_ids)
             if (!wires.contains(id))
@@ -222,22 +480,26 @@ void Interpreter::interpret_unit(struct rdesc_node &unit) {
     for (auto input_wire : input_wires)
         wires.at(input_wire).affects.insert(id);
 
+    revision++;
     units.emplace(
         piecewise_construct,
         forward_as_tuple(id),
         forward_as_tuple(
-            interpret_table(*nt.children[13]),
-            id, lut_id,
+            table, id, lut_id,
             std::move(input_wires),
             std::move(output_wires)
         )
     );
-};
+}
 
 enum rdesc_result Interpreter::pump(struct rdesc_cfg_token tk) {
     struct rdesc_node *cst = NULL;
 
-    auto res = rdesc.pump(&cst, &tk);
+    enum rdesc_result res;
+    {
+        Profile::Timer timer { profile, Phase::PARSE };
+        res = rdesc.pump(&cst, &tk);
+    }
 
     switch (res) {
     case RDESC_CONTINUE:
@@ -251,6 +513,7 @@ enum rdesc_result Interpreter::pump(struct rdesc_cfg_token tk) {
     }
 
     struct rdesc_node &stmt = *cst->nt.children[0];
+    Profile::Timer timer { profile, Phase::INTERPRET };
 
     try {
         switch (stmt.nt.id) {
@@ -14,10 +14,23 @@ using std::ostream;
 
 
 struct rdesc_cfg_token Lex::next() {
+    enum tk id = next_bare();
+
+    switch (id) {
+    case TK_NUM:
+        return { id, new NumInfo { last_num } };
+    case TK_IDENT:
+        return { id, new IdentInfo { last_ident } };
+    default:
+        return { id, nullptr };
+    }
+}
+
+enum tk Lex::next_bare() {
     char c = skip_space();
 
     if (isspace(c) || s.eof())
-        return { TK_EOF, nullptr };
+        return TK_EOF;
 
     if (c == '/')
         return skip_comment();
@@ -39,10 +52,10 @@ bool is_breaking(char c) {
     return isspace(c) || c == '/';
 }
 
-struct rdesc_cfg_token Lex::skip_comment() {
+enum tk Lex::skip_comment() {
     if (s.peek() != '*') {
         // syntax error, / should followed by *
-        return { TK_NOTOKEN, nullptr };
+        return TK_NOTOKEN;
     }
 
     char c;
@@ -51,12 +64,12 @@ struct rdesc_cfg_token Lex::skip_comment() {
 
         if (c == '*' && s.peek() == '/') {
             s.get();
-            return Lex::next();
+            return Lex::next_bare();
         }
     }
 
     // syntax error, unterminated comment
-    return { TK_NOTOKEN, nullptr };
+    return TK_NOTOKEN;
 }
 
 char Lex::skip_space() {
@@ -69,9 +82,11 @@ char Lex::skip_space() {
     return c;
 }
 
-struct rdesc_cfg_token Lex::lex_num(char c) {
+enum tk Lex::lex_num(char c) {
     int base = 10;
-    string num;
+    string &num = last_num.num;
+
+    num.clear();
 
     if (c == '0') {
         switch (s.peek()) {
@@ -113,40 +128,42 @@ struct rdesc_cfg_token Lex::lex_num(char c) {
         if (num.length() == 0)
             num += '0';
 
-        auto *seminfo = new NumInfo { base, num };
+        last_num.base = base;
 
         if (!s.eof())
             s.unget();
 
-        return { TK_NUM, seminfo };
+        return TK_NUM;
     } else {
         // syntax error, probably number continued with an alphanumeric
         // character
-        return { TK_NOTOKEN, nullptr };
+        return TK_NOTOKEN;
     }
 }
 
-struct rdesc_cfg_token Lex::lex_punctuation(char c) {
+enum tk Lex::lex_punctuation(char c) {
     if (c == '-') {
         char peek = s.get();
         if (peek == '>')
-            return { TK_RARROW, nullptr };
+            return TK_RARROW;
         else
-            return { TK_NOTOKEN, nullptr };  // syntax error, malformed rarrow
+            return TK_NOTOKEN;  // syntax error, malformed rarrow
     }
 
     for (int i = TK_LPAREN; i <= TK_EQ; i++)
         if (c == tk_names[i][0]) {
             lookahead = (enum tk) i;
-            return { i, nullptr }; // punctuation
+            return lookahead; // punctuation
         }
 
 
-    return { TK_NOTOKEN, nullptr };
+    return TK_NOTOKEN;
 }
 
-struct rdesc_cfg_token Lex::lex_ident_or_keyword(char c) {
-    string ident;
+enum tk Lex::lex_ident_or_keyword(char c) {
+    string &ident = ident_buf;
+
+    ident.clear();
 
     while (
         (isalnum(c) || c == '_')
@@ -160,21 +177,24 @@ struct rdesc_cfg_token Lex::lex_ident_or_keyword(char c) {
         if (!s.eof())
             s.unget();
 
-        for (int i = TK_LUT; i <= TK_UNIT; i++)
+        for (int i = TK_LUT; i <= TK_REG; i++)
             if (ident == tk_names[i]) {
-                return { i, nullptr }; // keyword
+                return (enum tk) i; // keyword
             }
 
-        auto *seminfo = new IdentInfo { Lex::get_ident_id(ident) };
+        last_ident = Lex::get_ident_id(ident);
 
-        return { TK_IDENT, seminfo };
+        return TK_IDENT;
     } else {
         // syntax error, invalid token just after the identifier
-        return { TK_NOTOKEN, nullptr };
+        return TK_NOTOKEN;
     }
 }
 
 size_t Lex::get_ident_id(const string &s) {
+    if (ident_owner != this)
+        return ident_owner->get_ident_id(s);
+
     size_t &id = idents[s];
 
     if (id == 0) {
@@ -187,5 +207,8 @@ size_t Lex::get_ident_id(const string &s) {
 }
 
 const std::string &Lex::ident_name(size_t i) const {
+    if (ident_owner != this)
+        return ident_owner->ident_name(i);
+
     return ident_names[i - 1];
 }
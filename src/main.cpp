@@ -4,59 +4,354 @@
 #include "../include/rdesc.hpp"
 #include "../include/lex.hpp"
 #include "../include/interpreter.hpp"
+#include "../include/activity.hpp"
+#include "../include/drivers.hpp"
+#include "../include/fault.hpp"
+#include "../include/format.hpp"
+#include "../include/fourstate.hpp"
+#include "../include/optimize.hpp"
+#include "../include/parser.hpp"
+#include "../include/partition.hpp"
+#include "../include/placement.hpp"
+#include "../include/profile.hpp"
 
 #include <X11/Xlib.h>
 #include <rdesc/rdesc.h>
 
 #include <memory>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
-using std::cerr, std::endl;
+using std::cout, std::cerr, std::endl;
 using std::ifstream, std::ios_base;
 using std::string;
-using std::make_shared;
+using std::vector;
+using std::make_shared, std::shared_ptr;
 
 
+/** @brief Tokens lexed per LEX timer. */
+constexpr size_t LEX_BATCH = 256;
+
+
+/* applies patterns in order, without a window */
+static void run_patterns(Interpreter &intr, const vector<Pattern> &patterns,
+                         Profile *profile, Activity *activity) {
+    Simulation sim { intr };
+
+    sim.set_profile(profile);
+    sim.set_activity(activity);
+
+    for (auto &pattern : patterns) {
+        Profile::Timer timer { profile, Phase::SIMULATE };
+        sim.apply(pattern);
+    }
+
+    sim.set_activity(nullptr);
+}
+
+/* applies patterns in processes of their own, one for every part */
+static void run_partitioned(Interpreter &intr, const vector<Pattern> &patterns,
+                            size_t part_count, Pinning pinning,
+                            Profile *profile) {
+    Partition partition { intr.get_wires(), intr.get_units(), part_count };
+    partition.dump(cerr);
+
+    ParallelSim parallel { intr, partition };
+    parallel.set_pinning(pinning);
+
+    Profile::Timer timer { profile, Phase::SIMULATE };
+    parallel.run(patterns);
+}
+
+/* false on unknown names */
+static bool parse_pinning(const string &name, Pinning &pinning) {
+    if (name == "none")
+        pinning = Pinning::NONE;
+    else if (name == "compact")
+        pinning = Pinning::COMPACT;
+    else if (name == "scatter")
+        pinning = Pinning::SCATTER;
+    else
+        return false;
+
+    return true;
+}
+
+static bool parse_huge_pages(const string &name, HugePages &mode) {
+    if (name == "none")
+        mode = HugePages::NONE;
+    else if (name == "transparent")
+        mode = HugePages::TRANSPARENT;
+    else if (name == "explicit")
+        mode = HugePages::EXPLICIT;
+    else
+        return false;
+
+    return true;
+}
+
+/* applies patterns in four-state logic, and writes wires left unknown */
+static void run_four_state(Interpreter &intr, const vector<Pattern> &patterns,
+                           const Lex &lex) {
+    FourState fs { intr };
+    fs.settle();
+
+    for (auto &pattern : patterns) {
+        vector<Stimulus4> stimuli;
+        for (auto &[id, value] : pattern)
+            stimuli.emplace_back(id, value ? Logic::L1 : Logic::L0);
+
+        fs.apply(stimuli);
+    }
+
+    fs.dump_unknown(cout, lex);
+}
+
+/* removes logic that patterns do not change, or that reaches no wire read by
+ * nothing or probed */
+static void optimize(Interpreter &intr, Lex &lex,
+                     const vector<Pattern> &patterns,
+                     const vector<string> &probes) {
+    vector<WireId> observed;
+
+    if (!probes.empty()) {
+        for (auto &[id, wire] : intr.get_wires())
+            if (wire.affects.empty())
+                observed.push_back(id);
+
+        for (auto &name : probes) {
+            WireId id = lex.get_ident_id(name);
+
+            if (!intr.get_wires().contains(id))
+                throw std::invalid_argument("unknown wire " + name);
+
+            observed.push_back(id);
+        }
+    }
+
+    std::set<WireId> stimulated;
+    for (auto &pattern : patterns)
+        for (auto &[id, _] : pattern)
+            stimulated.insert(id);
+
+    vector<WireId> constants;
+    for (auto &[id, _] : intr.get_wires())
+        if (!stimulated.contains(id))
+            constants.push_back(id);
+
+    Optimizer { intr, lex }.run(observed, constants).dump(cerr);
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " <simulation_file>" << endl;
+    bool profiling = false;
+    bool four_state = false;
+    bool optimizing = false;
+    bool reference = false;
+    bool dumping = false;
+    bool raster = false;
+    bool hud = false;
+    WriteOptions write_options;
+    vector<string> probes;
+    size_t partitions = 0;
+    Pinning pinning = Pinning::NONE;
+    HugePages huge_page_mode = huge_pages();
+    const char *faults_path = nullptr;
+    const char *run_path = nullptr;
+    const char *activity_path = nullptr;
+
+    int arg = 1;
+    for (; arg < argc - 1; arg++) {
+        string opt = argv[arg];
+
+        if (opt == "--profile")
+            profiling = true;
+        else if (opt == "--rdesc")
+            reference = true;
+        else if (opt == "--dump")
+            dumping = true;
+        else if (opt == "--raster")
+            raster = true;
+        else if (opt == "--hud")
+            hud = true;
+        else if (opt == "--no-ids")
+            write_options.ids = false;
+        else if (opt == "--no-metadata")
+            write_options.metadata = false;
+        else if (opt == "--hex")
+            write_options.hex = true;
+        else if (opt == "--faults" && arg + 2 < argc)
+            faults_path = argv[++arg];
+        else if (opt == "--four-state")
+            four_state = true;
+        else if (opt == "--optimize")
+            optimizing = true;
+        else if (opt == "--probe" && arg + 2 < argc)
+            probes.push_back(argv[++arg]);
+        else if (opt == "--run" && arg + 2 < argc)
+            run_path = argv[++arg];
+        else if (opt == "--activity" && arg + 2 < argc)
+            activity_path = argv[++arg];
+        else if (opt == "--partitions" && arg + 2 < argc)
+            partitions = std::strtoul(argv[++arg], nullptr, 10);
+        else if (opt == "--pin" && arg + 2 < argc &&
+                 parse_pinning(argv[arg + 1], pinning))
+            arg++;
+        else if (opt == "--huge-pages" && arg + 2 < argc &&
+                 parse_huge_pages(argv[arg + 1], huge_page_mode))
+            arg++;
+        else
+            break;
+    }
+
+    if (arg != argc - 1 || (faults_path && run_path) ||
+        ((four_state || optimizing || partitions) && !run_path) ||
+        (partitions && (four_state || activity_path)) ||
+        (dumping && (faults_path || run_path)) ||
+        ((raster || hud) && (dumping || faults_path || run_path))) {
+        cerr << "Usage: " << argv[0] << " [--profile] [--rdesc]"
+            " [--activity <saif_file>] [--raster] [--hud]"
+            " [--pin <none|compact|scatter>]"
+            " [--huge-pages <none|transparent|explicit>]"
+            " [--dump [--no-ids] [--no-metadata] [--hex] |"
+            " [--faults <pattern_file> |"
+            " [--four-state | --partitions <n>]"
+            " [--optimize [--probe <wire>]...]"
+            " --run <pattern_file>]]"
+            " <simulation_file>" << endl;
 
         return EXIT_FAILURE;
     }
 
-    ifstream file(argv[1], ios_base::in);
+    set_huge_pages(huge_page_mode);
+
+    const char *path = argv[argc - 1];
+    ifstream file(path, ios_base::in);
 
     auto lex = make_shared<Lex>(file);
     auto intr = make_shared<Interpreter>(global_cfg()->new_parser());
 
-    enum rdesc_result res;
-    while (true) {
-        auto tk = lex->next();
+    /* only a window draws `_shape`, `_path` and `_pos`, so nothing else
+     * builds their tables */
+    if (faults_path || run_path || (dumping && !write_options.metadata))
+        intr->strip_metadata(lex);
+
+    shared_ptr<Profile> profile;
+    if (profiling) {
+        profile = make_shared<Profile>();
+        intr->set_profile(profile.get());
+    }
+
+    shared_ptr<Activity> activity;
+    if (activity_path)
+        activity = make_shared<Activity>();
+
+    auto syntax_error = [&]() {
+        string line;
+        std::getline(file, line);
+        cerr << "Syntax error near: \n" << line << endl;
+
+        return EXIT_FAILURE;
+    };
+
+    if (reference) {
+        /* tokens are lexed in batches, so LEX is timed once per batch */
+        vector<struct rdesc_cfg_token> tokens;
+        tokens.reserve(LEX_BATCH);
+
+        enum rdesc_result res;
+        for (bool eof = false; !eof;) {
+            {
+                Profile::Timer timer { profile.get(), Phase::LEX };
+
+                tokens.clear();
+                do
+                    tokens.push_back(lex->next());
+                while (tokens.size() < LEX_BATCH &&
+                       tokens.back().id != TK_EOF &&
+                       tokens.back().id != TK_NOTOKEN);
+            }
 
-        if (tk.id == TK_NOTOKEN) {
-            string line;
-            std::getline(file, line);
-            cerr << "Syntax error near: \n" << line << endl;
+            for (struct rdesc_cfg_token &tk : tokens) {
+                if (tk.id == TK_NOTOKEN)
+                    return syntax_error();
+
+                if (tk.id == TK_EOF) {
+                    eof = true;
+                    break;
+                }
+
+                res = intr->pump(tk);
+
+                if (res == RDESC_NOMATCH)
+                    cerr << "Syntax error, ignoring a statement" << endl;
+            }
+        }
+    } else {
+        Parser parser { *intr, *lex };
+
+        Parsed res;
+        while ((res = parser.next()) != Parsed::END) {
+            if (res == Parsed::BAD_TOKEN)
+                return syntax_error();
+
+            if (res == Parsed::NOMATCH)
+                cerr << "Syntax error, ignoring a statement" << endl;
+        }
+    }
+
+    intr->drivers().dump_problems(cerr, *lex);
+
+    if (dumping) {
+        Writer { cout, *lex, write_options }.write(*intr);
+    } else if (faults_path || run_path) {
+        ifstream patterns_file(faults_path ? faults_path : run_path,
+                               ios_base::in);
+
+        try {
+            auto patterns = read_patterns(patterns_file, *lex, *intr);
+
+            if (optimizing)
+                optimize(*intr, *lex, patterns, probes);
+
+            if (faults_path) {
+                FaultSim fs { *intr };
+                fs.set_pinning(pinning);
+                fs.run(patterns).dump(cout, *lex);
+            }
+            else if (four_state)
+                run_four_state(*intr, patterns, *lex);
+            else if (partitions)
+                run_partitioned(*intr, patterns, partitions, pinning,
+                                profile.get());
+            else
+                run_patterns(*intr, patterns, profile.get(), activity.get());
+        } catch (std::exception &e) {
+            cerr << "Simulation failed: " << e.what() << endl;
 
             return EXIT_FAILURE;
-        } else if (tk.id == TK_EOF) {
-            break;
         }
+    } else {
+        XInitThreads();
 
-        res = intr->pump(tk);
+        App app { intr, lex, path, profile, activity, raster, hud };
 
-        if (res == RDESC_NOMATCH)
-            cerr << "Syntax error, ignoring a statement" << endl;
-    };
+        app.init();
+    }
 
-    XInitThreads();
-    App app { intr, lex };
+    if (profile)
+        profile->report(cerr, *lex);
 
-    app.init();
+    if (activity) {
+        std::ofstream saif(activity_path, ios_base::out);
+        activity->dump_saif(saif, *lex);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,404 @@
+#include "../include/optimize.hpp"
+#include "../include/drivers.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using std::vector, std::map;
+using std::string;
+using std::ostream;
+using std::piecewise_construct, std::forward_as_tuple;
+
+
+/* widest set of non-constant inputs whose values are all tried */
+static const int FOLD_INPUTS = 16;
+
+OptReport Optimizer::run(vector<WireId> observed,
+                         const vector<WireId> &constants) {
+    auto &wires = intr.wires;
+
+    report = OptReport { intr.units.size(), intr.wires.size() };
+
+    if (observed.empty())
+        for (auto &[id, wire] : wires)
+            if (wire.affects.empty())
+                observed.push_back(id);
+
+    /* every wire is read, by loops */
+    if (observed.empty())
+        for (auto &[id, _] : wires)
+            observed.push_back(id);
+
+    size_t size = wires.empty() ? 0 : wires.rbegin()->first + 1;
+    known.assign(size, -1);
+    pinned.assign(size, false);
+
+    for (WireId id : constants)
+        if (wires.contains(id))
+            known[id] = wires.at(id).state;
+
+    {
+        const Drivers &drivers = intr.drivers();
+
+        /* driven wires are not constants, undriven ones are inputs */
+        for (auto &[id, _] : wires)
+            if (!drivers.of(id).empty())
+                known[id] = -1;
+            else if (known[id] < 0)
+                pinned[id] = true;
+    }
+
+    for (WireId id : observed)
+        if (id < size)
+            pinned[id] = true;
+
+    for (auto &[id, lut] : intr.luts)
+        if (lut.output_size == 1 && !lut.clocked) {
+            vector<bool> table;
+            for (size_t m = 0; m < lut.input_variant_count(); m++)
+                table.push_back(lut.lookup(m, 0));
+
+            lut_ids.try_emplace({ lut.input_size, std::move(table) }, id);
+        }
+
+    fold();
+    collapse();
+    sweep(observed);
+    fuse();
+
+    report.units_after = intr.units.size();
+    report.wires_after = intr.wires.size();
+
+    return report;
+}
+
+vector<UnitId> Optimizer::order(const Drivers &drivers) const {
+    auto &units = intr.units;
+    auto &luts = intr.luts;
+
+    size_t size = units.empty() ? 0 : units.rbegin()->first + 1;
+    vector<size_t> waiting(size);
+    vector<UnitId> res;
+
+    auto combinational = [&](UnitId id) {
+        return !luts.at(units.at(id).lut_id).clocked;
+    };
+
+    for (auto &[id, unit] : units) {
+        if (!combinational(id))
+            continue;
+
+        for (WireId wire_id : unit.input_wires)
+            for (auto &port : drivers.of(wire_id))
+                waiting[id] += combinational(port.unit);
+
+        if (waiting[id] == 0)
+            res.push_back(id);
+    }
+
+    /* Kahn's algorithm, over readers of outputs, which may read a wire more
+     * than once */
+    for (size_t i = 0; i < res.size(); i++)
+        for (WireId wire_id : units.at(res[i]).output_wires)
+            for (UnitId reader : intr.wires.at(wire_id).affects) {
+                if (!combinational(reader))
+                    continue;
+
+                auto &inputs = units.at(reader).input_wires;
+                waiting[reader] -=
+                    std::count(inputs.begin(), inputs.end(), wire_id);
+
+                if (waiting[reader] == 0)
+                    res.push_back(reader);
+            }
+
+    return res;
+}
+
+void Optimizer::fold() {
+    const Drivers &drivers = intr.drivers();
+
+    for (UnitId id : order(drivers)) {
+        const Unit &unit = intr.units.at(id);
+        const Lut &lut = intr.luts.at(unit.lut_id);
+
+        size_t index = 0, free = 0;
+        for (size_t i = 0; i < unit.input_wires.size(); i++) {
+            int8_t state = known[unit.input_wires[i]];
+
+            if (state < 0)
+                free |= size_t { 1 } << i;
+            else
+                index |= size_t { static_cast<uint8_t>(state) } << i;
+        }
+
+        if (std::popcount(free) > FOLD_INPUTS)
+            continue;
+
+        bool constant = true;
+        vector<bool> outputs;
+
+        for (size_t o = 0; constant && o < lut.output_size; o++) {
+            bool value = lut.lookup(index, o);
+
+            /* every value of non-constant inputs, as subsets of `free` */
+            for (size_t sub = free; constant && sub; sub = (sub - 1) & free)
+                constant = lut.lookup(index | sub, o) == value;
+
+            outputs.push_back(value);
+        }
+
+        for (WireId wire_id : unit.output_wires)
+            constant &= drivers.of(wire_id).size() == 1;
+
+        if (!constant)
+            continue;
+
+        for (size_t o = 0; o < outputs.size(); o++) {
+            WireId wire_id = unit.output_wires[o];
+
+            known[wire_id] = outputs[o];
+            intr.wires.at(wire_id).state = outputs[o];
+        }
+
+        remove_unit(id);
+        report.folded++;
+    }
+
+    intr.revision++;
+}
+
+void Optimizer::collapse() {
+    auto &units = intr.units;
+    auto &luts = intr.luts;
+
+    const Drivers &drivers = intr.drivers();
+
+    for (UnitId id : order(drivers)) {
+        const Unit &unit = units.at(id);
+        const Lut &lut = luts.at(unit.lut_id);
+
+        if (lut.input_size != 1 || lut.output_size != 1)
+            continue;
+
+        WireId middle = unit.input_wires[0];
+        auto ports = drivers.of(middle);
+
+        if (pinned[middle] || ports.size() != 1 ||
+            intr.wires.at(middle).affects.size() != 1)
+            continue;
+
+        const Unit &driver = units.at(ports[0].unit);
+        const Lut &driver_lut = luts.at(driver.lut_id);
+
+        if (driver_lut.output_size != 1 || driver_lut.clocked)
+            continue;
+
+        vector<bool> table;
+        for (size_t m = 0; m < driver_lut.input_variant_count(); m++)
+            table.push_back(lut.lookup(driver_lut.lookup(m, 0), 0));
+
+        LutId lut_id = lut_of(driver_lut.input_size, std::move(table),
+                              lex.ident_name(driver_lut.id) + "_" +
+                              lex.ident_name(lut.id));
+
+        absorb(id, ports[0].unit, middle,
+               vector<WireId> { driver.input_wires }, lut_id);
+        report.collapsed++;
+    }
+
+    intr.revision++;
+}
+
+void Optimizer::fuse() {
+    auto &units = intr.units;
+    auto &luts = intr.luts;
+
+    const Drivers &drivers = intr.drivers();
+
+    /* drivers come first, so clusters grow from inputs to outputs */
+    for (UnitId id : order(drivers)) {
+        for (bool merged = true; merged;) {
+            merged = false;
+
+            const Unit &unit = units.at(id);
+            const Lut &lut = luts.at(unit.lut_id);
+
+            if (lut.output_size != 1)
+                break;
+
+            for (WireId middle : unit.input_wires) {
+                auto ports = drivers.of(middle);
+
+                if (pinned[middle] || ports.size() != 1 ||
+                    intr.wires.at(middle).affects.size() != 1)
+                    continue;
+
+                const Unit &driver = units.at(ports[0].unit);
+                const Lut &driver_lut = luts.at(driver.lut_id);
+
+                if (driver_lut.output_size != 1 || driver_lut.clocked)
+                    continue;
+
+                vector<WireId> inputs;
+                for (auto *wire_ids : { &unit.input_wires,
+                                        &driver.input_wires })
+                    for (WireId wire_id : *wire_ids)
+                        if (wire_id != middle &&
+                            std::find(inputs.begin(), inputs.end(),
+                                      wire_id) == inputs.end())
+                            inputs.push_back(wire_id);
+
+                if (inputs.size() > FUSE_INPUTS)
+                    continue;
+
+                /* every input value, evaluated through both luts */
+                auto index_of = [&](const vector<WireId> &wire_ids,
+                                    size_t m, bool middle_value) {
+                    size_t index = 0;
+
+                    for (size_t i = 0; i < wire_ids.size(); i++) {
+                        auto it = std::find(inputs.begin(), inputs.end(),
+                                            wire_ids[i]);
+                        bool value = wire_ids[i] == middle ? middle_value :
+                            (m >> (it - inputs.begin())) & 1;
+
+                        index |= size_t { value } << i;
+                    }
+
+                    return index;
+                };
+
+                vector<bool> table;
+                for (size_t m = 0; m < size_t { 1 } << inputs.size(); m++) {
+                    bool value = driver_lut.lookup(
+                        index_of(driver.input_wires, m, false), 0
+                    );
+
+                    table.push_back(
+                        lut.lookup(index_of(unit.input_wires, m, value), 0)
+                    );
+                }
+
+                LutId lut_id = lut_of(inputs.size(), std::move(table),
+                                      "fused" + std::to_string(inputs.size()));
+
+                absorb(id, ports[0].unit, middle, std::move(inputs), lut_id);
+                report.fused++;
+
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    intr.revision++;
+}
+
+void Optimizer::absorb(UnitId id, UnitId driver, WireId middle,
+                       vector<WireId> &&inputs, LutId lut_id) {
+    vector<WireId> outputs = intr.units.at(id).output_wires;
+
+    remove_unit(driver);
+    remove_unit(id);
+    intr.wires.erase(middle);
+
+    for (WireId wire_id : inputs)
+        intr.wires.at(wire_id).affects.insert(id);
+
+    intr.units.emplace(
+        piecewise_construct,
+        forward_as_tuple(id),
+        forward_as_tuple(Table {}, id, lut_id,
+                         std::move(inputs), std::move(outputs))
+    );
+}
+
+void Optimizer::sweep(const vector<WireId> &observed) {
+    auto &units = intr.units;
+    auto &wires = intr.wires;
+
+    auto cone = intr.drivers().cone(observed);
+
+    vector<bool> live(units.empty() ? 0 : units.rbegin()->first + 1);
+    for (UnitId id : cone)
+        live[id] = true;
+
+    vector<UnitId> dead;
+    for (auto &[id, _] : units)
+        if (!live[id])
+            dead.push_back(id);
+
+    for (UnitId id : dead)
+        remove_unit(id);
+    report.dead = dead.size();
+
+    vector<bool> driven(known.size());
+    for (auto &[_, unit] : units)
+        for (WireId id : unit.output_wires)
+            driven[id] = true;
+
+    for (auto it = wires.begin(); it != wires.end();)
+        if (!pinned[it->first] && !driven[it->first] &&
+            it->second.affects.empty())
+            it = wires.erase(it);
+        else
+            it++;
+
+    intr.revision++;
+}
+
+void Optimizer::remove_unit(UnitId id) {
+    for (WireId wire_id : intr.units.at(id).input_wires)
+        if (intr.wires.contains(wire_id))
+            intr.wires.at(wire_id).affects.erase(id);
+
+    intr.units.erase(id);
+}
+
+LutId Optimizer::lut_of(size_t input_size, vector<bool> &&table,
+                        const string &name) {
+    auto it = lut_ids.find({ input_size, table });
+    if (it != lut_ids.end())
+        return it->second;
+
+    /* identifiers are shared by every kind of object */
+    string unique = name;
+    LutId id;
+    for (size_t i = 1;; i++) {
+        id = lex.get_ident_id(unique);
+
+        if (!intr.luts.contains(id) && !intr.wires.contains(id) &&
+            !intr.units.contains(id))
+            break;
+
+        unique = name + "_" + std::to_string(i);
+    }
+
+    vector<bool> copy = table;
+    intr.luts.emplace(
+        piecewise_construct,
+        forward_as_tuple(id),
+        forward_as_tuple(Table {}, id, input_size, 1, std::move(copy))
+    );
+    lut_ids.try_emplace({ input_size, std::move(table) }, id);
+
+    return id;
+}
+
+ostream &OptReport::dump(ostream &os) const {
+    return os << "Removed " << units_before - units_after << " of " <<
+        units_before << " units (" << dead << " dead, " << folded <<
+        " folded, " << collapsed << " collapsed, " << fused << " fused) and " <<
+        wires_before - wires_after << " of " << wires_before << " wires\n";
+}
@@ -0,0 +1,302 @@
+#include "../include/parser.hpp"
+#include "../include/grammar.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/profile.hpp"
+#include "../include/table.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+
+void Parser::fill() {
+    Profile::Timer timer { intr.profile, Phase::LEX, Phase::PARSE };
+
+    if (tokens.empty())
+        tokens.resize(TOKEN_BATCH);
+
+    token_count = 0;
+    token_at = 0;
+
+    while (token_count < TOKEN_BATCH) {
+        Token &token = tokens[token_count++];
+
+        token.id = lex.next_bare();
+
+        if (token.id == TK_NUM)
+            token.num = lex.num();
+        else if (token.id == TK_IDENT)
+            token.ident = lex.ident();
+        else if (token.id == TK_EOF || token.id == TK_NOTOKEN)
+            break;
+    }
+}
+
+Parsed Parser::next() {
+    bool parsed = false;
+    {
+        Profile::Timer timer { intr.profile, Phase::PARSE };
+
+        has_table = false;
+        valid_points = true;
+
+        switch (advance()) {
+        case TK_SEMI:
+            kind = NT_STMT;
+            parsed = true;
+            break;
+        case TK_LUT:
+        case TK_REG:
+            parsed = parse_lut(tk == TK_REG);
+            break;
+        case TK_WIRE:
+            parsed = parse_wire();
+            break;
+        case TK_UNIT:
+            parsed = parse_unit();
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!parsed)
+        return tk == TK_EOF ? Parsed::END :
+            tk == TK_NOTOKEN ? Parsed::BAD_TOKEN : Parsed::NOMATCH;
+
+    /* rejected once the statement is read, as `pump` rejects it */
+    if (!valid_points)
+        throw std::invalid_argument("invalid metadata point");
+
+    Profile::Timer timer { intr.profile, Phase::INTERPRET };
+
+    switch (kind) {
+    case NT_LUT:
+        intr.define_lut(id, input_size, output_size,
+                        std::span { nums.data(), num_count },
+                        commit_table(), clocked);
+        break;
+    case NT_WIRE:
+        intr.define_wire(id, state, commit_table());
+        break;
+    case NT_UNIT:
+        intr.define_unit(id, lut_id, std::move(inputs), std::move(outputs),
+                         commit_table());
+        break;
+    default:
+        break;
+    }
+
+    return Parsed::READY;
+}
+
+bool Parser::parse_lut(bool clocked_) {
+    kind = NT_LUT;
+    clocked = clocked_;
+
+    if (!expect(TK_LANGLE_BRACKET) || !expect(TK_NUM))
+        return false;
+    input_size = num().decimal();
+
+    if (!expect(TK_COMMA) || !expect(TK_NUM))
+        return false;
+    output_size = num().decimal();
+
+    if (!expect(TK_RANGLE_BRACKET) || !expect(TK_IDENT))
+        return false;
+    id = ident();
+
+    if (!expect(TK_EQ) || !expect(TK_LPAREN))
+        return false;
+
+    /* literals are assigned over the previous ones, keeping their buffers */
+    num_count = 0;
+    do {
+        if (!expect(TK_NUM))
+            return false;
+
+        if (num_count < nums.size())
+            nums[num_count] = num();
+        else
+            nums.push_back(num());
+
+        num_count++;
+    } while (advance() == TK_COMMA);
+
+    return tk == TK_RPAREN && parse_end();
+}
+
+bool Parser::parse_wire() {
+    kind = NT_WIRE;
+
+    if (!expect(TK_IDENT))
+        return false;
+    id = ident();
+
+    if (!expect(TK_EQ) || !expect(TK_NUM))
+        return false;
+    state = num().decimal() != 0;
+
+    return parse_end();
+}
+
+bool Parser::parse_unit() {
+    kind = NT_UNIT;
+
+    if (!expect(TK_LANGLE_BRACKET) || !expect(TK_IDENT))
+        return false;
+    lut_id = ident();
+
+    if (!expect(TK_RANGLE_BRACKET) || !expect(TK_IDENT))
+        return false;
+    id = ident();
+
+    /* wire lists are moved into the unit */
+    inputs.clear();
+    outputs.clear();
+
+    return expect(TK_EQ) && expect(TK_LPAREN) && parse_idents(inputs) &&
+        expect(TK_RARROW) && expect(TK_LPAREN) && parse_idents(outputs) &&
+        parse_end();
+}
+
+bool Parser::parse_idents(vector<size_t> &ids) {
+    do {
+        if (!expect(TK_IDENT))
+            return false;
+
+        ids.push_back(ident());
+    } while (advance() == TK_COMMA);
+
+    return tk == TK_RPAREN;
+}
+
+bool Parser::parse_end() {
+    if (advance() == TK_LCURLY) {
+        if (!parse_table())
+            return false;
+
+        advance();
+    }
+
+    return tk == TK_SEMI;
+}
+
+bool Parser::parse_table() {
+    has_table = true;
+
+    entries.clear();
+    points.clear();
+    breaks.clear();
+
+    do {
+        if (!expect(TK_IDENT))
+            return false;
+        TableKeyId key = ident();
+
+        TableValue value;
+        if (!expect(TK_COLON) || !parse_value(value))
+            return false;
+
+        entries.emplace_back(key, value);
+    } while (advance() == TK_COMMA);
+
+    return tk == TK_RCURLY;
+}
+
+bool Parser::parse_value(TableValue &value) {
+    switch (advance()) {
+    case TK_NUM:
+        value.kind = TableValue::NUM;
+        value.num = num().decimal();
+        return true;
+    case TK_IDENT:
+    case TK_LPAREN:
+        value.kind = TableValue::POINT;
+        return parse_point(value.point);
+    case TK_LBRACKET:
+        break;
+    default:
+        return false;
+    }
+
+    uint32_t first = points.size();
+
+    do {
+        TablePoint point {};
+
+        advance();
+        if (!parse_point(point))
+            return false;
+
+        points.push_back(point);
+        breaks.push_back(advance() == TK_SEMI);
+    } while (tk == TK_COMMA || tk == TK_SEMI);
+
+    value.kind = TableValue::PATH;
+    value.path = { first, static_cast<uint32_t>(points.size() - first) };
+
+    return tk == TK_RBRACKET;
+}
+
+bool Parser::parse_point(TablePoint &point) {
+    if (tk == TK_IDENT) {
+        point = TablePoint(TablePoint::IDENT, ident());
+        return true;
+    }
+
+    if (tk != TK_LPAREN || !expect(TK_NUM))
+        return false;
+    uintmax_t x = num().decimal();
+
+    if (!expect(TK_COMMA) || !expect(TK_NUM))
+        return false;
+    uintmax_t y = num().decimal();
+
+    if (TablePoint::fits(x, y))
+        point = TablePoint(x, y);
+    else
+        valid_points = false;
+
+    return expect(TK_RPAREN);
+}
+
+Table Parser::commit_table() {
+    if (!has_table)
+        return Table {};
+
+    Metadata &store = *intr.metadata;
+    size_t kept = 0;
+
+    for (auto &[key, value] : entries) {
+        if (!intr.keeps(key))
+            continue;
+
+        if (value.kind == TableValue::PATH) {
+            TableSubpath range = value.path;
+
+            store.begin_path();
+
+            for (size_t i = range.first; i < range.first + range.count; i++) {
+                store.push_point(points[i]);
+
+                if (breaks[i])
+                    store.break_path();
+            }
+
+            value = store.end_path();
+        }
+
+        entries[kept++] = { key, value };
+    }
+
+    entries.resize(kept);
+
+    return store.commit(entries);
+}
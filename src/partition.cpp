@@ -0,0 +1,673 @@
+#include "../include/partition.hpp"
+#include "../include/bytecode.hpp"
+#include "../include/interpreter.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using std::vector, std::map, std::pair, std::span;
+using std::ostream;
+using std::atomic;
+
+
+Partition::Partition(const map<WireId, Wire> &wires,
+                     const map<UnitId, Unit> &units, size_t part_count) {
+    if (part_count == 0 || part_count > MAX_PARTS)
+        throw std::invalid_argument("part count out of range");
+
+    size_t k = part_count;
+    size_t wire_count = wires.empty() ? 0 : wires.rbegin()->first + 1;
+
+    vector<UnitId> order;
+    vector<bool> driven(wire_count);
+
+    for (auto &[id, unit] : units) {
+        order.push_back(id);
+
+        for (WireId wire_id : unit.output_wires)
+            driven[wire_id] = true;
+    }
+
+    /* driven wires of every unit, once each, and units of every wire */
+    vector<size_t> net_first { 0 };
+    vector<WireId> nets;
+
+    for (auto &[_, unit] : units) {
+        size_t begin = nets.size();
+
+        for (WireId wire_id : unit.input_wires)
+            if (driven[wire_id])
+                nets.push_back(wire_id);
+        nets.insert(nets.end(), unit.output_wires.begin(),
+                    unit.output_wires.end());
+
+        std::sort(nets.begin() + begin, nets.end());
+        nets.erase(std::unique(nets.begin() + begin, nets.end()), nets.end());
+        net_first.push_back(nets.size());
+    }
+
+    vector<size_t> pin_first(wire_count + 1);
+    for (WireId wire : nets)
+        pin_first[wire + 1]++;
+    for (size_t i = 0; i < wire_count; i++)
+        pin_first[i + 1] += pin_first[i];
+
+    vector<uint32_t> pins(nets.size());
+    vector<size_t> fill { pin_first.begin(), pin_first.end() - 1 };
+    for (uint32_t u = 0; u < order.size(); u++)
+        for (size_t n = net_first[u]; n < net_first[u + 1]; n++)
+            pins[fill[nets[n]]++] = u;
+
+    /* parts grow breadth first from the first unit left, through wires
+     * between units, until they hold their share */
+    vector<uint32_t> part_of_unit(order.size(), NONE);
+    vector<uint32_t> queue;
+    size_t seed = 0;
+
+    sizes.assign(k, 0);
+
+    for (size_t part = 0; part < k; part++) {
+        size_t share = (part + 1) * order.size() / k - part * order.size() / k;
+        size_t head = queue.size();
+
+        auto take = [&](uint32_t u) {
+            part_of_unit[u] = part;
+            sizes[part]++;
+            queue.push_back(u);
+        };
+
+        while (sizes[part] < share) {
+            if (head == queue.size()) {
+                while (part_of_unit[seed] != NONE)
+                    seed++;
+
+                take(seed);
+                continue;
+            }
+
+            uint32_t u = queue[head++];
+
+            for (size_t n = net_first[u]; n < net_first[u + 1]; n++) {
+                WireId wire = nets[n];
+
+                for (size_t p = pin_first[wire];
+                     p < pin_first[wire + 1] && sizes[part] < share; p++)
+                    if (part_of_unit[pins[p]] == NONE)
+                        take(pins[p]);
+            }
+        }
+    }
+
+    /* units of every part connected to a wire, and parts it spans */
+    vector<uint32_t> count(wire_count * k);
+    vector<uint32_t> spans(wire_count);
+
+    auto add = [&](WireId wire, size_t part) {
+        if (count[wire * k + part]++ == 0)
+            spans[wire]++;
+    };
+    auto remove = [&](WireId wire, size_t part) {
+        if (--count[wire * k + part] == 0)
+            spans[wire]--;
+    };
+
+    for (size_t u = 0; u < order.size(); u++)
+        for (size_t n = net_first[u]; n < net_first[u + 1]; n++)
+            add(nets[n], part_of_unit[u]);
+
+    double mean = double(order.size()) / k;
+    size_t max_size = std::ceil(mean * (1 + IMBALANCE));
+    size_t min_size = std::floor(mean * (1 - IMBALANCE));
+
+    for (size_t pass = 0; pass < PASSES; pass++) {
+        size_t moves = 0;
+
+        for (size_t u = 0; u < order.size(); u++) {
+            size_t from = part_of_unit[u];
+            span<const WireId> own { nets.data() + net_first[u],
+                                     nets.data() + net_first[u + 1] };
+
+            if (sizes[from] <= min_size)
+                continue;
+
+            /* parts of neighbours */
+            uint64_t candidates = 0;
+            for (WireId wire : own)
+                for (size_t part = 0; part < k; part++)
+                    if (count[wire * k + part])
+                        candidates |= uint64_t { 1 } << part;
+
+            candidates &= ~(uint64_t { 1 } << from);
+
+            long best_gain = 0;
+            size_t best = from;
+
+            for (; candidates; candidates &= candidates - 1) {
+                size_t to = std::countr_zero(candidates);
+
+                if (sizes[to] >= max_size)
+                    continue;
+
+                long gain = 0;
+                for (WireId wire : own) {
+                    uint32_t after = spans[wire] -
+                        (count[wire * k + from] == 1) +
+                        (count[wire * k + to] == 0);
+
+                    gain += (spans[wire] > 1) - (after > 1);
+                }
+
+                if (gain > best_gain ||
+                    (gain == best_gain && best != from &&
+                     sizes[to] < sizes[best])) {
+                    best_gain = gain;
+                    best = to;
+                }
+            }
+
+            if (best == from)
+                continue;
+
+            for (WireId wire : own) {
+                remove(wire, from);
+                add(wire, best);
+            }
+
+            part_of_unit[u] = best;
+            sizes[from]--;
+            sizes[best]++;
+            moves++;
+        }
+
+        if (moves == 0)
+            break;
+    }
+
+    parts.assign(units.empty() ? 0 : units.rbegin()->first + 1, NONE);
+    for (size_t u = 0; u < order.size(); u++)
+        parts[order[u]] = part_of_unit[u];
+
+    for (auto &[id, _] : wires)
+        if (driven[id] && spans[id] > 1)
+            cut_wires.push_back(id);
+}
+
+size_t Partition::part_of(UnitId id) const {
+    if (id >= parts.size() || parts[id] == NONE)
+        throw std::out_of_range("unknown unit");
+
+    return parts[id];
+}
+
+ostream &Partition::dump(ostream &os) const {
+    os << sizes.size() << " parts of";
+    for (size_t size : sizes)
+        os << " " << size;
+
+    return os << " units cut " << cut_wires.size() << " wires\n";
+}
+
+
+/* memory mapped into every process, for queues between pairs of parts,
+ * clocks of parts and final wire states */
+class ParallelSim::Shared {
+public:
+    struct Message {
+        uint64_t stamp /**< generation that sees the change */;
+        WireId wire;
+        bool state;
+    };
+
+    /* single producer, single consumer ring */
+    struct Queue {
+        alignas(64) atomic<uint64_t> head /**< written by the sender */;
+        alignas(64) atomic<uint64_t> tail /**< written by the receiver */;
+        alignas(64) Message ring[QUEUE_SIZE];
+    };
+
+    struct alignas(64) Part {
+        atomic<uint64_t> clock /**< no message stamped up to it will come */;
+        atomic<uint64_t> sent;
+        atomic<uint64_t> evaluations;
+        atomic<uint64_t> huge_page_bytes;
+        atomic<uint64_t> node_bytes[MAX_NODES];
+    };
+
+    struct alignas(64) Header {
+        atomic<int64_t> active /**< parts with wires to evaluate, and
+                                    messages not yet applied */;
+        atomic<uint64_t> epoch /**< generation patterns start after */;
+        atomic<uint64_t> arrived;
+        atomic<uint64_t> rounds /**< of the barrier */;
+        atomic<bool> failed;
+    };
+
+    Shared(size_t parts, size_t queues, size_t wires)
+        : part_count { parts },
+          size { sizeof(Header) + parts * sizeof(Part) +
+                 queues * sizeof(Queue) + wires } {
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+        if (mem == MAP_FAILED)
+            throw std::runtime_error("cannot map shared memory");
+
+        base = static_cast<char *>(mem);
+        header = new (base) Header {};
+        part = new (base + sizeof(Header)) Part[parts] {};
+
+        char *at = base + sizeof(Header) + parts * sizeof(Part);
+        /* rings are first written by their senders */
+        for (size_t i = 0; i < queues; i++, at += sizeof(Queue))
+            queue.push_back(new (at) Queue);
+
+        states = reinterpret_cast<uint8_t *>(at);
+
+        for (size_t i = 0; i < parts; i++)
+            part[i].clock = 1;
+    }
+
+    ~Shared()
+        { munmap(base, size); }
+
+    Shared(const Shared &) = delete;
+    Shared &operator=(const Shared &) = delete;
+
+    /* waits until every part arrives, throws once a part failed */
+    void barrier() {
+        uint64_t round = header->rounds.load();
+
+        if (header->arrived.fetch_add(1) + 1 == part_count) {
+            header->arrived = 0;
+            header->rounds = round + 1;
+
+            return;
+        }
+
+        while (header->rounds.load() == round)
+            wait();
+    }
+
+    /* yields the processor, throws once a part failed */
+    void wait() {
+        if (header->failed.load(std::memory_order_relaxed))
+            throw std::runtime_error("another part failed");
+
+        sched_yield();
+    }
+
+    const size_t part_count;
+
+    Header *header;
+    Part *part;
+    vector<Queue *> queue;
+    uint8_t *states /**< by wire, written by its owner */;
+
+private:
+    size_t size;
+    char *base;
+};
+
+/* simulation of one part, in its own process */
+class ParallelSim::Worker {
+public:
+    Worker(ParallelSim &sim_, Shared &shared_,
+           const vector<uint32_t> &queue_of_, size_t self_)
+        : sim { sim_ }, shared { shared_ }, queue_of { queue_of_ },
+          self { self_ }, part_count { shared.part_count },
+          code { prepare(sim, self), sim.intr.wires, sim.intr.units,
+                 sim.intr.revision } {
+        for (size_t part = 0; part < part_count; part++)
+            if (queue_of[part * part_count + self] != NONE)
+                senders.push_back(shared.queue[
+                    queue_of[part * part_count + self]]);
+    }
+
+    void run(span<const Pattern> patterns) {
+        for (auto &pattern : patterns) {
+            /* every part starts the pattern at the same generation */
+            uint64_t epoch = shared.header->epoch.load();
+            while (epoch < now &&
+                   !shared.header->epoch.compare_exchange_weak(epoch, now))
+                ;
+
+            shared.barrier();
+
+            now = shared.header->epoch.load();
+            shared.part[self].clock = now + 1;
+
+            for (auto &[id, state] : pattern)
+                code.apply(id, state);
+
+            busy = !code.settled();
+            if (busy)
+                shared.header->active++;
+
+            shared.barrier();
+            settle();
+        }
+
+        for (auto &[id, wire] : sim.intr.wires)
+            if (sim.owner[id] == self)
+                shared.states[id] = wire.state;
+
+        auto memory = MemoryReport::of_self();
+        auto &slot = shared.part[self];
+
+        slot.evaluations = evaluations;
+        slot.huge_page_bytes = memory.huge_page_bytes;
+        for (size_t node = 0; node < memory.node_bytes.size() &&
+                              node < MAX_NODES; node++)
+            slot.node_bytes[node] = memory.node_bytes[node];
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    /* leaves only units of the part in the copy of the netlist */
+    static const map<LutId, Lut> &prepare(ParallelSim &sim, size_t self) {
+        std::erase_if(sim.intr.units, [&](auto &it) {
+            return sim.partition.part_of(it.first) != self;
+        });
+
+        return sim.intr.luts;
+    }
+
+    /* runs generations until no part has anything to evaluate */
+    void settle() {
+        vector<pair<WireId, bool>> changes;
+
+        while (true) {
+            /* clocks are read before queues, so that every message stamped
+             * up to `safe` is drained */
+            uint64_t safe = UINT64_MAX, horizon = 0;
+
+            for (size_t part = 0; part < part_count; part++) {
+                uint64_t clock = shared.part[part].clock.load();
+
+                horizon = std::max(horizon, clock - 1);
+                if (part != self &&
+                    queue_of[part * part_count + self] != NONE)
+                    safe = std::min(safe, clock);
+            }
+
+            drain();
+
+            if (shared.header->active.load() == 0)
+                return;
+
+            uint64_t next = busy ? now + 1 :
+                inbox.empty() ? UINT64_MAX : inbox.begin()->first;
+
+            /* nothing to run yet, the clock moves as far as senders allow,
+             * and no further than any part, which patterns start after */
+            if (next == UINT64_MAX || next > safe) {
+                uint64_t target = std::min({ safe, horizon, next - 1 });
+
+                if (target > now) {
+                    now = target;
+                    shared.part[self].clock = now + 1;
+                } else {
+                    shared.wait();
+                }
+
+                continue;
+            }
+
+            now = next - 1;
+
+            size_t consumed = 0;
+            if (auto it = inbox.find(now + 1); it != inbox.end()) {
+                for (auto &[id, state] : it->second)
+                    code.apply(id, state);
+
+                consumed = it->second.size();
+                inbox.erase(it);
+            }
+
+            evaluations += code.step();
+
+            changes.clear();
+            code.toggled(changes);
+            send(changes, now + 2);
+
+            now++;
+            shared.part[self].clock = now + 1;
+
+            /* counted up before down, so that `active` is not zero while
+             * anything is left */
+            bool idle = code.settled();
+
+            if (!idle && !busy)
+                shared.header->active++;
+            shared.header->active -= consumed;
+            if (idle && busy)
+                shared.header->active--;
+
+            busy = !idle;
+        }
+    }
+
+    void send(span<const pair<WireId, bool>> changes, uint64_t stamp) {
+        uint64_t self_bit = uint64_t { 1 } << self;
+        size_t total = 0;
+
+        for (auto &[id, _] : changes)
+            total += std::popcount(sim.interest[id] & ~self_bit);
+
+        if (total == 0)
+            return;
+
+        shared.header->active += total;
+        shared.part[self].sent += total;
+
+        for (auto &[id, state] : changes) {
+            uint64_t to = sim.interest[id] & ~self_bit;
+
+            for (; to; to &= to - 1) {
+                size_t part = std::countr_zero(to);
+                auto &queue = *shared.queue[queue_of[self * part_count + part]];
+                uint64_t head = queue.head.load(std::memory_order_relaxed);
+
+                /* receivers may be sending to this part as well */
+                while (head - queue.tail.load() == QUEUE_SIZE) {
+                    drain();
+                    shared.wait();
+                }
+
+                queue.ring[head % QUEUE_SIZE] = { stamp, id, state };
+                queue.head = head + 1;
+            }
+        }
+    }
+
+    /* moves messages from queues to the inbox */
+    void drain() {
+        for (auto *queue : senders) {
+            uint64_t head = queue->head.load();
+            uint64_t tail = queue->tail.load(std::memory_order_relaxed);
+
+            for (; tail < head; tail++) {
+                auto &msg = queue->ring[tail % QUEUE_SIZE];
+                inbox[msg.stamp].emplace_back(msg.wire, msg.state);
+            }
+
+            queue->tail = tail;
+        }
+    }
+
+    ParallelSim &sim;
+    Shared &shared;
+    const vector<uint32_t> &queue_of;
+
+    const size_t self;
+    const size_t part_count;
+
+    Bytecode code;
+    vector<Shared::Queue *> senders /**< queues to this part */;
+
+    /* changes from other parts, by generation */
+    map<uint64_t, vector<pair<WireId, bool>>> inbox;
+
+    uint64_t now {} /**< last generation run */;
+    bool busy {} /**< counted in `active` */;
+    uint64_t evaluations {};
+};
+
+
+ParallelSim::ParallelSim(Interpreter &intr_, const Partition &partition_)
+    : intr { intr_ }, partition { partition_ } {
+    size_t wire_count = intr.wires.empty() ? 0 : intr.wires.rbegin()->first + 1;
+
+    interest.resize(wire_count);
+    owner.assign(wire_count, 0);
+    drivers.resize(wire_count);
+
+    vector<bool> owned(wire_count);
+
+    for (auto &[id, unit] : intr.units) {
+        uint64_t bit = uint64_t { 1 } << partition.part_of(id);
+
+        for (WireId wire_id : unit.input_wires)
+            interest[wire_id] |= bit;
+
+        for (WireId wire_id : unit.output_wires) {
+            interest[wire_id] |= bit;
+            drivers[wire_id] |= bit;
+
+            if (!owned[wire_id]) {
+                owned[wire_id] = true;
+                owner[wire_id] = partition.part_of(id);
+            }
+        }
+    }
+}
+
+void ParallelSim::run(span<const Pattern> patterns) {
+    for (auto &pattern : patterns)
+        for (auto &[id, _] : pattern)
+            if (!intr.wires.contains(id))
+                throw std::out_of_range("unknown wire");
+
+    /* a queue from every part driving a wire to every other part reading or
+     * driving it */
+    size_t k = partition.size();
+    vector<uint32_t> queue_of(k * k, UINT32_MAX);
+    size_t queues = 0;
+
+    for (size_t wire = 0; wire < drivers.size(); wire++) {
+        for (uint64_t from = drivers[wire]; from; from &= from - 1) {
+            size_t sender = std::countr_zero(from);
+            uint64_t to = interest[wire] & ~(uint64_t { 1 } << sender);
+
+            for (; to; to &= to - 1) {
+                uint32_t &queue = queue_of[sender * k + std::countr_zero(to)];
+
+                if (queue == UINT32_MAX)
+                    queue = queues++;
+            }
+        }
+    }
+
+    Shared shared { k, queues, interest.size() };
+    Topology topology;
+    vector<pid_t> pids;
+
+    for (size_t part = 0; part < k; part++) {
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            int status = EXIT_SUCCESS;
+
+            /* before the part is compiled, which writes its state first */
+            ScopedPin pin { topology.cpu_for(part, pinning) };
+
+            try {
+                Worker { *this, shared, queue_of, part }.run(patterns);
+            } catch (...) {
+                shared.header->failed = true;
+                status = EXIT_FAILURE;
+            }
+
+            _exit(status);
+        }
+
+        if (pid < 0) {
+            shared.header->failed = true;
+            break;
+        }
+
+        pids.push_back(pid);
+    }
+
+    /* a part that dies stops the others */
+    bool ok = pids.size() == k;
+
+    while (!pids.empty()) {
+        for (size_t i = 0; i < pids.size(); i++) {
+            int status;
+            pid_t res = waitpid(pids[i], &status, WNOHANG);
+
+            if (res == 0)
+                continue;
+
+            if (res < 0 || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != EXIT_SUCCESS) {
+                shared.header->failed = true;
+                ok = false;
+            }
+
+            pids.erase(pids.begin() + i--);
+        }
+
+        if (!pids.empty())
+            usleep(1000);
+    }
+
+    if (!ok)
+        throw std::runtime_error("a part failed");
+
+    for (auto &[id, wire] : intr.wires)
+        wire.state = shared.states[id];
+
+    messages = 0;
+    generations = shared.header->epoch;
+    evaluations = 0;
+    memory_report = {};
+
+    for (size_t part = 0; part < k; part++) {
+        auto &slot = shared.part[part];
+
+        messages += slot.sent;
+        generations = std::max(generations, slot.clock - 1);
+        evaluations += slot.evaluations;
+        memory_report.huge_page_bytes += slot.huge_page_bytes;
+
+        for (size_t node = 0; node < MAX_NODES; node++) {
+            if (slot.node_bytes[node] == 0)
+                continue;
+
+            if (memory_report.node_bytes.size() <= node)
+                memory_report.node_bytes.resize(node + 1);
+
+            memory_report.node_bytes[node] += slot.node_bytes[node];
+        }
+    }
+}
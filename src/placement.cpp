@@ -0,0 +1,279 @@
+#include "../include/placement.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::vector;
+using std::string, std::string_view;
+
+
+static std::atomic<HugePages> huge_page_mode { HugePages::TRANSPARENT };
+
+vector<int> parse_cpu_list(string_view list) {
+    vector<int> res;
+
+    while (!list.empty() && list.back() == '\n')
+        list.remove_suffix(1);
+
+    auto number = [&](int &out) {
+        auto [end, ec] = std::from_chars(list.data(), list.data() + list.size(),
+                                         out);
+
+        if (ec != std::errc {} || out < 0)
+            throw std::invalid_argument("malformed processor list");
+
+        list.remove_prefix(end - list.data());
+    };
+
+    while (!list.empty()) {
+        int first, last;
+        number(first);
+        last = first;
+
+        if (!list.empty() && list.front() == '-') {
+            list.remove_prefix(1);
+            number(last);
+        }
+
+        if (last < first)
+            throw std::invalid_argument("malformed processor list");
+
+        for (int cpu = first; cpu <= last; cpu++)
+            res.push_back(cpu);
+
+        if (!list.empty()) {
+            if (list.front() != ',')
+                throw std::invalid_argument("malformed processor list");
+
+            list.remove_prefix(1);
+        }
+    }
+
+    return res;
+}
+
+/* contents of a file, empty if it cannot be read */
+static string read_file(const string &path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+
+    return ss.str();
+}
+
+Topology::Topology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        CPU_ZERO(&allowed);
+
+    const string sys = "/sys/devices/system/node/";
+    vector<int> node_ids;
+
+    try {
+        node_ids = parse_cpu_list(read_file(sys + "possible"));
+    } catch (std::invalid_argument &) {}
+
+    for (int node : node_ids) {
+        vector<int> cpus;
+
+        try {
+            auto list = read_file(sys + "node" + std::to_string(node) +
+                                  "/cpulist");
+
+            for (int cpu : parse_cpu_list(list))
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                    cpus.push_back(cpu);
+        } catch (std::invalid_argument &) {}
+
+        if (!cpus.empty())
+            nodes.push_back(std::move(cpus));
+    }
+
+    if (nodes.empty()) {
+        vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+
+        nodes.push_back(cpus.empty() ? vector<int> { 0 } : cpus);
+    }
+}
+
+Topology::Topology(vector<vector<int>> nodes_)
+    : nodes { std::move(nodes_) } {
+    std::erase_if(nodes, [](auto &cpus) { return cpus.empty(); });
+
+    if (nodes.empty())
+        throw std::invalid_argument("no processor");
+}
+
+int Topology::cpu_for(size_t worker, Pinning pinning) const {
+    switch (pinning) {
+    case Pinning::NONE:
+        return -1;
+
+    case Pinning::COMPACT: {
+        size_t count = 0;
+        for (auto &cpus : nodes)
+            count += cpus.size();
+
+        worker %= count;
+        for (auto &cpus : nodes) {
+            if (worker < cpus.size())
+                return cpus[worker];
+
+            worker -= cpus.size();
+        }
+
+        return -1;
+    }
+
+    case Pinning::SCATTER: {
+        auto &cpus = nodes[worker % nodes.size()];
+
+        return cpus[worker / nodes.size() % cpus.size()];
+    }
+    }
+
+    return -1;
+}
+
+int Topology::node_of(int cpu) const {
+    for (size_t node = 0; node < nodes.size(); node++)
+        for (int it : nodes[node])
+            if (it == cpu)
+                return node;
+
+    return -1;
+}
+
+
+ScopedPin::ScopedPin(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE ||
+        sched_getaffinity(0, sizeof(before), &before) != 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    saved = sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+ScopedPin::~ScopedPin() {
+    if (saved)
+        sched_setaffinity(0, sizeof(before), &before);
+}
+
+
+MemoryReport MemoryReport::of_self() {
+    MemoryReport report;
+
+    /* a line per mapping, with pages on node n as `Nn=pages` */
+    std::istringstream maps { read_file("/proc/self/numa_maps") };
+    string line;
+
+    while (std::getline(maps, line)) {
+        std::istringstream fields { line };
+        vector<std::pair<size_t, size_t>> pages;
+        size_t page_size = 4096;
+        string field;
+
+        while (fields >> field) {
+            if (field.starts_with("kernelpagesize_kB=")) {
+                page_size = std::stoul(field.substr(18)) << 10;
+            } else if (field.size() > 1 && field[0] == 'N' &&
+                       field.find('=') != string::npos) {
+                size_t eq = field.find('=');
+
+                pages.emplace_back(std::stoul(field.substr(1, eq - 1)),
+                                   std::stoul(field.substr(eq + 1)));
+            }
+        }
+
+        for (auto [node, count] : pages) {
+            if (report.node_bytes.size() <= node)
+                report.node_bytes.resize(node + 1);
+
+            report.node_bytes[node] += count * page_size;
+        }
+    }
+
+    std::istringstream rollup { read_file("/proc/self/smaps_rollup") };
+    while (std::getline(rollup, line))
+        if (line.starts_with("AnonHugePages:"))
+            report.huge_page_bytes = std::stoul(line.substr(14)) << 10;
+
+    return report;
+}
+
+
+void set_huge_pages(HugePages mode) {
+    huge_page_mode = mode;
+}
+
+HugePages huge_pages() {
+    return huge_page_mode;
+}
+
+static size_t round_up(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+void *allocate_pages(size_t bytes, size_t align) {
+    if (bytes < HUGE_PAGE_SIZE)
+        return ::operator new(bytes, std::align_val_t { align });
+
+    size_t size = round_up(bytes);
+    HugePages mode = huge_page_mode;
+
+    if (mode == HugePages::EXPLICIT) {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (ptr != MAP_FAILED)
+            return ptr;
+    }
+
+    /* aligned to a huge page, within a mapping larger by one */
+    void *mapped = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapped == MAP_FAILED)
+        throw std::bad_alloc();
+
+    char *begin = static_cast<char *>(mapped);
+    char *ptr = reinterpret_cast<char *>(
+        round_up(reinterpret_cast<uintptr_t>(begin)));
+
+    if (ptr != begin)
+        munmap(begin, ptr - begin);
+    if (ptr + size != begin + size + HUGE_PAGE_SIZE)
+        munmap(ptr + size, begin + HUGE_PAGE_SIZE - ptr);
+
+    if (mode != HugePages::NONE)
+        madvise(ptr, size, MADV_HUGEPAGE);
+
+    return ptr;
+}
+
+void free_pages(void *ptr, size_t bytes, size_t align) {
+    if (bytes < HUGE_PAGE_SIZE)
+        ::operator delete(ptr, std::align_val_t { align });
+    else
+        munmap(ptr, round_up(bytes));
+}
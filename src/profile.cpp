@@ -0,0 +1,72 @@
+#include "../include/profile.hpp"
+#include "../include/lex.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+using std::ostream;
+using std::vector, std::pair;
+
+
+/* identifiers with the highest non-zero counts, highest first */
+static vector<pair<uint64_t, size_t>> hottest(const vector<uint64_t> &counts,
+                                              size_t top) {
+    vector<pair<uint64_t, size_t>> res;
+
+    for (size_t id = 0; id < counts.size(); id++)
+        if (counts[id])
+            res.emplace_back(counts[id], id);
+
+    auto mid = res.begin() + std::min(top, res.size());
+    std::partial_sort(res.begin(), mid, res.end(),
+                      [](auto &a, auto &b) { return a.first > b.first; });
+    res.erase(mid, res.end());
+
+    return res;
+}
+
+ostream &Profile::report(ostream &os, const Lex &lex, size_t top) const {
+    static const char *phase_names[] = {
+        "lex", "parse", "interpret", "simulate", "draw"
+    };
+
+    auto flags = os.flags();
+    os << std::fixed << std::setprecision(6);
+
+    os << "phase          seconds\n";
+    for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++)
+        os << std::left << std::setw(15) << phase_names[i] << std::right <<
+            std::chrono::duration<double>(phase_time[i]).count() << "\n";
+
+    os << std::setprecision(2) << "\n" <<
+        "stabilizations " << stabilizations << "\n" <<
+        "generations    " << generations << " (" <<
+            (stabilizations ? double(generations) / stabilizations : 0) <<
+            " per stabilization, at most " << max_generations << ")\n" <<
+        "evaluations    " << evaluations << " (" << redundant_evaluations <<
+            " redundant, " <<
+            (evaluations ? 100.0 * redundant_evaluations / evaluations : 0) <<
+            "%)\n" <<
+        "toggles        " << toggles << "\n";
+
+    auto list = [&](const char *title, const vector<uint64_t> &counts) {
+        os << "\n" << title << "\n";
+
+        for (auto &[count, id] : hottest(counts, top))
+            os << std::setw(12) << count << "  " << lex.ident_name(id) << "\n";
+    };
+
+    list("hottest luts, by evaluations", lut_evaluations);
+    list("hottest units, by evaluations", unit_evaluations);
+    list("hottest wires, by toggles", wire_toggles);
+
+    os.flags(flags);
+
+    return os;
+}
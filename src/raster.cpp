@@ -0,0 +1,258 @@
+#include "../include/raster.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+
+/* four pixels, stored with one vector instruction */
+typedef uint32_t Pixels __attribute__((vector_size(16)));
+
+static void fill_span(uint32_t *at, size_t count, uint32_t color) {
+    Pixels wide = { color, color, color, color };
+
+    for (; count >= 4; count -= 4, at += 4)
+        std::memcpy(at, &wide, sizeof(wide));
+
+    for (; count; count--)
+        *at++ = color;
+}
+
+/* x where min <= a * x + b <= max, as b is linear in y */
+struct Bound {
+    Bound(float a, float b0, float by, float min_, float max_)
+        : inv { a ? 1 / a : 0 }, b0 { b0 }, by { by },
+          min { min_ }, max { max_ } {}
+
+    /* narrows [lo, hi] on the row through y */
+    void clip(float y, float &lo, float &hi) const {
+        float b = b0 + by * y;
+
+        if (!inv) {
+            if (b < min || b > max)
+                lo = INFINITY, hi = -INFINITY;
+
+            return;
+        }
+
+        float from = (min - b) * inv, to = (max - b) * inv;
+        if (inv < 0)
+            std::swap(from, to);
+
+        lo = std::max(lo, from);
+        hi = std::min(hi, to);
+    }
+
+    float inv, b0, by, min, max;
+};
+
+/* x a capsule covers on every row; the capsule is convex, so covering its
+ * end disks and body covers it */
+class Rows {
+public:
+    Rows(const Capsule &c_)
+        : c { c_ }, dx { c.x1 - c.x0 }, dy { c.y1 - c.y0 },
+          length2 { dx * dx + dy * dy },
+          /* along the segment within it, across it within the radius */
+          along { dx, -c.y0 * dy - c.x0 * dx, dy, 0, length2 },
+          across { dy, c.y0 * dx - c.x0 * dy, -dx,
+                   -c.radius * std::sqrt(length2),
+                   c.radius * std::sqrt(length2) } {}
+
+    /* interval of the row through y, which is empty if lo > hi */
+    void at(float y, float &lo, float &hi) const {
+        lo = INFINITY, hi = -INFINITY;
+
+        if (length2 != 0) {
+            float body_lo = -INFINITY, body_hi = INFINITY;
+
+            along.clip(y, body_lo, body_hi);
+            across.clip(y, body_lo, body_hi);
+
+            lo = body_lo, hi = body_hi;
+        }
+
+        disk(c.x0, c.y0, y, lo, hi);
+        disk(c.x1, c.y1, y, lo, hi);
+    }
+
+private:
+    void disk(float x, float at, float y, float &lo, float &hi) const {
+        float d = c.radius * c.radius - (y - at) * (y - at);
+
+        if (d < 0)
+            return;
+
+        float w = std::sqrt(d);
+
+        if (lo > hi) {
+            lo = x - w, hi = x + w;
+        } else {
+            lo = std::min(lo, x - w);
+            hi = std::max(hi, x + w);
+        }
+    }
+
+    const Capsule &c;
+    float dx, dy, length2;
+    Bound along, across;
+};
+
+/* x extent of a capsule between rows top and bottom */
+static bool band_extent(const Capsule &c, float top, float bottom,
+                        float &left, float &right) {
+    top -= c.radius;
+    bottom += c.radius;
+
+    float from = 0, to = 1;
+    float dy = c.y1 - c.y0;
+
+    if (dy == 0) {
+        if (c.y0 < top || c.y0 > bottom)
+            return false;
+    } else {
+        from = (top - c.y0) / dy;
+        to = (bottom - c.y0) / dy;
+
+        if (dy < 0)
+            std::swap(from, to);
+
+        from = std::max(from, 0.f);
+        to = std::min(to, 1.f);
+
+        if (from > to)
+            return false;
+    }
+
+    float x_from = c.x0 + (c.x1 - c.x0) * from;
+    float x_to = c.x0 + (c.x1 - c.x0) * to;
+
+    left = std::min(x_from, x_to) - c.radius;
+    right = std::max(x_from, x_to) + c.radius;
+
+    return true;
+}
+
+
+Raster::Raster(size_t threads_)
+    : threads { threads_ ? threads_ :
+                std::max(1u, std::thread::hardware_concurrency()) } {}
+
+void Raster::begin(uint32_t *pixels_, int width_, int height_, size_t stride_,
+                   uint32_t background_) {
+    pixels = pixels_;
+    width = std::max(width_, 0);
+    height = std::max(height_, 0);
+    stride = stride_;
+    background = background_;
+
+    capsules.clear();
+}
+
+void Raster::capsule(float x0, float y0, float x1, float y1, float radius,
+                     uint32_t color) {
+    capsules.push_back(Capsule { x0, y0, x1, y1, radius, color });
+}
+
+void Raster::end() {
+    tiles_x = (width + TILE - 1) / TILE;
+    tiles_y = (height + TILE - 1) / TILE;
+
+    size_t tile_count = tiles_x * tiles_y;
+
+    if (tile_count == 0)
+        return;
+
+    /* tiles every capsule may cover, visited twice: to count, then to fill */
+    auto each_tile = [&](auto &&visit) {
+        for (uint32_t i = 0; i < capsules.size(); i++) {
+            const Capsule &c = capsules[i];
+
+            float top = std::min(c.y0, c.y1) - c.radius;
+            float bottom = std::max(c.y0, c.y1) + c.radius;
+
+            if (bottom < 0 || top >= height)
+                continue;
+
+            size_t first_y = std::max(top, 0.f) / TILE;
+            size_t last_y = std::min<float>(bottom / TILE, tiles_y - 1);
+
+            for (size_t ty = first_y; ty <= last_y; ty++) {
+                float left, right;
+
+                if (!band_extent(c, ty * TILE, (ty + 1) * TILE,
+                                 left, right) ||
+                    right < 0 || left >= width)
+                    continue;
+
+                size_t first_x = std::max(left, 0.f) / TILE;
+                size_t last_x = std::min<float>(right / TILE, tiles_x - 1);
+
+                for (size_t tx = first_x; tx <= last_x; tx++)
+                    visit(ty * tiles_x + tx, i);
+            }
+        }
+    };
+
+    bin_first.assign(tile_count + 1, 0);
+    each_tile([&](size_t tile, uint32_t) { bin_first[tile + 1]++; });
+
+    for (size_t tile = 0; tile < tile_count; tile++)
+        bin_first[tile + 1] += bin_first[tile];
+
+    bins.resize(bin_first[tile_count]);
+
+    vector<uint32_t> fill(bin_first.begin(), bin_first.end() - 1);
+    each_tile([&](size_t tile, uint32_t i) { bins[fill[tile]++] = i; });
+
+    std::atomic<size_t> next { 0 };
+    auto work = [&]() {
+        for (size_t tile; (tile = next++) < tile_count;)
+            draw_tile(tile);
+    };
+
+    vector<std::jthread> workers;
+    for (size_t i = 1; i < std::min(threads, tile_count); i++)
+        workers.emplace_back(work);
+
+    work();
+}
+
+void Raster::draw_tile(size_t tile) const {
+    int left = tile % tiles_x * TILE, top = tile / tiles_x * TILE;
+    int right = std::min(left + TILE, width);
+    int bottom = std::min(top + TILE, height);
+
+    for (int y = top; y < bottom; y++)
+        fill_span(pixels + y * stride + left, right - left, background);
+
+    for (uint32_t b = bin_first[tile]; b < bin_first[tile + 1]; b++) {
+        const Capsule &c = capsules[bins[b]];
+        Rows rows { c };
+
+        /* rows whose centers are within reach of the capsule */
+        int from = std::max<float>(top, std::ceil(std::min(c.y0, c.y1) -
+                                                  c.radius - 0.5f));
+        int to = std::min<float>(bottom - 1, std::floor(std::max(c.y0, c.y1) +
+                                                        c.radius - 0.5f));
+
+        for (int y = from; y <= to; y++) {
+            float lo, hi;
+            rows.at(y + 0.5f, lo, hi);
+
+            int first = std::max<float>(left, std::ceil(lo - 0.5f));
+            int last = std::min<float>(right - 1, std::floor(hi - 0.5f));
+
+            if (first <= last)
+                fill_span(pixels + y * stride + first, last - first + 1,
+                          c.color);
+        }
+    }
+}
@@ -0,0 +1,403 @@
+#include "../include/reload.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/grammar.hpp"
+#include "../include/lex.hpp"
+
+#include <rdesc/rdesc.h>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::vector, std::set;
+using std::string, std::string_view;
+using std::stringstream;
+using std::cerr;
+
+
+void Interpreter::patch(const vector<Stmt> &removed, const vector<Stmt> &added,
+                        Lex &lex, vector<WireId> &dirty) {
+    revision++;
+
+    vector<decltype(luts)::node_type> old_luts;
+    vector<decltype(wires)::node_type> old_wires;
+    vector<decltype(units)::node_type> old_units;
+
+    set<UnitId> removed_units;
+
+    /* detach units first, their input wires may be replaced as well */
+    for (auto &stmt : removed) {
+        if (stmt.kind != NT_UNIT || !units.contains(stmt.id))
+            continue;
+
+        auto node = units.extract(stmt.id);
+
+        for (auto input_wire : node.mapped().input_wires)
+            if (wires.contains(input_wire))
+                wires.at(input_wire).affects.erase(stmt.id);
+
+        removed_units.insert(stmt.id);
+        old_units.push_back(std::move(node));
+    }
+
+    for (auto &stmt : removed) {
+        if (stmt.kind == NT_LUT && luts.contains(stmt.id))
+            old_luts.push_back(luts.extract(stmt.id));
+        else if (stmt.kind == NT_WIRE && wires.contains(stmt.id))
+            old_wires.push_back(wires.extract(stmt.id));
+    }
+
+    vector<const Stmt *> inserted;
+
+    auto rollback = [&]() {
+        for (auto it = inserted.rbegin(); it != inserted.rend(); ++it) {
+            const Stmt &stmt = **it;
+
+            switch (stmt.kind) {
+            case NT_LUT:
+                luts.erase(stmt.id);
+                break;
+            case NT_WIRE:
+                wires.erase(stmt.id);
+                break;
+            case NT_UNIT:
+                for (auto input_wire : units.at(stmt.id).input_wires)
+                    if (wires.contains(input_wire))
+                        wires.at(input_wire).affects.erase(stmt.id);
+
+                units.erase(stmt.id);
+                break;
+            default: break;  // GCOVR_EXCL_LINE
+            }
+        }
+
+        for (auto &node : old_luts)
+            luts.insert(std::move(node));
+        for (auto &node : old_wires)
+            wires.insert(std::move(node));
+
+        for (auto &node : old_units) {
+            auto res = units.insert(std::move(node));
+
+            for (auto input_wire : res.position->second.input_wires)
+                wires.at(input_wire).affects.insert(res.position->first);
+        }
+    };
+
+    try {
+        for (auto &stmt : added) {
+            bool exists = (stmt.kind == NT_LUT && luts.contains(stmt.id)) ||
+                (stmt.kind == NT_WIRE && wires.contains(stmt.id)) ||
+                (stmt.kind == NT_UNIT && units.contains(stmt.id));
+
+            stringstream ss { stmt.text };
+            Lex stmt_lex { ss, lex };
+
+            enum rdesc_result res;
+            do {
+                auto tk = stmt_lex.next();
+
+                if (tk.id == TK_NOTOKEN || tk.id == TK_EOF) {
+                    rdesc.reset(tk_destroyer);
+                    rdesc.start(START_SYM);
+                    throw std::invalid_argument("incomplete statement");
+                }
+
+                res = pump(tk);
+            } while (res == RDESC_CONTINUE);
+
+            if (res == RDESC_NOMATCH)
+                throw std::invalid_argument("syntax error");
+
+            /* redefinitions are ignored, as in loading */
+            if (!exists)
+                inserted.push_back(&stmt);
+        }
+
+        /* replaced wires keep fan-out of units that have not changed */
+        for (auto &node : old_wires) {
+            WireId id = node.key();
+
+            if (!wires.contains(id))
+                continue;
+
+            for (UnitId unit_id : node.mapped().affects)
+                if (units.contains(unit_id) && !removed_units.contains(unit_id))
+                    wires.at(id).affects.insert(unit_id);
+        }
+
+        /* units that have not changed may refer to replaced objects */
+        if (old_luts.size() || old_wires.size()) {
+            for (auto &it : units) {
+                const Unit &unit = it.second;
+
+                if (!luts.contains(unit.lut_id))
+                    throw std::invalid_argument("unknown lut");
+
+                auto validate_wires = [this](const auto &wire_ids) {
+                    for (auto &id : wire_ids)
+                        if (!wires.contains(id))
+                            throw std::invalid_argument("unknown wire");
+                };
+
+                validate_wires(unit.input_wires);
+                validate_wires(unit.output_wires);
+
+                auto &lut = luts.at(unit.lut_id);
+
+                if (lut.input_size != unit.input_wires.size())
+                    throw std::length_error("invalid input wire size");
+                if (lut.output_size != unit.output_wires.size())
+                    throw std::length_error("invalid output wire size");
+            }
+        }
+    } catch (...) {
+        rollback();
+        throw;
+    }
+
+    /* re-evaluate units whose inputs, lut or themselves are replaced, and
+     * units driving replaced wires, which are reset to their declared state */
+    if (old_wires.size()) {
+        set<WireId> replaced_wires;
+        for (auto &node : old_wires)
+            if (wires.contains(node.key())) {
+                replaced_wires.insert(node.key());
+                dirty.push_back(node.key());
+            }
+
+        for (auto &it : units)
+            for (WireId output : it.second.output_wires)
+                if (replaced_wires.contains(output) &&
+                    it.second.input_wires.size()) {
+                    dirty.push_back(it.second.input_wires[0]);
+                    break;
+                }
+    }
+
+    for (auto *stmt : inserted) {
+        if (stmt->kind == NT_WIRE) {
+            dirty.push_back(stmt->id);
+        } else if (stmt->kind == NT_UNIT) {
+            auto &unit = units.at(stmt->id);
+
+            if (unit.input_wires.size())
+                dirty.push_back(unit.input_wires[0]);
+        }
+    }
+
+    if (old_luts.size()) {
+        set<LutId> replaced_luts;
+        for (auto &node : old_luts)
+            replaced_luts.insert(node.key());
+
+        for (auto &it : units)
+            if (replaced_luts.contains(it.second.lut_id) &&
+                it.second.input_wires.size())
+                dirty.push_back(it.second.input_wires[0]);
+    }
+}
+
+
+HotReload::HotReload(string path_, std::shared_ptr<Interpreter> intr_,
+                     std::shared_ptr<Lex> lex_)
+    : path { std::move(path_) }, intr { intr_ }, lex { lex_ } {
+    size_t slash = path.rfind('/');
+    string dir = slash == string::npos ? "." : path.substr(0, slash + 1);
+    name = slash == string::npos ? path : path.substr(slash + 1);
+
+    read_stmts(stmts);
+
+    /* editors often replace the file instead of writing it, so its directory
+     * is watched */
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (inotify_fd != -1 &&
+        inotify_add_watch(inotify_fd, dir.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+
+    if (inotify_fd == -1)
+        cerr << "Warning: Could not watch " << path << " for changes.\n";
+}
+
+HotReload::~HotReload() {
+    if (inotify_fd != -1)
+        close(inotify_fd);
+}
+
+bool HotReload::changed() {
+    alignas(struct inotify_event) char buf[4096];
+    bool res = false;
+
+    if (inotify_fd == -1)
+        return false;
+
+    while (true) {
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+
+        if (len <= 0)
+            break;
+
+        for (char *ptr = buf; ptr < buf + len; ) {
+            auto *ev = reinterpret_cast<struct inotify_event *>(ptr);
+
+            if (ev->len && name == ev->name)
+                res = true;
+
+            ptr += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+    return res;
+}
+
+bool HotReload::read_stmts(vector<Stmt> &out) const {
+    std::ifstream file(path, std::ios_base::in);
+
+    if (!file)
+        return false;
+
+    string source { std::istreambuf_iterator<char>(file), {} };
+
+    stringstream ss { source };
+    Lex stmt_lex { ss, *lex };
+
+    Stmt stmt { NT_STMT, 0, "" };
+    size_t begin = 0;
+    size_t ident_count = 0;
+    int depth = 0;
+
+    auto trim = [](string_view text) {
+        const char *space = " \t\n\r\f\v";
+
+        text.remove_prefix(std::min(text.find_first_not_of(space),
+                                    text.size()));
+        text.remove_suffix(text.size() - text.find_last_not_of(space) - 1);
+
+        return string { text };
+    };
+
+    while (true) {
+        auto tk = stmt_lex.next();
+
+        if (tk.id == TK_NOTOKEN)
+            return false;
+        if (tk.id == TK_EOF)
+            break;
+
+        switch (tk.id) {
+        case TK_LUT:
+        case TK_REG:
+            stmt.kind = NT_LUT;
+            break;
+        case TK_WIRE:
+            stmt.kind = NT_WIRE;
+            break;
+        case TK_UNIT:
+            stmt.kind = NT_UNIT;
+            break;
+        case TK_IDENT:
+            ident_count++;
+
+            /* name of the unit comes after its lut */
+            if (ident_count == (stmt.kind == NT_UNIT ? 2 : 1))
+                stmt.id = static_cast<IdentInfo *>(tk.seminfo)->id;
+            break;
+        case TK_LBRACKET:
+        case TK_LCURLY:
+            depth++;
+            break;
+        case TK_RBRACKET:
+        case TK_RCURLY:
+            depth--;
+            break;
+        case TK_SEMI:
+            if (depth != 0)
+                break;
+
+            stmt.text = trim(string_view { source }.substr(
+                begin, stmt_lex.offset() - begin
+            ));
+
+            /* empty statements define nothing */
+            if (stmt.kind != NT_STMT)
+                out.push_back(std::move(stmt));
+
+            stmt = Stmt { NT_STMT, 0, "" };
+            begin = stmt_lex.offset();
+            ident_count = 0;
+            break;
+        default:
+            break;
+        }
+
+        tk_destroyer(&tk);
+    }
+
+    return true;
+}
+
+bool HotReload::reload(Simulation &sim) {
+    vector<Stmt> next;
+
+    if (!read_stmts(next)) {
+        cerr << "Reload failed: syntax error, keeping current simulation.\n";
+        return false;
+    }
+
+    std::unordered_multimap<string_view, size_t> current;
+    for (size_t i = 0; i < stmts.size(); i++)
+        current.emplace(stmts[i].text, i);
+
+    vector<bool> kept(stmts.size());
+    vector<Stmt> removed, added;
+
+    for (auto &stmt : next) {
+        auto it = current.find(stmt.text);
+
+        if (it != current.end()) {
+            kept[it->second] = true;
+            current.erase(it);
+        } else {
+            added.push_back(stmt);
+        }
+    }
+
+    for (size_t i = 0; i < stmts.size(); i++)
+        if (!kept[i])
+            removed.push_back(stmts[i]);
+
+    if (removed.size() || added.size()) {
+        vector<WireId> dirty;
+
+        try {
+            intr->patch(removed, added, *lex, dirty);
+        } catch (std::exception &e) {
+            cerr << "Reload failed: " << e.what()
+                << ", keeping current simulation.\n";
+            return false;
+        }
+
+        for (WireId id : dirty)
+            sim.schedule(id);
+    }
+
+    stmts = std::move(next);
+
+    return true;
+}
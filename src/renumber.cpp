@@ -0,0 +1,93 @@
+#include "../include/renumber.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+using std::vector, std::map;
+
+
+Renumbering::Renumbering(const map<WireId, Wire> &wires,
+                         const map<UnitId, Unit> &units,
+                         bool by_connectivity) {
+    wire_index.assign(wires.empty() ? 0 : wires.rbegin()->first + 1, NONE);
+    unit_index.assign(units.empty() ? 0 : units.rbegin()->first + 1, NONE);
+    wire_ids.reserve(wires.size());
+    unit_ids.reserve(units.size());
+
+    auto number_wire = [&](WireId id) {
+        if (wire_index[id] == NONE) {
+            wire_index[id] = wire_ids.size();
+            wire_ids.push_back(id);
+        }
+    };
+
+    /* false if already numbered */
+    auto number_unit = [&](const Unit &unit) {
+        if (unit_index[unit.id] != NONE)
+            return false;
+
+        unit_index[unit.id] = unit_ids.size();
+        unit_ids.push_back(unit.id);
+
+        for (WireId wire_id : unit.output_wires)
+            number_wire(wire_id);
+
+        return true;
+    };
+
+    if (!by_connectivity) {
+        for (auto &[id, _] : wires)
+            number_wire(id);
+        for (auto &[_, unit] : units)
+            number_unit(unit);
+
+        return;
+    }
+
+    /* readers of every wire in identifier order, as in `Wire::affects`, in
+     * flat arrays instead of sets; a unit reading a wire twice is listed
+     * twice */
+    vector<uint32_t> reader_first(wire_index.size() + 1);
+    vector<bool> driven(wire_index.size());
+
+    for (auto &[_, unit] : units) {
+        for (WireId wire_id : unit.input_wires)
+            reader_first[wire_id + 1]++;
+        for (WireId wire_id : unit.output_wires)
+            driven[wire_id] = true;
+    }
+
+    for (size_t i = 0; i + 1 < reader_first.size(); i++)
+        reader_first[i + 1] += reader_first[i];
+
+    vector<const Unit *> readers(reader_first.back());
+    vector<uint32_t> fill { reader_first.begin(), reader_first.end() - 1 };
+
+    for (auto &[_, unit] : units)
+        for (WireId wire_id : unit.input_wires)
+            readers[fill[wire_id]++] = &unit;
+
+    /* numbered wires are the queue of the search, so that units reading a
+     * wire are numbered together, and so are outputs of a unit */
+    size_t head = 0;
+    auto search = [&]() {
+        for (; head < wire_ids.size(); head++) {
+            WireId id = wire_ids[head];
+
+            for (uint32_t r = reader_first[id]; r < reader_first[id + 1]; r++)
+                number_unit(*readers[r]);
+        }
+    };
+
+    for (auto &[id, _] : wires)
+        if (!driven[id])
+            number_wire(id);
+
+    search();
+
+    for (auto &[_, unit] : units)
+        if (number_unit(unit))
+            search();
+}
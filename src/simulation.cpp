@@ -1,26 +1,63 @@
 #include "../include/interpreter.hpp"
+#include "../include/bytecode.hpp"
 #include "../include/core.hpp"
 
-#include <set>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
 #include <vector>
 
-using std::set, std::vector;
+using std::vector, std::span;
+using std::pair;
 
 
+/* truth tables of outputs one after another, packed */
+static vector<uint64_t> pack(const vector<bool> &lut, size_t input_size,
+                             size_t output_size) {
+    size_t count = size_t { 1 } << input_size;
+    size_t word_count = (count + 63) / 64;
+    vector<uint64_t> words(word_count * output_size);
+
+    for (size_t o = 0; o < output_size; o++)
+        for (size_t i = 0; i < count; i++)
+            words[o * word_count + i / 64] |=
+                uint64_t { lut[o * count + i] } << (i % 64);
+
+    return words;
+}
+
+Lut::Lut(Table table_, LutId id_, size_t input_size_, size_t output_size_,
+         vector<uint64_t> &&words_, bool clocked_)
+    : table { std::move(table_) },
+      id { id_ }, input_size { input_size_ }, output_size { output_size_ },
+      clocked { clocked_ }, words { std::move(words_) } {
+    if (input_size < BDD_INPUTS)
+        return;
+
+    Bdd compressed { words, word_count(), output_size };
+
+    if (compressed.bytes() <= words.size() * sizeof(uint64_t) / 4) {
+        bdd = std::move(compressed);
+        words = {};
+    }
+}
+
+Lut::Lut(Table table_, LutId id_, size_t input_size_, size_t output_size_,
+         const vector<bool> &lut, bool clocked_)
+    : Lut(std::move(table_), id_, input_size_, output_size_,
+          pack(lut, input_size_, output_size_), clocked_) {}
+
 vector<bool> Lut::lookup(const vector<bool> &inputs) const {
     vector<bool> res;
     res.reserve(output_size);
 
-    size_t output_index = 0;
+    size_t input_index = 0;
     for (size_t i = 0; i < inputs.size(); i++)
-        output_index += (inputs[i]) << i;
+        input_index += (inputs[i]) << i;
 
-    size_t i = 0;
-    for (size_t offset = 0;
-         offset < lut.size();
-         offset += input_variant_count()) {
-        res[i++] = lut[offset + output_index];
-    }
+    for (size_t i = 0; i < output_size; i++)
+        res.push_back(lookup(input_index, i));
 
     return res;
 };  // GCOVR_EXCL_LINE
@@ -29,38 +66,140 @@ void Simulation::set_wire_state(WireId id, bool state) {
     bool &current_state = wires.at(id).state;
 
     if (current_state != state) {
+        if (record) {
+            fit(recorded, id);
+
+            if (!recorded[id]) {
+                recorded[id] = true;
+                record->emplace_back(id, current_state);
+            }
+        }
+
         current_state = state;
-        changed_wires.insert(id);
+        schedule(id);
+
+        if (bytecode && bytecode->revision == revision)
+            bytecode->set(id, state);
+
+        if (profile)
+            profile->count_toggle(id);
+        if (activity)
+            activity->toggle(id, state, time);
+    }
+}
+
+void Simulation::schedule(WireId id) {
+    fit(pending, id);
+
+    if (!pending[id]) {
+        pending[id] = true;
+        changed_wires.push_back(id);
     }
 }
 
 void Simulation::advance() {
-    set<WireId> affected_wires;
+    time++;
 
-    set<WireId> changed_wires_ = std::move(changed_wires);
+    vector<WireId> changed_wires_ = std::move(changed_wires);
     changed_wires.clear();
 
+    /* union of fan-outs, so that each unit is evaluated once */
     for (WireId wire_id : changed_wires_) {
+        pending[wire_id] = false;
+
         for (UnitId unit_id : wires.at(wire_id).affects) {
-            const Unit &unit = units.at(unit_id);
-            const Lut &lut = luts.at(unit.lut_id);
+            fit(scheduled, unit_id);
+
+            if (!scheduled[unit_id]) {
+                scheduled[unit_id] = true;
+                scheduled_units.push_back(unit_id);
+            }
+        }
+    }
 
-            vector<bool> inputs;
-            inputs.reserve(lut.input_size);
+    vector<UnitId> units_ = std::move(scheduled_units);
+    scheduled_units.clear();
 
-            for (WireId input_wire_id : unit.input_wires)
-                inputs.push_back(wires.at(input_wire_id).state);
+    for (UnitId unit_id : units_) {
+        scheduled[unit_id] = false;
 
-            vector<bool> outputs = lut.lookup(inputs);
+        const Unit &unit = units.at(unit_id);
+        const Lut &lut = luts.at(unit.lut_id);
 
-            size_t i = 0;
-            for (WireId output_wire_id : unit.output_wires)
-                set_wire_state(output_wire_id, outputs[i++]);
-        }
+        /* registers change only on clock edges */
+        if (lut.clocked)
+            continue;
+
+        evaluations++;
+
+        size_t input_index = 0;
+        for (size_t i = 0; i < unit.input_wires.size(); i++)
+            input_index |= size_t { wires.at(unit.input_wires[i]).state } << i;
+
+        uint64_t toggles = profile ? profile->toggles : 0;
+
+        for (size_t i = 0; i < unit.output_wires.size(); i++)
+            set_wire_state(unit.output_wires[i], lut.lookup(input_index, i));
+
+        if (profile)
+            profile->count_evaluation(unit, profile->toggles == toggles);
     }
 }
 
 void Simulation::stabilize() {
-    while (changed_wires.size())
-        advance();
+    if (changed_wires.empty()) {
+        if (profile)
+            profile->count_stabilize(0);
+
+        return;
+    }
+
+    Bytecode &code = compile();
+
+    for (WireId id : changed_wires)
+        pending[id] = false;
+
+    if (record)
+        fit(recorded, wires.rbegin()->first);
+
+    auto run = code.stabilize(changed_wires, record, recorded,
+                              { profile, activity, time });
+    changed_wires.clear();
+
+    time += run.generations;
+    evaluations += run.evaluations;
+
+    if (profile)
+        profile->count_stabilize(run.generations);
+}
+
+vector<WireId> Simulation::apply(span<const Stimulus> stimuli) {
+    vector<pair<WireId, bool>> original;
+    record = &original;
+
+    auto stop_recording = [&]() {
+        record = nullptr;
+
+        for (auto &it : original)
+            recorded[it.first] = false;
+    };
+
+    try {
+        for (auto &stimulus : stimuli)
+            set_wire_state(stimulus.first, stimulus.second);
+
+        stabilize();
+    } catch (...) {
+        stop_recording();
+        throw;
+    }
+
+    stop_recording();
+
+    vector<WireId> res;
+    for (auto &[id, state] : original)
+        if (wires.at(id).state != state)
+            res.push_back(id);
+
+    return res;
 }
@@ -0,0 +1,124 @@
+#include "../include/table.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+using std::span;
+using std::vector, std::pair;
+
+
+uint64_t TableValue::as_num() const {
+    if (kind != NUM)
+        throw std::bad_cast();
+
+    return num;
+}
+
+const TablePoint &TableValue::as_point() const {
+    if (kind != POINT)
+        throw std::bad_cast();
+
+    return point;
+}
+
+TableSubpath TableValue::as_path() const {
+    if (kind != PATH)
+        throw std::bad_cast();
+
+    return path;
+}
+
+span<const TablePoint> PathView::operator[](size_t i) const {
+    const TableSubpath &subpath = store.subpaths[range.first + i];
+
+    return span { store.points.data() + subpath.first, subpath.count };
+}
+
+const TableValue *Table::find(TableKeyId k) const {
+    if (count == 0)
+        return nullptr;
+
+    auto begin = store->keys.begin() + first;
+    auto end = begin + count;
+    auto it = std::lower_bound(begin, end, k);
+
+    if (it == end || *it != k)
+        return nullptr;
+
+    return &store->values[it - store->keys.begin()];
+}
+
+const TableValue &Table::get(TableKeyId k) const {
+    auto value = find(k);
+
+    if (value == nullptr)
+        throw std::out_of_range("no such key in table");
+
+    return *value;
+}
+
+PathView Table::path(TableKeyId k) const {
+    return store->path(get(k));
+}
+
+TableKeyId Table::key(size_t i) const {
+    return store->keys[first + i];
+}
+
+const TableValue &Table::value(size_t i) const {
+    return store->values[first + i];
+}
+
+void Metadata::begin_path() {
+    path_first = subpaths.size();
+    subpath_first = points.size();
+}
+
+void Metadata::close_subpath() {
+    subpaths.push_back(TableSubpath(
+        subpath_first, points.size() - subpath_first
+    ));
+
+    subpath_first = points.size();
+}
+
+void Metadata::break_path() {
+    close_subpath();
+}
+
+TableValue Metadata::end_path() {
+    close_subpath();
+
+    TableValue value;
+    value.kind = TableValue::PATH;
+    value.path = TableSubpath(path_first, subpaths.size() - path_first);
+
+    return value;
+}
+
+Table Metadata::commit(vector<pair<TableKeyId, TableValue>> &entries) {
+    if (entries.size() == 0)
+        return Table {};
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.first < b.first;
+                     });
+
+    uint32_t first = keys.size();
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0 && entries[i].first == entries[i - 1].first)
+            continue;
+
+        keys.push_back(entries[i].first);
+        values.push_back(entries[i].second);
+    }
+
+    return Table { this, first, static_cast<uint32_t>(keys.size() - first) };
+}
@@ -0,0 +1,48 @@
+// helpers shared by tests of acme
+
+#ifndef TESTING_HPP
+#define TESTING_HPP
+
+
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/parser.hpp"
+#include "detail.h"
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/* loads every statement lexed by `lex`, which must all be valid */
+inline void load(Interpreter &intr, Lex &lex) {
+    Parser parser { intr, lex };
+
+    Parsed res;
+    while ((res = parser.next()) != Parsed::END)
+        assert(res == Parsed::READY, "syntax error");
+}
+
+inline void load(Interpreter &intr, const std::string &source) {
+    std::stringstream ss { source };
+    Lex lex { ss };
+
+    load(intr, lex);
+}
+
+/* wires no unit drives, in order of their ids */
+inline std::vector<WireId> undriven(const Interpreter &intr) {
+    std::set<WireId> driven;
+    for (auto &[_, unit] : intr.get_units())
+        driven.insert(unit.output_wires.begin(), unit.output_wires.end());
+
+    std::vector<WireId> res;
+    for (auto &[id, _] : intr.get_wires())
+        if (!driven.contains(id))
+            res.push_back(id);
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "../include/activity.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <rdesc/rdesc.h>
+
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::stringstream;
+
+
+int main() {
+    stringstream ss;
+    ss << "lut<1, 1> not1 = (0b01);"
+        "wire a = 0; wire b = 1; wire c = 0;"
+        "unit<not1> inv = (a) -> (b);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex.next()).id != TK_EOF)
+        assert(intr.pump(tk) != RDESC_NOMATCH,
+               "syntax error");
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    Simulation sim { intr };
+    Activity activity;
+
+    sim.set_activity(&activity);
+
+    /* a rises at 0, b falls in generation 1; a falls at 2, b rises at 3 */
+    sim.apply({ { id("a"), 1 } });
+    sim.apply({ { id("a"), 0 } });
+
+    sim.set_activity(nullptr);
+    sim.apply({ { id("a"), 1 } });
+
+    assert(activity.start == 0 && activity.stop == 4,
+           "unexpected duration: %lu", activity.stop - activity.start);
+
+    auto t1 = activity.time_at_1(activity.stop);
+
+    assert(activity.toggles[id("a")] == 2 && t1[id("a")] == 2,
+           "unexpected activity of a");
+    assert(activity.toggles[id("b")] == 2 && t1[id("b")] == 2,
+           "unexpected activity of b");
+    assert(activity.toggles[id("c")] == 0 && t1[id("c")] == 0,
+           "unexpected activity of c");
+
+    stringstream saif;
+    activity.dump_saif(saif, lex);
+
+    string res = saif.str();
+    assert(res.find("(DURATION 4)") != string::npos &&
+           res.find("      (b\n        (T0 2) (T1 2) (TX 0)\n"
+                    "        (TC 2) (IG 0)\n") != string::npos &&
+           res.find("      (c\n        (T0 4) (T1 0)") != string::npos,
+           "unexpected SAIF:\n%s", res.c_str());
+}
@@ -0,0 +1,108 @@
+#include "../include/bdd.hpp"
+#include "../include/core.hpp"
+#include "../include/format.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/parser.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+/* 20 inputs: a decoder of one address, a comparator and the decoder again */
+static const size_t INPUTS = 20;
+static const size_t ADDRESS = 0xabcde;
+static const size_t LIMIT = 300000;
+
+static bool reference(size_t i, size_t output) {
+    return output == 1 ? i < LIMIT : i == ADDRESS;
+}
+
+static vector<uint64_t> reference_words() {
+    size_t count = size_t { 1 } << INPUTS;
+    vector<uint64_t> words(count / 64 * 3);
+
+    for (size_t o = 0; o < 3; o++)
+        for (size_t i = 0; i < count; i++)
+            words[o * count / 64 + i / 64] |=
+                uint64_t { reference(i, o) } << (i % 64);
+
+    return words;
+}
+
+static string hex_table(const vector<uint64_t> &words, size_t output) {
+    static const char digits[] = "0123456789abcdef";
+    size_t word_count = (size_t { 1 } << INPUTS) / 64;
+    string res = "0x";
+
+    for (size_t w = word_count; w-- > 0;)
+        for (size_t i = 16; i-- > 0;)
+            res += digits[(words[output * word_count + w] >> (i * 4)) & 0xf];
+
+    return res;
+}
+
+int main() {
+    auto words = reference_words();
+    size_t dense = words.size() * sizeof(uint64_t);
+
+    /* compressed, with the same lookups */
+    Lut lut { Table {}, 1, INPUTS, 3, vector<uint64_t> { words } };
+
+    assert(lut.compressed() && lut.table_bytes() * 100 < dense,
+           "decoder takes %zu bytes", lut.table_bytes());
+
+    for (size_t i = 0; i < (size_t { 1 } << INPUTS); i++)
+        for (size_t o = 0; o < 3; o++)
+            assert(lut.lookup(i, o) == reference(i, o),
+                   "output %zu differs at %zu", o, i);
+
+    /* equal outputs share their nodes */
+    size_t word_count = words.size() / 3;
+    Bdd one { { words.data(), word_count }, word_count, 1 };
+    Bdd both { { words.data(), 2 * word_count }, word_count, 2 };
+    Bdd same { words, word_count, 3 };
+
+    assert(one.node_count() > 0 && same.node_count() == both.node_count(),
+           "outputs do not share nodes, %zu against %zu",
+           same.node_count(), both.node_count());
+
+    /* random tables are left packed */
+    std::mt19937_64 rng { 1 };
+    vector<uint64_t> noise((size_t { 1 } << 16) / 64);
+    for (auto &word : noise)
+        word = rng();
+
+    Lut random { Table {}, 1, 16, 1, vector<uint64_t> { noise } };
+    assert(!random.compressed() && random.table_bytes() == noise.size() * 8,
+           "random table is compressed");
+
+    /* loaded from source and written back the same */
+    string source = "lut<20, 3> d = (" + hex_table(words, 0) + ", " +
+        hex_table(words, 1) + ", " + hex_table(words, 2) + ");\n";
+
+    stringstream ss { source };
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    Parser parser { intr, lex };
+
+    while (parser.next() != Parsed::END)
+        ;
+
+    assert(intr.get_luts().begin()->second.compressed(),
+           "loaded lut is not compressed");
+
+    stringstream out;
+    Writer { out, lex, { .ids = false, .hex = true } }.write(intr);
+
+    assert(out.str() == source, "compressed lut is written differently");
+}
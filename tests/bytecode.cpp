@@ -0,0 +1,132 @@
+#include "../include/activity.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/profile.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+/* the same stimuli applied through bytecode and through `advance`, both
+ * counting into a profile and an activity */
+static void compare(const string &source, const char *name, bool clocked) {
+    stringstream ss_code { source }, ss_events { source };
+    Lex lex_code { ss_code }, lex_events { ss_events };
+    Interpreter code { global_cfg()->new_parser() };
+    Interpreter events { global_cfg()->new_parser() };
+
+    load(code, lex_code);
+    load(events, lex_events);
+
+    Simulation sim_code { code }, sim_events { events };
+    Profile profile_code, profile_events;
+    Activity activity_code, activity_events;
+
+    sim_code.set_profile(&profile_code);
+    sim_code.set_activity(&activity_code);
+    sim_events.set_profile(&profile_events);
+    sim_events.set_activity(&activity_events);
+
+    auto inputs = undriven(code);
+
+    std::mt19937 rng { 7 };
+
+    for (size_t round = 0; round < 64; round++) {
+        vector<Stimulus> stimuli;
+        for (size_t i = 0; i < 8 && inputs.size(); i++)
+            stimuli.emplace_back(inputs[rng() % inputs.size()], rng() & 1);
+
+        sim_code.apply(stimuli);
+
+        for (auto &[id, state] : stimuli)
+            sim_events.set_wire_state(id, state);
+
+        while (!sim_events.settled())
+            sim_events.advance();
+
+        if (clocked) {
+            sim_code.clock();
+            sim_events.clock();
+        }
+
+        auto it = events.get_wires().begin();
+        for (auto &[id, wire] : code.get_wires())
+            assert(wire.state == (it++)->second.state,
+                   "%s: round %zu, wire %zu differs", name, round, id);
+    }
+
+    assert(sim_code.evaluation_count() == sim_events.evaluation_count() &&
+           sim_code.now() == sim_events.now(),
+           "%s: %llu evaluations at %llu instead of %llu at %llu", name,
+           (unsigned long long) sim_code.evaluation_count(),
+           (unsigned long long) sim_code.now(),
+           (unsigned long long) sim_events.evaluation_count(),
+           (unsigned long long) sim_events.now());
+
+    /* stabilizations are counted by `stabilize` only */
+    assert(profile_code.evaluations == profile_events.evaluations &&
+           profile_code.redundant_evaluations ==
+           profile_events.redundant_evaluations &&
+           profile_code.toggles == profile_events.toggles &&
+           profile_code.unit_evaluations == profile_events.unit_evaluations &&
+           profile_code.lut_evaluations == profile_events.lut_evaluations &&
+           profile_code.wire_toggles == profile_events.wire_toggles,
+           "%s: profiles differ", name);
+
+    sim_code.set_activity(nullptr);
+    sim_events.set_activity(nullptr);
+
+    assert(activity_code.toggles == activity_events.toggles &&
+           activity_code.time_at_1(activity_code.stop) ==
+           activity_events.time_at_1(activity_events.stop),
+           "%s: activities differ", name);
+}
+
+int main() {
+    for (const char *kind : { "ripple", "cla", "mult", "dag", "fanout" }) {
+        stringstream design;
+        Generator { design, 3 }.generate(kind, 64);
+
+        compare(design.str(), kind, false);
+    }
+
+    for (const char *kind : { "latch", "pipeline" }) {
+        stringstream design;
+        Generator { design, 3 }.generate(kind, 64);
+
+        compare(design.str(), kind, true);
+    }
+
+    /* wide luts, constant units and a loop settling in a few generations */
+    compare("lut<8, 2> parity = (0x" + string(63, '6') + "9, 0x" +
+            string(64, 'f') + ");"
+            "lut<1, 1> one = (0b11);"
+            "lut<2, 1> nand = (0b0111);"
+            "wire a = 0; wire b = 0; wire c = 0; wire d = 0;"
+            "wire e = 0; wire f = 0; wire g = 0; wire h = 0;"
+            "wire p = 0; wire q = 0; wire k = 0; wire s = 0; wire r = 1;"
+            "unit<parity> u = (a, b, c, d, e, f, g, h) -> (p, q);"
+            "unit<one> v = (a) -> (k);"
+            "unit<nand> x = (p, r) -> (s);"
+            "unit<nand> y = (s, k) -> (r);",
+            "wide", false);
+
+    /* a wire driven twice, toggled back in the generation it toggles */
+    compare("lut<1, 1> buf = (0b10);"
+            "lut<1, 1> inv = (0b01);"
+            "wire a = 0; wire b = 0; wire w = 0; wire z = 0;"
+            "unit<buf> u = (a) -> (w);"
+            "unit<inv> v = (a) -> (w);"
+            "unit<buf> x = (w) -> (z);",
+            "driven twice", false);
+}
@@ -0,0 +1,120 @@
+#include "../include/checkpoint.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+int main() {
+    stringstream ss;
+    ss << "lut<1, 1> not1 = (0b01);"
+        "lut<2, 1> nand2 = (0b0111);"
+
+        /* set-reset latch, and a settled chain of inverters */
+        "wire s = 1; wire r = 1; wire q = 0; wire nq = 1;"
+        "unit<nand2> u1 = (s, nq) -> (q);"
+        "unit<nand2> u2 = (r, q) -> (nq);";
+
+    for (int i = 1; i < 100; i++)
+        ss << "wire w" << i << " = " << i % 2 << ";"
+            "unit<not1> c" << i << " = (" << (i == 1 ? "q" : "w") <<
+            (i == 1 ? "" : std::to_string(i - 1)) << ") -> (w" << i << ");";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+    auto state = [&](const char *name) {
+        return intr.get_wires().at(id(name)).state;
+    };
+
+    Simulation sim { intr };
+
+    /* warm-up, the latch is set */
+    sim.apply({ { id("s"), 0 } });
+    sim.apply({ { id("s"), 1 } });
+
+    sim.clock();
+    assert(state("q") && !state("nq") && !state("w99"), "latch is not set");
+
+    /* pending event is a part of the state */
+    sim.set_wire_state(id("r"), 0);
+    Checkpoint warm = sim.checkpoint();
+
+    assert(warm.wire_count == 103 && warm.unit_count == 101 &&
+           warm.states.size() == 2 && warm.scheduled_units.empty() &&
+           warm.changed_wires == vector<WireId> { id("r") },
+           "unexpected checkpoint");
+
+    sim.stabilize();
+    assert(!state("q") && state("w99"), "latch is not reset");
+
+    sim.clock();
+
+    for (int i = 0; i < 3; i++) {
+        sim.restore(warm);
+
+        assert(state("q") && !state("r") && !state("w99") &&
+               sim.now() == warm.time && sim.cycle_count() == 1,
+               "state is not restored");
+
+        sim.stabilize();
+        assert(!state("q") && state("w99"), "pending event is lost");
+    }
+
+    stringstream file;
+    warm.write(file);
+
+    Checkpoint read = Checkpoint::read(file);
+    assert(read.states == warm.states && read.time == warm.time &&
+           read.cycles == 1 && read.changed_wires == warm.changed_wires &&
+           read.layout == warm.layout,
+           "checkpoint changes when written and read");
+
+    sim.restore(read);
+    assert(state("q") && !state("w99"), "read checkpoint is not restored");
+
+    stringstream truncated { file.str().substr(0, 40) };
+    try {
+        Checkpoint::read(truncated);
+        assert(false, "truncated checkpoint is read");
+    } catch (std::invalid_argument &) {}
+
+    /* more units scheduled than there are, which are not allocated */
+    string huge = file.str();
+    uint64_t count = UINT64_MAX / 8;
+    huge.replace(huge.size() - sizeof(count), sizeof(count),
+                 reinterpret_cast<const char *>(&count), sizeof(count));
+
+    stringstream huge_ss { huge };
+    try {
+        Checkpoint::read(huge_ss);
+        assert(false, "oversized checkpoint is read");
+    } catch (std::invalid_argument &) {}
+
+    /* another netlist with as many wires */
+    stringstream other_ss;
+    for (int i = 0; i < 103; i++)
+        other_ss << "wire x" << i << " = 0;";
+
+    Lex other_lex { other_ss };
+    Interpreter other { global_cfg()->new_parser() };
+    load(other, other_lex);
+
+    Simulation other_sim { other };
+    try {
+        other_sim.restore(warm);
+        assert(false, "checkpoint of another netlist is restored");
+    } catch (std::invalid_argument &) {}
+}
@@ -0,0 +1,183 @@
+#include "../include/interpreter.hpp"
+#include "../include/checkpoint.hpp"
+#include "../include/fourstate.hpp"
+#include "../include/profile.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <bit>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+void test_counter() {
+    stringstream ss;
+    ss << "reg<1, 1> dff = (0b10);"
+        "lut<1, 1> not1 = (0b01);"
+        "lut<2, 1> and2 = (0b1000);"
+        "lut<2, 1> xor2 = (0b0110);"
+
+        "wire q0 = 0; wire q1 = 0; wire q2 = 0; wire q3 = 0;"
+        "wire d0 = 1; wire d1 = 0; wire d2 = 0; wire d3 = 0;"
+        "wire c1 = 0; wire c2 = 0;"
+
+        /* 4-bit counter */
+        "unit<not1> n0 = (q0) -> (d0);"
+        "unit<xor2> x1 = (q1, q0) -> (d1);"
+        "unit<and2> a1 = (q1, q0) -> (c1);"
+        "unit<xor2> x2 = (q2, c1) -> (d2);"
+        "unit<and2> a2 = (q2, c1) -> (c2);"
+        "unit<xor2> x3 = (q3, c2) -> (d3);"
+
+        "unit<dff> r0 = (d0) -> (q0);"
+        "unit<dff> r1 = (d1) -> (q1);"
+        "unit<dff> r2 = (d2) -> (q2);"
+        "unit<dff> r3 = (d3) -> (q3);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    stringstream dump;
+    intr.dump(dump, lex);
+    assert(dump.str().find("reg<1, 1> dff") != string::npos,
+           "registers are dumped as luts");
+
+    auto value = [&]() {
+        int res = 0;
+
+        for (int i = 0; i < 4; i++)
+            res |= intr.get_wires().at(
+                lex.get_ident_id("q" + std::to_string(i))
+            ).state << i;
+
+        return res;
+    };
+
+    Simulation sim { intr };
+
+    /* inputs of registers change, outputs do not */
+    sim.set_wire_state(lex.get_ident_id("q0"), 1);
+    sim.stabilize();
+    sim.set_wire_state(lex.get_ident_id("q0"), 0);
+    sim.stabilize();
+    assert(value() == 0, "registers change without clock");
+
+    for (int i = 0; i < 3; i++)
+        sim.clock();
+    assert(value() == 3, "unexpected count: %d", value());
+
+    sim.run_cycles(10);
+    assert(value() == 13, "unexpected count: %d", value());
+
+    sim.run_cycles(5);
+    assert(value() == 2 && sim.cycle_count() == 18,
+           "unexpected count: %d", value());
+
+    /* both paths end in the same state */
+    Checkpoint start = sim.checkpoint();
+
+    sim.run_cycles(100);
+    Checkpoint fast = sim.checkpoint();
+
+    sim.restore(start);
+    for (int i = 0; i < 100; i++)
+        sim.clock();
+
+    assert(sim.checkpoint().states == fast.states,
+           "cycle-based and event-driven paths differ");
+
+    Profile profile;
+    sim.set_profile(&profile);
+    sim.run_cycles(4);
+
+    assert(value() == 6 + 4 && profile.stabilizations == 8,
+           "profiled cycles are not event-driven");
+}
+
+void test_loop() {
+    stringstream ss;
+    ss << "reg<1, 1> dff = (0b10);"
+        "lut<2, 1> nand2 = (0b0111);"
+
+        "wire s = 1; wire r = 1; wire q = 0; wire nq = 1; wire p = 0;"
+        "unit<nand2> u1 = (s, nq) -> (q);"
+        "unit<nand2> u2 = (r, q) -> (nq);"
+        "unit<dff> rq = (q) -> (p);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    Simulation sim { intr };
+
+    try {
+        sim.run_cycles(1);
+        assert(false, "combinational loop is levelized");
+    } catch (std::invalid_argument &) {}
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    sim.apply({ { id("s"), 0 } });
+    sim.clock();
+
+    assert(intr.get_wires().at(id("p")).state, "latch is not registered");
+}
+
+/* a lut too wide for a byte table, looked up in place by both engines */
+void test_wide() {
+    stringstream ss;
+    ss << "reg<1, 1> dff = (0b10);"
+        "lut<13, 1> parity = (0x";
+
+    /* four inputs a digit, highest first */
+    for (int digit = 2047; digit >= 0; digit--)
+        ss << (std::popcount(unsigned(digit)) % 2 ? '9' : '6');
+
+    ss << ");wire o = 0; wire p = 0;";
+
+    for (int i = 0; i < 13; i++)
+        ss << "wire i" << i << " = 0;";
+
+    ss << "unit<parity> u = (i0";
+    for (int i = 1; i < 13; i++)
+        ss << ", i" << i;
+    ss << ") -> (o); unit<dff> r = (o) -> (p);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const string &name) { return lex.get_ident_id(name); };
+
+    Simulation sim { intr };
+
+    for (unsigned pattern : { 0u, 1u, 0x1fffu, 0x1234u, 0x0f0fu }) {
+        for (int i = 0; i < 13; i++)
+            sim.set_wire_state(id("i" + std::to_string(i)), pattern >> i & 1);
+
+        sim.run_cycles(1);
+
+        bool expected = std::popcount(pattern) % 2;
+        assert(intr.get_wires().at(id("p")).state == expected,
+               "parity of %x is wrong", pattern);
+
+        FourState four { intr, true };
+        four.settle();
+        assert(four.get(id("o")) == (expected ? Logic::L1 : Logic::L0),
+               "four-state parity of %x is wrong", pattern);
+    }
+}
+
+int main() {
+    test_counter();
+    test_loop();
+    test_wide();
+}
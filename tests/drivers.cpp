@@ -0,0 +1,65 @@
+#include "../include/drivers.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+int main() {
+    stringstream ss;
+    ss << "lut<1, 1> buf1 = (0b10);"
+        "lut<2, 2> half = (0b1000, 0b0110);"
+
+        "wire a = 0; wire b = 0; wire c = 0; wire s = 0; wire v = 0;"
+        "wire n = 0; wire f = 0;"
+        "unit<half> h = (a, b) -> (c, s);"
+        "unit<buf1> d1 = (s) -> (v);"
+        "unit<buf1> d2 = (c) -> (v);"
+        "unit<buf1> g = (b) -> (n);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    const Drivers &drivers = intr.drivers();
+
+    assert(drivers.of(id("s")).size() == 1 &&
+           drivers.of(id("s"))[0] == (Port { id("h"), 1 }) &&
+           drivers.of(id("a")).empty(),
+           "unexpected drivers");
+
+    assert(drivers.multiply_driven == vector<WireId> { id("v") } &&
+           drivers.floating == vector<WireId> { id("f") },
+           "unexpected problems");
+
+    vector<WireId> outputs { id("v") };
+    assert(drivers.cone(outputs) ==
+           (vector<UnitId> { id("h"), id("d1"), id("d2") }),
+           "unexpected cone");
+
+    stringstream problems;
+    drivers.dump_problems(problems, lex);
+    assert(problems.str().find("v is driven by d1[0] d2[0]") != string::npos &&
+           problems.str().find("f is neither driven nor read") != string::npos,
+           "unexpected warnings: %s", problems.str().c_str());
+
+    /* index follows the netlist */
+    stringstream more { "unit<buf1> e = (f) -> (n);" };
+    Lex more_lex { more, lex };
+    load(intr, more_lex);
+
+    assert(intr.drivers().multiply_driven ==
+           (vector<WireId> { id("v"), id("n") }) &&
+           intr.drivers().floating.empty(),
+           "index is not rebuilt");
+}
@@ -0,0 +1,168 @@
+#include "../include/fault.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+void test_and_gate() {
+    stringstream ss;
+    ss << "lut<2, 1> and2 = (0b1000);"
+        "wire a = 0; wire b = 0; wire c = 0;"
+        "unit<and2> g = (a, b) -> (c);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    FaultSim fsim { intr };
+    assert(fsim.faults().size() == 12, "wires and ports are not enumerated");
+
+    vector<Pattern> patterns { { { id("a"), 1 }, { id("b"), 1 } } };
+
+    auto report = fsim.run(patterns);
+    assert(report.detected_count == 6, "only stuck-at-0 faults are detected");
+
+    stringstream out;
+    report.dump(out, lex);
+    string coverage = "coverage 50.00%";
+    assert(out.str().find(coverage) != string::npos &&
+           out.str().find("  unit g input 1 stuck-at-1\n") != string::npos,
+           "unexpected report:\n%s", out.str().c_str());
+
+    patterns.push_back({ { id("a"), 0 } });
+    patterns.push_back({ { id("a"), 1 }, { id("b"), 0 } });
+
+    report = fsim.run(patterns);
+    assert(report.detected_count == 12, "exhaustive patterns miss faults");
+
+    /* nothing propagates to an unobserved wire */
+    report = FaultSim { intr, { id("a") } }.run(patterns);
+    assert(report.detected_count == 2, "only faults of a are observable");
+
+    vector<Pattern> invalid { { { id("and2"), 1 } } };
+    try {
+        fsim.run(invalid);
+        assert(false, "unknown wire is accepted");
+    } catch (std::invalid_argument &) {}
+}
+
+void test_batches() {
+    stringstream ss;
+    ss << "lut<1, 1> not1 = (0b01);"
+        "wire w0 = 0;";
+
+    /* 80 wires and 79 units, 476 faults in 8 batches */
+    for (int i = 1; i < 80; i++)
+        ss << "wire w" << i << " = " << (i % 2) << ";"
+            "unit<not1> u" << i << " = (w" << i - 1 << ") -> (w" << i << ");";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    stringstream patterns_ss { "w0=1\nw0=0\n" };
+    auto patterns = read_patterns(patterns_ss, lex, intr);
+    assert(patterns.size() == 2, "patterns are not read");
+
+    FaultSim fsim { intr };
+
+    auto single = fsim.run(patterns, 1);
+    auto parallel = fsim.run(patterns, 4);
+
+    assert(single.faults.size() == 476 && single.detected_count == 476,
+           "inverter chain is not fully covered: %zu",
+           single.detected_count);
+    assert(single.detected == parallel.detected,
+           "threads change the result");
+
+    /* first pattern leaves every line at one of its values */
+    auto half = fsim.run(std::span { patterns }.first(1), 3);
+    assert(half.detected_count == 238, "unexpected coverage: %zu",
+           half.detected_count);
+}
+
+/* lanes refilled with faults midway detect what faults run alone do */
+void test_refill() {
+    stringstream latch;
+    Generator { latch, 5 }.generate("latch", 24);
+
+    /* wide luts, looked up lane by lane, behind registers that hold what
+     * a stale lane would leave */
+    stringstream wide;
+    wide << "lut<8, 1> and8 = (0b1" << string(255, '0') << ");"
+        "lut<2, 1> xor2 = (0b0110);"
+        "reg<1, 1> dff = (0b10);";
+
+    for (int i = 0; i < 8; i++) {
+        string in[8];
+        for (int j = 0; j < 8; j++) {
+            in[j] = "i" + std::to_string(i * 8 + j);
+            wide << "wire " << in[j] << " = 0;";
+        }
+
+        wide << "wire y" << i << " = 0; wire q" << i << " = 0;"
+            "wire z" << i << " = 0;"
+            "unit<and8> u" << i << " = (" << in[0] << ", " << in[1] << ", " <<
+            in[2] << ", " << in[3] << ", " << in[4] << ", " << in[5] <<
+            ", " << in[6] << ", " << in[7] << ") -> (y" << i << ");"
+            "unit<dff> r" << i << " = (y" << i << ") -> (q" << i << ");"
+            "unit<xor2> x" << i << " = (q" << i << ", " << in[0] <<
+            ") -> (z" << i << ");";
+    }
+
+    for (const string &source : { latch.str(), wide.str() }) {
+        Interpreter intr { global_cfg()->new_parser() };
+        load(intr, source);
+
+        auto inputs = undriven(intr);
+
+        std::mt19937 rng { 11 };
+        vector<Pattern> patterns(12);
+        for (size_t i = 0; i < patterns.size(); i++)
+            for (WireId id : inputs)
+                patterns[i].emplace_back(id, i > 3 || rng() % 4);
+
+        /* every wire of the latches is read, so driven ones are observed */
+        vector<WireId> observed;
+        for (auto &[id, _] : intr.get_wires())
+            if (std::find(inputs.begin(), inputs.end(), id) == inputs.end())
+                observed.push_back(id);
+
+        FaultSim fsim { intr, observed };
+        auto report = fsim.run(patterns, 2);
+
+        assert(report.detected_count > 0 &&
+               report.detected_count < report.faults.size(),
+               "patterns detect %zu of %zu faults", report.detected_count,
+               report.faults.size());
+
+        for (size_t i = 0; i < report.faults.size(); i++) {
+            auto alone = fsim.run({ report.faults[i] }, patterns, 1);
+
+            assert(alone.detected[0] == report.detected[i],
+                   "fault %zu is detected only alone or only with others",
+                   i);
+        }
+    }
+}
+
+int main() {
+    test_and_gate();
+    test_batches();
+    test_refill();
+}
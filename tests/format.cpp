@@ -0,0 +1,116 @@
+#include "../include/format.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/parser.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::stringstream;
+
+
+static const char *source =
+    "lut<0, 1> one = (1);"
+    "lut<1, 3> three = (1, 2, 0b11);"
+    "reg<3, 2> r = (0x5a, 0o7) { k: 2 };"
+    "lut<7, 1> wide = (0xdeadbeefcafe1234);"
+    "wire a = 1 { _path: [(1, 2), u; (3, 4)], _at: u };"
+    "wire b = 0;"
+    "unit<r> u = (a, a, b) -> (b, a) { _pos: (5, 6) };";
+
+/* netlist written with `options`, loaded again and written with defaults */
+static string reload(const string &text, WriteOptions options,
+                     string *written = nullptr) {
+    stringstream ss { text };
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    Parser parser { intr, lex };
+
+    while (parser.next() != Parsed::END)
+        ;
+
+    stringstream out;
+    Writer { out, lex, options }.write(intr);
+
+    if (written)
+        *written = out.str();
+
+    stringstream again_ss { out.str() };
+    Lex again_lex { again_ss };
+    Interpreter again { global_cfg()->new_parser() };
+    Parser again_parser { again, again_lex };
+
+    while (again_parser.next() != Parsed::END)
+        ;
+
+    stringstream dump;
+    again.dump(dump, again_lex);
+
+    return dump.str();
+}
+
+int main() {
+    string plain;
+    string dump = reload(source, {}, &plain);
+
+    assert(plain == dump, "default options differ from dump");
+
+    assert(dump.find("lut<0, 1> one /*l1*/ = (0b1);\n"
+                     "lut<1, 3> three /*l2*/ = (0b01, 0b10, 0b11);\n"
+                     "reg<3, 2> r /*l3*/ = (0b01011010, 0b00000111)\n"
+                     "{\n"
+                     "    k /*p4*/: 2\n"
+                     "};\n") == 0 &&
+           dump.find("wire a /*w6*/ = 1\n"
+                     "{\n"
+                     "    _path /*p7*/: [(1, 2), u /*i8*/; (3, 4)],\n"
+                     "    _at /*p9*/: u /*i8*/\n"
+                     "};\n") != string::npos,
+           "unexpected dump:\n%s", dump.c_str());
+
+    /* hexadecimal tables read back into the same luts */
+    string hex;
+    assert(reload(source, { .hex = true }, &hex) == dump &&
+           hex.find("(0x1, 0x2, 0x3)") != string::npos &&
+           hex.find("(0x5a, 0x07)") != string::npos &&
+           hex.find("0x0000000000000000deadbeefcafe1234") != string::npos,
+           "hexadecimal tables differ:\n%s", hex.c_str());
+
+    /* without identifiers and metadata, output is plain source */
+    string stripped;
+    reload(source, { .ids = false, .metadata = false }, &stripped);
+    assert(stripped.find("/*") == string::npos &&
+           stripped.find('{') == string::npos &&
+           stripped.find("unit<r> u = (a, a, b) -> (b, a);") != string::npos,
+           "unexpected stripped output:\n%s", stripped.c_str());
+
+    /* larger than a block, the same as statements written one by one */
+    stringstream design;
+    Generator { design, 1 }.generate("dag", 4096);
+
+    Lex lex { design };
+    Interpreter intr { global_cfg()->new_parser() };
+    Parser parser { intr, lex };
+
+    while (parser.next() != Parsed::END)
+        ;
+
+    stringstream big, statements;
+    intr.dump(big, lex);
+
+    for (auto &[_, lut] : intr.get_luts())
+        lut.dump(statements, lex) << "\n";
+    statements << "\n";
+    for (auto &[_, wire] : intr.get_wires())
+        wire.dump(statements, lex) << "\n";
+    statements << "\n";
+    for (auto &[_, unit] : intr.get_units())
+        unit.dump(statements, lex) << "\n";
+
+    assert(big.str().size() > Writer::BLOCK_SIZE &&
+           big.str() == statements.str(),
+           "blocks are not written in order");
+}
@@ -0,0 +1,166 @@
+#include "../include/fourstate.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+void test_propagation() {
+    stringstream ss;
+    ss << "lut<1, 1> buf1 = (0b10);"
+        "lut<2, 1> and2 = (0b1000);"
+        "lut<2, 1> or2 = (0b1110);"
+        "lut<2, 1> xor2 = (0b0110);"
+        "lut<8, 1> and8 = (0b1"
+        << string(255, '0') << ");"
+
+        "wire a = 0; wire b = 0; wire n = 0; wire o = 0; wire x = 0;"
+        "wire w = 0; wire v = 0;"
+        "unit<and2> u1 = (a, b) -> (n);"
+        "unit<or2> u2 = (a, b) -> (o);"
+        "unit<xor2> u3 = (a, a) -> (x);"
+        "unit<and8> u4 = (a, b, b, b, b, b, b, b) -> (w);"
+
+        /* a bus driven by two units */
+        "unit<buf1> d1 = (a) -> (v);"
+        "unit<buf1> d2 = (b) -> (v);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    FourState fs { intr };
+
+    assert(fs.get(id("a")) == Logic::L0 && fs.get(id("n")) == Logic::X &&
+           fs.unknown_wires().size() == 5,
+           "driven wires do not start unknown");
+
+    fs.apply(vector<Stimulus4> { { id("a"), Logic::X } });
+    assert(fs.get(id("n")) == Logic::L0 && fs.get(id("o")) == Logic::X &&
+           fs.get(id("x")) == Logic::X && fs.get(id("w")) == Logic::L0 &&
+           fs.get(id("v")) == Logic::X,
+           "unknown input is not propagated");
+
+    fs.apply(vector<Stimulus4> { { id("b"), Logic::L1 } });
+    assert(fs.get(id("n")) == Logic::X && fs.get(id("o")) == Logic::L1 &&
+           fs.get(id("w")) == Logic::X,
+           "unknown input is not propagated");
+
+    fs.apply(vector<Stimulus4> { { id("a"), Logic::L1 } });
+    assert(fs.get(id("v")) == Logic::L1 && fs.unknown_wires().empty(),
+           "agreeing drivers do not resolve");
+
+    fs.apply(vector<Stimulus4> { { id("b"), Logic::L0 } });
+    assert(fs.get(id("v")) == Logic::X &&
+           fs.unknown_wires() == vector<WireId> { id("v") },
+           "contending drivers do not resolve to X");
+
+    /* high impedance reads as X */
+    fs.apply(vector<Stimulus4> { { id("a"), Logic::Z } });
+    assert(fs.get(id("a")) == Logic::Z && fs.get(id("o")) == Logic::X,
+           "Z input is not unknown");
+
+    stringstream dump;
+    fs.dump_unknown(dump, lex);
+    assert(dump.str().find("a = z\n") != string::npos &&
+           dump.str().find("o = x\n") != string::npos,
+           "unexpected dump: %s", dump.str().c_str());
+
+    try {
+        fs.get(id("nothing"));
+        assert(false, "unknown wire is read");
+    } catch (std::invalid_argument &) {}
+}
+
+void test_reset() {
+    stringstream ss;
+    ss << "reg<1, 1> dff = (0b10);"
+        "lut<1, 1> not1 = (0b01);"
+        "lut<2, 1> and2 = (0b1000);"
+        "lut<2, 1> nand2 = (0b0111);"
+        "lut<2, 1> xor2 = (0b0110);"
+
+        "wire nrst = 1; wire q0 = 0; wire q1 = 0; wire t0 = 0; wire t1 = 0;"
+        "wire d0 = 0; wire d1 = 0;"
+
+        /* 2-bit counter, synchronous reset on low `nrst` */
+        "unit<not1> n0 = (q0) -> (t0);"
+        "unit<xor2> x1 = (q1, q0) -> (t1);"
+        "unit<and2> r0 = (t0, nrst) -> (d0);"
+        "unit<and2> r1 = (t1, nrst) -> (d1);"
+        "unit<dff> f0 = (d0) -> (q0);"
+        "unit<dff> f1 = (d1) -> (q1);"
+
+        /* a latch, unknown until set */
+        "wire s = 1; wire r = 1; wire q = 0; wire nq = 1;"
+        "unit<nand2> l1 = (s, nq) -> (q);"
+        "unit<nand2> l2 = (r, q) -> (nq);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    FourState fs { intr };
+
+    fs.run_cycles(4);
+    assert(fs.get(id("q0")) == Logic::X && fs.get(id("q1")) == Logic::X &&
+           fs.get(id("q")) == Logic::X,
+           "state is known without reset");
+
+    fs.set(id("nrst"), Logic::L0);
+    fs.run_cycles(1);
+    assert(fs.get(id("q0")) == Logic::L0 && fs.get(id("q1")) == Logic::L0,
+           "reset does not clear registers");
+
+    fs.set(id("nrst"), Logic::L1);
+    fs.run_cycles(3);
+    assert(fs.get(id("q0")) == Logic::L1 && fs.get(id("q1")) == Logic::L1,
+           "counter does not count after reset");
+
+    fs.apply(vector<Stimulus4> { { id("s"), Logic::L0 } });
+    fs.apply(vector<Stimulus4> { { id("s"), Logic::L1 } });
+    assert(fs.get(id("q")) == Logic::L1 && fs.get(id("nq")) == Logic::L0 &&
+           fs.unknown_wires().empty(),
+           "latch is not set");
+}
+
+void test_oscillation() {
+    stringstream ss;
+    ss << "lut<1, 1> not1 = (0b01);"
+        "wire a = 0; wire b = 1; wire c = 0;"
+        "unit<not1> i1 = (a) -> (b);"
+        "unit<not1> i2 = (b) -> (c);"
+        "unit<not1> i3 = (c) -> (a);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, lex);
+
+    FourState fs { intr };
+
+    /* ring settles from X, and stays X once forced to a value */
+    fs.settle();
+    fs.apply(vector<Stimulus4> { { lex.get_ident_id("a"), Logic::L0 } });
+
+    assert(fs.unknown_wires().size() == 3,
+           "oscillating ring is not unknown");
+}
+
+int main() {
+    test_propagation();
+    test_reset();
+    test_oscillation();
+}
@@ -5,13 +5,19 @@
 
 #include <rdesc/rdesc.h>
 
+#include <cstdint>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 using std::string;
+using std::vector;
 using std::stringstream;
+using std::make_shared;
 
 
 template<typename E>
@@ -34,7 +40,166 @@ void tests_should_fail(const char *input) {
     } catch (E &) {}
 }
 
+enum class Mode { FULL, STRIP };
+
+string dump_with_metadata(Mode mode, const char *input) {
+    stringstream ss { input };
+    auto lex = make_shared<Lex>(ss);
+
+    Interpreter intr { global_cfg()->new_parser() };
+
+    if (mode == Mode::STRIP)
+        intr.strip_metadata(lex);
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex->next()).id != TK_EOF)
+        assert(intr.pump(tk) != RDESC_NOMATCH,
+               "syntax error");
+
+    stringstream out;
+    intr.dump(out, *lex);
+
+    return out.str();
+}
+
+void test_metadata_modes() {
+    const char *input =
+        "lut<1, 1> not1 = (0b01) { prop_delay: 2, _shape: [(0, 0), (6, 4);"
+        "    (6, 4), (8, 4)], _input: [(0, 4)], _output: [(8, 4)] };"
+        "wire a = 1 { _path: [(2, 5), uut1] };"
+        "wire b = 0 { _path: [uut1, (20, 5)] };"
+        "unit<not1> uut1 = (a) -> (b) { _pos: (5, 5) };";
+
+    auto full = dump_with_metadata(Mode::FULL, input);
+
+    assert(full.find("_shape") != string::npos, "metadata is not kept");
+
+    auto stripped = dump_with_metadata(Mode::STRIP, input);
+
+    assert(stripped.find("prop_delay") != string::npos,
+           "non-metadata entry is stripped");
+    assert(stripped.find(" _") == string::npos,
+           "metadata is not stripped");
+}
+
+static const Lut &load_lut(Interpreter &intr, const string &input) {
+    stringstream ss { input };
+    Lex lex { ss };
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex.next()).id != TK_EOF)
+        assert(intr.pump(tk) != RDESC_NOMATCH,
+               "syntax error");
+
+    return intr.get_luts().begin()->second;
+}
+
+/* decimal digits of `words`, by repeated division */
+static string decimal(vector<uint64_t> words) {
+    const uint64_t chunk_scale = 10'000'000'000'000'000'000u;
+    string res;
+
+    while (words.size()) {
+        unsigned __int128 rem = 0;
+
+        for (size_t i = words.size(); i-- > 0;) {
+            rem = rem << 64 | words[i];
+            words[i] = rem / chunk_scale;
+            rem = rem - words[i] * static_cast<unsigned __int128>(chunk_scale);
+        }
+
+        while (words.size() && !words.back())
+            words.pop_back();
+
+        string chunk = std::to_string(static_cast<uint64_t>(rem));
+        if (words.size())
+            chunk.insert(0, 19 - chunk.size(), '0');
+
+        res.insert(0, chunk);
+    }
+
+    return res.empty() ? "0" : res;
+}
+
+void test_wide_luts() {
+    /* 2^64 + 2^127 + 1, wider than any integer type */
+    Interpreter dec { global_cfg()->new_parser() };
+    const Lut &d = load_lut(
+        dec, "lut<7, 1> d = (170141183460469231750134047789593657345);"
+    );
+
+    for (size_t i = 0; i < 128; i++)
+        assert(d.lookup(i, 0) == (i == 0 || i == 64 || i == 127),
+               "decimal bit %zu is wrong", i);
+
+    /* 2^128 + 5, of which only 5 fits */
+    Interpreter over { global_cfg()->new_parser() };
+    const Lut &o = load_lut(
+        over, "lut<7, 1> o = (340282366920938463463374607431768211461);"
+    );
+
+    for (size_t i = 0; i < 128; i++)
+        assert(o.lookup(i, 0) == (i == 0 || i == 2),
+               "truncated decimal bit %zu is wrong", i);
+
+    /* 16 inputs from decimal literals long enough to be split, the second
+     * ten times the first, past the table */
+    std::mt19937_64 rng { 1 };
+    vector<uint64_t> bits(1 << 10), tenfold(1 << 10);
+    for (auto &word : bits)
+        word = rng();
+
+    unsigned __int128 carry = 0;
+    for (size_t i = 0; i < bits.size(); i++) {
+        carry += static_cast<unsigned __int128>(bits[i]) * 10;
+        tenfold[i] = static_cast<uint64_t>(carry);
+        carry >>= 64;
+    }
+
+    string digits = decimal(bits);
+    Interpreter split { global_cfg()->new_parser() };
+    const Lut &l = load_lut(split, "lut<16, 2> l = (" + digits + "0, " +
+                            digits + ");");
+
+    for (size_t i = 0; i < (1 << 16); i++)
+        assert(l.lookup(i, 1) == (bits[i / 64] >> (i & 63) & 1) &&
+               l.lookup(i, 0) == (tenfold[i / 64] >> (i & 63) & 1),
+               "split decimal bit %zu is wrong", i);
+
+    /* bits past the table are dropped */
+    Interpreter small { global_cfg()->new_parser() };
+    const Lut &s = load_lut(small, "lut<1, 2> s = (7, 0o17);");
+    assert(s.word(0, 0) == 3 && s.word(1, 0) == 3,
+           "literal is not truncated");
+
+    /* 20 inputs, every hex digit is its position modulo 16 */
+    string hex = "lut<20, 2> w = (0x";
+    for (size_t i = (1 << 18); i-- > 0;)
+        hex += "0123456789abcdef"[i & 15];
+    hex += ", 0o";
+    for (size_t i = 0; i < (1 << 20) / 3 + 1; i++)
+        hex += '7';
+    hex += ");";
+
+    Interpreter wide { global_cfg()->new_parser() };
+    const Lut &w = load_lut(wide, hex);
+
+    assert(w.word_count() == (1 << 14), "unexpected word count");
+    for (size_t i : { size_t { 0 }, size_t { 5 }, size_t { 70 },
+                      size_t { 123457 }, size_t { 1 << 20 } - 1 }) {
+        bool bit = (i / 4 & 15) >> (i & 3) & 1;
+
+        assert(w.lookup(i, 0) == bit && w.lookup(i, 1),
+               "wide lut differs at %zu", i);
+    }
+
+    tests_should_fail<std::length_error>("lut<29, 1> huge = (0);");
+}
+
 int main() {
+    test_metadata_modes();
+    test_wide_luts();
+
     tests_should_fail<std::length_error>(
         "lut<2, 1> and = (0b111, 0);"
     );
@@ -0,0 +1,182 @@
+#include "../include/optimize.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+static const char *source =
+    "lut<1, 1> buf1 = (0b10);"
+    "lut<1, 1> not1 = (0b01);"
+    "lut<2, 1> and2 = (0b1000);"
+    "lut<2, 1> or2 = (0b1110);"
+
+    "wire a = 0; wire b = 0; wire c = 0; wire k = 1;"
+    "wire n1 = 1; wire n2 = 0; wire n3 = 0; wire out = 0;"
+    "wire kk = 1; wire o1 = 1; wire m = 0; wire y = 1; wire dead = 0;"
+
+    /* a chain of single-input units */
+    "unit<not1> i1 = (a) -> (n1);"
+    "unit<not1> i2 = (n1) -> (n2);"
+    "unit<buf1> i3 = (n2) -> (n3);"
+    "unit<and2> g1 = (n3, b) -> (out);"
+
+    /* constants */
+    "unit<and2> f1 = (k, k) -> (kk);"
+    "unit<or2> f2 = (a, kk) -> (o1);"
+
+    /* an inverter after a gate */
+    "unit<and2> g2 = (a, c) -> (m);"
+    "unit<not1> i4 = (m) -> (y);"
+
+    /* logic reaching no observed wire */
+    "unit<and2> d1 = (b, c) -> (dead);";
+
+void test_reduce() {
+    stringstream ss { source }, opt_ss { source };
+
+    Lex lex { ss }, opt_lex { opt_ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    Interpreter opt { global_cfg()->new_parser() };
+    load(intr, lex);
+    load(opt, opt_lex);
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    vector<WireId> observed { id("out"), id("o1"), id("y") };
+
+    OptReport report = Optimizer { opt, opt_lex }.run(observed, { id("k") });
+
+    assert(report.dead == 1 && report.folded == 2 && report.collapsed == 3 &&
+           report.fused == 1 && report.units_before == 9 &&
+           report.units_after == 2 && report.wires_after == 6,
+           "unexpected report: dead %zu folded %zu collapsed %zu fused %zu, "
+           "%zu units and %zu wires left", report.dead, report.folded,
+           report.collapsed, report.fused, report.units_after,
+           report.wires_after);
+
+    assert(opt.get_units().at(id("g1")).input_wires ==
+           (vector<WireId> { id("b"), id("a") }) &&
+           opt.get_units().at(id("g1")).lut_id == id("and2"),
+           "chain is not merged into an existing lut");
+
+    stringstream dump;
+    opt.dump(dump, opt_lex);
+    assert(dump.str().find("lut<2, 1> and2_not1") != string::npos,
+           "composed lut is not added: %s", dump.str().c_str());
+
+    /* both give the same values on observed wires */
+    Simulation sim { intr }, opt_sim { opt };
+
+    for (int i = 0; i < 16; i++) {
+        vector<Stimulus> pattern {
+            { id("a"), i & 1 }, { id("b"), i >> 1 & 1 }, { id("c"), i >> 2 & 1 }
+        };
+
+        sim.apply(pattern);
+        opt_sim.apply(pattern);
+
+        for (WireId wire_id : observed)
+            assert(intr.get_wires().at(wire_id).state ==
+                   opt.get_wires().at(wire_id).state,
+                   "optimized netlist differs on pattern %d", i);
+    }
+
+    /* without observed wires, those reading nothing are observed */
+    stringstream all_ss { source };
+    Lex all_lex { all_ss };
+    Interpreter all { global_cfg()->new_parser() };
+    load(all, all_lex);
+
+    report = Optimizer { all, all_lex }.run();
+    assert(report.dead == 0 && report.folded == 0 && report.collapsed == 3 &&
+           report.fused == 2,
+           "unexpected report: dead %zu folded %zu collapsed %zu fused %zu",
+           report.dead, report.folded, report.collapsed, report.fused);
+
+    stringstream printed;
+    report.dump(printed);
+    assert(printed.str() == "Removed 5 of 9 units (0 dead, 0 folded, "
+           "3 collapsed, 2 fused) and 5 of 13 wires\n",
+           "unexpected dump: %s", printed.str().c_str());
+}
+
+void test_fuse() {
+    /* tree of and2 over 8 inputs, and xor2 of two of them */
+    stringstream ss;
+    ss << "lut<2, 1> and2 = (0b1000);"
+        "lut<2, 1> xor2 = (0b0110);";
+
+    for (char c = 'a'; c <= 'h'; c++)
+        ss << "wire " << c << " = 0;";
+
+    ss << "wire ab = 0; wire cd = 0; wire ef = 0; wire abcd = 0;"
+        "wire abcdef = 0; wire abcdefg = 0; wire all = 0; wire x = 0;"
+        "unit<and2> u1 = (a, b) -> (ab);"
+        "unit<and2> u2 = (c, d) -> (cd);"
+        "unit<and2> u3 = (e, f) -> (ef);"
+        "unit<and2> u4 = (ab, cd) -> (abcd);"
+        "unit<and2> u5 = (abcd, ef) -> (abcdef);"
+        "unit<and2> u6 = (abcdef, g) -> (abcdefg);"
+        "unit<and2> u7 = (abcdefg, h) -> (all);"
+        "unit<xor2> u8 = (ab, g) -> (x);";
+
+    string source = ss.str();
+
+    for (bool probe : { false, true }) {
+        stringstream orig_ss { source }, opt_ss { source };
+        Lex lex { orig_ss }, opt_lex { opt_ss };
+        Interpreter intr { global_cfg()->new_parser() };
+        Interpreter opt { global_cfg()->new_parser() };
+        load(intr, lex);
+        load(opt, opt_lex);
+
+        auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+        vector<WireId> observed { id("all"), id("x") };
+        if (probe)
+            observed.push_back(id("cd"));
+
+        OptReport report = Optimizer { opt, opt_lex }.run(observed);
+
+        /* `ab` is read twice, and `all` would need 8 inputs */
+        assert(report.fused == 4 && report.units_after == 4 &&
+               opt.get_wires().contains(id("ab")) &&
+               opt.get_wires().contains(id("cd")) == probe,
+               "unexpected fusion: %zu fused", report.fused);
+
+        for (auto &[_, unit] : opt.get_units())
+            assert(unit.input_wires.size() <= Optimizer::FUSE_INPUTS,
+                   "fused lut is too wide");
+
+        Simulation sim { intr }, opt_sim { opt };
+
+        for (int m = 0; m < 256; m++) {
+            vector<Stimulus> pattern;
+            for (char c = 'a'; c <= 'h'; c++)
+                pattern.emplace_back(lex.get_ident_id(string { c }),
+                                     m >> (c - 'a') & 1);
+
+            sim.apply(pattern);
+            opt_sim.apply(pattern);
+
+            for (WireId wire_id : observed)
+                assert(intr.get_wires().at(wire_id).state ==
+                       opt.get_wires().at(wire_id).state,
+                       "fused netlist differs on pattern %d", m);
+        }
+    }
+}
+
+int main() {
+    test_reduce();
+    test_fuse();
+}
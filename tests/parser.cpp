@@ -0,0 +1,201 @@
+#include "../include/parser.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../include/profile.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <rdesc/rdesc.h>
+
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::stringstream;
+using std::make_shared;
+
+
+/* loads with the reference parser, counting ignored statements */
+static size_t load_rdesc(Interpreter &intr, Lex &lex) {
+    size_t errors = 0;
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex.next()).id != TK_EOF) {
+        assert(tk.id != TK_NOTOKEN, "lexer error");
+
+        errors += intr.pump(tk) == RDESC_NOMATCH;
+    }
+
+    return errors;
+}
+
+static size_t load_direct(Interpreter &intr, Lex &lex) {
+    Parser parser { intr, lex };
+    size_t errors = 0;
+
+    Parsed res;
+    while ((res = parser.next()) != Parsed::END) {
+        assert(res != Parsed::BAD_TOKEN, "lexer error");
+
+        errors += res == Parsed::NOMATCH;
+    }
+
+    return errors;
+}
+
+/* both parsers give the same netlist and the same number of errors */
+static void compare(const string &source) {
+    stringstream ss { source }, direct_ss { source };
+    Lex lex { ss }, direct_lex { direct_ss };
+
+    Interpreter intr { global_cfg()->new_parser() };
+    Interpreter direct { global_cfg()->new_parser() };
+
+    size_t errors = load_rdesc(intr, lex);
+    size_t direct_errors = load_direct(direct, direct_lex);
+
+    stringstream dump, direct_dump;
+    intr.dump(dump, lex);
+    direct.dump(direct_dump, direct_lex);
+
+    assert(errors == direct_errors,
+           "%zu syntax errors, but %zu with direct parser", errors,
+           direct_errors);
+    assert(dump.str() == direct_dump.str(),
+           "netlists differ:\n%s\n%s", dump.str().c_str(),
+           direct_dump.str().c_str());
+}
+
+/* both parsers reject the last statement with the same message */
+static void compare_error(const string &source) {
+    string messages[2];
+
+    for (int direct : { 0, 1 }) {
+        stringstream ss { source };
+        Lex lex { ss };
+        Interpreter intr { global_cfg()->new_parser() };
+
+        try {
+            direct ? load_direct(intr, lex) : load_rdesc(intr, lex);
+        } catch (std::exception &e) {
+            messages[direct] = e.what();
+        }
+    }
+
+    assert(!messages[0].empty() && messages[0] == messages[1],
+           "errors differ: '%s' and '%s'", messages[0].c_str(),
+           messages[1].c_str());
+}
+
+static string read(const char *path) {
+    std::ifstream file { path };
+    assert(file.good(), "could not open %s", path);
+
+    return string { std::istreambuf_iterator<char>(file), {} };
+}
+
+void test_designs() {
+    for (const char *kind : { "ripple", "cla", "mult", "dag", "pipeline" }) {
+        stringstream ss;
+        Generator { ss, 1 }.generate(kind, 64);
+
+        compare(ss.str());
+    }
+
+    compare(read("examples/gates.hdl"));
+    compare(read("tests/_interactive/inputs/interpreter"));
+}
+
+void test_errors() {
+    /* recovery after a syntax error, and comments */
+    compare("lut<1, 1> buf = (0b10); /* comment */"
+            "wire a = 0 wire b = 0;"
+            "wire c = 1 { x: [a, (1, 2); b], y: 3 };"
+            "wire e = 1 { y: 3, };"
+            "wire d = 1 { p: (1, 2), q: d }; ;;"
+            "unit<buf> u = (c) -> (d);"
+            "unit<buf> v = (c,) -> (d);"
+            "reg<1, 1> r = (1, 2) -> ;"
+            "lut<1, 2> two = (1, 2);");
+
+    /* an incomplete statement at the end is dropped */
+    compare("wire a = 0; wire b");
+
+    compare_error("lut<1, 2> buf = (0b10);");
+    compare_error("lut<1, 1> buf = (0b10); unit<buf> u = (a) -> (a);");
+    compare_error("wire a = 0; unit<buf> u = (a) -> (a);");
+    compare_error("lut<1, 1> buf = (0b10); wire a = 0;"
+                  "unit<buf> u = (a, a) -> (a);");
+    compare_error("lut<1, 1> buf = (0b10); wire a = 0;"
+                  "unit<buf> u = (a) -> (a, a);");
+
+    /* coordinates that do not fit, or read as an identifier */
+    compare_error("wire a = 0 { p: (4294967296, 1) };");
+    compare_error("wire a = 0 { p: [(1, 2), (4294967295, 0); (3, 4)] };");
+    compare_error("wire a = 0 { p: [(0, 4294967296)], q: 1 };");
+    compare("wire a = 0 { p: [(4294967294, 4294967295)] };");
+
+    stringstream ss { "wire a = 0; wire 0b2 = 1;" };
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+    Parser parser { intr, lex };
+
+    assert(parser.next() == Parsed::READY &&
+           parser.next() == Parsed::BAD_TOKEN,
+           "lexer error is not reported");
+}
+
+void test_metadata() {
+    string source = read("examples/gates.hdl");
+
+    stringstream ss { source }, direct_ss { source };
+    auto lex = make_shared<Lex>(ss);
+    auto direct_lex = make_shared<Lex>(direct_ss);
+
+    Interpreter intr { global_cfg()->new_parser() };
+    Interpreter direct { global_cfg()->new_parser() };
+
+    intr.strip_metadata(lex);
+    direct.strip_metadata(direct_lex);
+
+    load_rdesc(intr, *lex);
+    load_direct(direct, *direct_lex);
+
+    stringstream dump, direct_dump;
+    intr.dump(dump, *lex);
+    direct.dump(direct_dump, *direct_lex);
+
+    assert(dump.str() == direct_dump.str(),
+           "netlists differ:\n%s\n%s", dump.str().c_str(),
+           direct_dump.str().c_str());
+}
+
+/* lexing is timed apart from parsing */
+void test_profile() {
+    stringstream ss { read("examples/gates.hdl") };
+    Lex lex { ss };
+
+    Interpreter intr { global_cfg()->new_parser() };
+    Profile profile;
+    intr.set_profile(&profile);
+
+    load_direct(intr, lex);
+
+    auto time = [&](Phase phase) {
+        return profile.phase_time[static_cast<size_t>(phase)].count();
+    };
+
+    assert(time(Phase::LEX) > 0 && time(Phase::PARSE) > 0,
+           "lexing or parsing is not timed");
+}
+
+int main() {
+    test_designs();
+    test_errors();
+    test_metadata();
+    test_profile();
+}
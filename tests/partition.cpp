@@ -0,0 +1,152 @@
+#include "../include/drivers.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/partition.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <cstddef>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+static void test_partition(const Interpreter &intr, size_t k) {
+    auto &units = intr.get_units();
+    Partition partition { intr.get_wires(), units, k };
+
+    assert(partition.size() == k, "%zu parts instead of %zu",
+           partition.size(), k);
+
+    vector<size_t> sizes(k);
+    for (auto &[id, _] : units)
+        sizes[partition.part_of(id)]++;
+
+    size_t total = 0;
+    for (size_t p = 0; p < k; p++) {
+        assert(sizes[p] == partition.part_sizes()[p], "part %zu miscounted", p);
+        assert(sizes[p] * k <= units.size() * (1 + Partition::IMBALANCE) + k,
+               "part %zu is too large", p);
+        total += sizes[p];
+    }
+
+    assert(total == units.size(), "units are left out");
+
+    /* wires driven in a part and read or driven in another */
+    std::set<WireId> cut;
+    for (auto &[id, unit] : units) {
+        for (WireId out : unit.output_wires) {
+            size_t part = partition.part_of(id);
+
+            for (UnitId reader : intr.get_wires().at(out).affects)
+                if (partition.part_of(reader) != part)
+                    cut.insert(out);
+
+            for (auto &port : intr.drivers().of(out))
+                if (partition.part_of(port.unit) != part)
+                    cut.insert(out);
+        }
+    }
+
+    assert(vector<WireId>(cut.begin(), cut.end()) == partition.cut(),
+           "cut differs");
+
+    try {
+        partition.part_of(units.rbegin()->first + 1);
+        assert(false, "unknown unit has a part");
+    } catch (std::out_of_range &) {}
+}
+
+/* processes end every pattern in the states of a single simulation, once
+ * units agree with their inputs, returns changes sent between them */
+static size_t test_parallel(const string &source, size_t k, bool settle) {
+    Interpreter a { global_cfg()->new_parser() };
+    Interpreter b { global_cfg()->new_parser() };
+    load(a, source);
+    load(b, source);
+
+    if (settle) {
+        Simulation { a }.run_cycles(0);
+        Simulation { b }.run_cycles(0);
+    }
+
+    Simulation sim { a };
+    Partition partition { b.get_wires(), b.get_units(), k };
+    ParallelSim parallel { b, partition };
+
+    auto inputs = undriven(a);
+    std::mt19937 rng { 3 };
+    size_t messages = 0;
+
+    for (size_t round = 0; round < 4; round++) {
+        vector<Pattern> patterns(round + 1);
+
+        for (auto &pattern : patterns)
+            for (size_t i = 0; i < 4; i++)
+                pattern.emplace_back(inputs[rng() % inputs.size()], rng() & 1);
+
+        for (auto &pattern : patterns)
+            sim.apply(pattern);
+
+        parallel.run(patterns);
+        messages += parallel.message_count();
+
+        auto it = b.get_wires().begin();
+        for (auto &[id, wire] : a.get_wires())
+            assert(wire.state == (it++)->second.state,
+                   "wire %zu differs after round %zu", id, round);
+    }
+
+    return messages;
+}
+
+int main() {
+    for (const char *kind : { "ripple", "cla", "mult", "dag", "chain",
+                              "fanout", "latch", "pipeline" }) {
+        string name = kind;
+        stringstream design;
+        Generator { design, 2 }.generate(kind, name == "mult" ? 8 :
+                                               name == "dag" ? 2000 : 64);
+
+        Interpreter intr { global_cfg()->new_parser() };
+        load(intr, design.str());
+
+        for (size_t k : { 1, 2, 3, 4 }) {
+            test_partition(intr, k);
+            /* latches agree with their inputs, but are loops */
+            size_t messages = test_parallel(design.str(), k, name != "latch");
+
+            /* products depend on every input */
+            assert(name != "mult" || (k == 1) == (messages == 0),
+                   "%zu changes crossed %zu parts", messages, k);
+        }
+    }
+
+    stringstream design;
+    Generator { design, 2 }.generate("ripple", 8);
+
+    Interpreter intr { global_cfg()->new_parser() };
+    load(intr, design.str());
+
+    for (size_t k : { 0, 65 }) {
+        try {
+            Partition { intr.get_wires(), intr.get_units(), k };
+            assert(false, "%zu parts are allowed", k);
+        } catch (std::invalid_argument &) {}
+    }
+
+    Partition partition { intr.get_wires(), intr.get_units(), 2 };
+    ParallelSim parallel { intr, partition };
+
+    try {
+        parallel.run(vector<Pattern> { { { 1000, true } } });
+        assert(false, "unknown wire is applied");
+    } catch (std::out_of_range &) {}
+}
@@ -0,0 +1,174 @@
+#include "../include/fault.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/partition.hpp"
+#include "../include/placement.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <sched.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+void test_cpu_list() {
+    assert(parse_cpu_list("0-3,8\n") == (vector<int> { 0, 1, 2, 3, 8 }),
+           "ranges are not expanded");
+    assert(parse_cpu_list("").empty(), "empty list has processors");
+
+    for (const char *list : { "3-1", "a", "1,,2", "1-", "-1", "2;3" }) {
+        try {
+            parse_cpu_list(list);
+            assert(false, "malformed list %s is parsed", list);
+        } catch (std::invalid_argument &) {}
+    }
+}
+
+void test_policies() {
+    Topology two { { { 0, 1 }, {}, { 2, 3 } } };
+
+    assert(two.nodes.size() == 2, "node without processors is kept");
+
+    vector<int> compact, scatter;
+    for (size_t worker = 0; worker < 5; worker++) {
+        compact.push_back(two.cpu_for(worker, Pinning::COMPACT));
+        scatter.push_back(two.cpu_for(worker, Pinning::SCATTER));
+
+        assert(two.cpu_for(worker, Pinning::NONE) == -1,
+               "worker %zu is pinned", worker);
+    }
+
+    assert(compact == (vector<int> { 0, 1, 2, 3, 0 }),
+           "compact workers are not packed");
+    assert(scatter == (vector<int> { 0, 2, 1, 3, 0 }),
+           "scattered workers do not alternate nodes");
+
+    assert(two.node_of(3) == 1 && two.node_of(9) == -1, "wrong node");
+
+    try {
+        Topology { { {} } };
+        assert(false, "topology without processors");
+    } catch (std::invalid_argument &) {}
+
+    /* processors of this machine are the ones it may run on */
+    Topology here;
+    int cpu = here.cpu_for(0, Pinning::COMPACT);
+
+    assert(!here.nodes.empty() && cpu >= 0, "no processor here");
+
+    cpu_set_t before;
+    sched_getaffinity(0, sizeof(before), &before);
+
+    {
+        ScopedPin pin { cpu };
+
+        assert(pin.pinned() && sched_getcpu() == cpu,
+               "not running on processor %d", cpu);
+    }
+
+    cpu_set_t after;
+    sched_getaffinity(0, sizeof(after), &after);
+    assert(CPU_EQUAL(&before, &after), "affinity is not restored");
+
+    assert(!ScopedPin { -1 }.pinned(), "pinned to no processor");
+}
+
+void test_allocator() {
+    for (auto mode : { HugePages::NONE, HugePages::TRANSPARENT,
+                       HugePages::EXPLICIT }) {
+        set_huge_pages(mode);
+
+        StateVector<uint64_t> large(3 * HUGE_PAGE_SIZE / 8 + 1);
+        StateVector<uint8_t> small(100, 1);
+
+        size_t offset = reinterpret_cast<uintptr_t>(large.data()) %
+            HUGE_PAGE_SIZE;
+
+        assert(offset == 0, "large array is not aligned to huge pages");
+
+        for (size_t i = 0; i < large.size(); i++)
+            large[i] = i;
+
+        large.resize(large.size() * 2, 7);
+
+        for (size_t i = 0; i < large.size() / 2; i++)
+            assert(large[i] == i, "element %zu is lost", i);
+
+        assert(large.back() == 7 && small[99] == 1, "arrays are not filled");
+    }
+
+    set_huge_pages(HugePages::TRANSPARENT);
+}
+
+/* pinned workers find what unpinned ones do */
+void test_workers() {
+    stringstream design;
+    Generator { design, 4 }.generate("cla", 16);
+
+    Interpreter a { global_cfg()->new_parser() };
+    Interpreter b { global_cfg()->new_parser() };
+    load(a, design.str());
+    load(b, design.str());
+
+    Simulation { a }.run_cycles(0);
+    Simulation { b }.run_cycles(0);
+
+    auto inputs = undriven(a);
+
+    vector<Pattern> patterns(8);
+    for (size_t i = 0; i < patterns.size(); i++)
+        for (size_t j = 0; j < inputs.size(); j++)
+            patterns[i].emplace_back(inputs[j], (i * 7 + j) % 3 == 0);
+
+    Simulation sim { a };
+    for (auto &pattern : patterns)
+        sim.apply(pattern);
+
+    Partition partition { b.get_wires(), b.get_units(), 3 };
+    ParallelSim parallel { b, partition };
+    parallel.set_pinning(Pinning::SCATTER);
+    parallel.run(patterns);
+
+    auto it = b.get_wires().begin();
+    for (auto &[id, wire] : a.get_wires())
+        assert(wire.state == (it++)->second.state, "wire %zu differs", id);
+
+    assert(parallel.evaluation_count() > 0, "parts evaluate nothing");
+
+    /* where the kernel lists pages by node */
+    if (std::ifstream { "/proc/self/numa_maps" }.good()) {
+        size_t total = 0;
+        for (size_t bytes : parallel.memory().node_bytes)
+            total += bytes;
+
+        assert(total > 0, "parts have no memory");
+        assert(!MemoryReport::of_self().node_bytes.empty(),
+               "no memory on any node");
+    }
+
+    FaultSim plain { a }, pinned { a };
+    pinned.set_pinning(Pinning::COMPACT);
+
+    auto expected = plain.run(patterns, 2);
+    auto report = pinned.run(patterns, 2);
+
+    assert(report.detected == expected.detected,
+           "pinned threads detect other faults");
+}
+
+int main() {
+    test_cpu_list();
+    test_policies();
+    test_allocator();
+    test_workers();
+}
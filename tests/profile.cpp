@@ -0,0 +1,80 @@
+#include "../include/interpreter.hpp"
+#include "../include/profile.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <rdesc/rdesc.h>
+
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::stringstream;
+
+
+int main() {
+    stringstream ss;
+    ss << "lut<1, 1> not1 = (0b01);"
+        "lut<2, 1> and2 = (0b1000);"
+
+        "wire a = 0; wire b = 0;"
+        "wire na = 1; wire y = 0;"
+
+        /* y = a & ~a, glitches when a rises */
+        "unit<and2> g = (a, na) -> (y);"
+        "unit<not1> inv = (a) -> (na);"
+        "unit<and2> h = (b, a) -> (b);";
+
+    Lex lex { ss };
+    Interpreter intr { global_cfg()->new_parser() };
+
+    Profile profile;
+    intr.set_profile(&profile);
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex.next()).id != TK_EOF)
+        assert(intr.pump(tk) != RDESC_NOMATCH,
+               "syntax error");
+
+    assert(profile.phase_time[static_cast<size_t>(Phase::PARSE)].count() > 0,
+           "parsing is not timed");
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    Simulation sim { intr };
+    sim.set_profile(&profile);
+
+    sim.apply({ { id("a"), 1 } });
+
+    assert(profile.stabilizations == 1 && profile.generations == 3 &&
+           profile.max_generations == 3,
+           "unexpected generations");
+
+    /* g, inv and h in first generation, g again after na falls */
+    assert(profile.evaluations == 4 && profile.redundant_evaluations == 1,
+           "unexpected evaluations: %lu, %lu", profile.evaluations,
+           profile.redundant_evaluations);
+
+    assert(profile.unit_evaluations[id("g")] == 2 &&
+           profile.lut_evaluations[id("and2")] == 3,
+           "unexpected evaluation counts");
+
+    /* a, na and y twice */
+    assert(profile.toggles == 4 && profile.wire_toggles[id("y")] == 2,
+           "unexpected toggles");
+
+    sim.set_profile(nullptr);
+    sim.apply({ { id("a"), 0 } });
+
+    assert(profile.stabilizations == 1, "detached profile is counted");
+
+    stringstream report;
+    profile.report(report, lex, 1);
+
+    string res = report.str();
+    assert(res.find("hottest wires, by toggles\n           2  y\n") !=
+           string::npos, "unexpected report:\n%s", res.c_str());
+    string redundant = "redundant, 25.00%";
+    assert(res.find(redundant) != string::npos,
+           "unexpected report:\n%s", res.c_str());
+}
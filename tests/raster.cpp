@@ -0,0 +1,206 @@
+#include "../include/raster.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using std::vector;
+
+
+const uint32_t WHITE = 0xffffff;
+const uint32_t GREEN = 0x00ff00;
+const uint32_t BLACK = 0x000000;
+
+/* pixels of a frame, with `pad` pixels past every row */
+struct Frame {
+    Frame(int width_, int height_, int pad = 0)
+        : width { width_ }, height { height_ }, stride { size_t(width_ + pad) },
+          pixels(stride * height_, 0xdeadbeef) {}
+
+    uint32_t at(int x, int y) const
+        { return pixels[y * stride + x]; }
+
+    size_t count(uint32_t color) const {
+        size_t res = 0;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                res += at(x, y) == color;
+
+        return res;
+    }
+
+    int width, height;
+    size_t stride;
+    vector<uint32_t> pixels;
+};
+
+/* distance of a point to the segment of a capsule */
+static float distance(const Capsule &c, float x, float y) {
+    float dx = c.x1 - c.x0, dy = c.y1 - c.y0;
+    float length2 = dx * dx + dy * dy;
+    float t = length2 ? ((x - c.x0) * dx + (y - c.y0) * dy) / length2 : 0;
+
+    t = std::clamp(t, 0.f, 1.f);
+
+    return std::hypot(x - c.x0 - t * dx, y - c.y0 - t * dy);
+}
+
+void test_shapes() {
+    Raster raster { 1 };
+    Frame frame { 100, 50 };
+
+    raster.begin(frame.pixels.data(), frame.width, frame.height, frame.stride,
+                 WHITE);
+    raster.capsule(10, 10.5, 30, 10.5, 2, GREEN);
+    raster.capsule(70, 30, 70, 30, 10, BLACK);
+    raster.end();
+
+    /* rows 8 to 12 are within 2 of the line, from 8 to 31 with caps */
+    for (int y = 8; y <= 12; y++)
+        for (int x = 10; x <= 29; x++)
+            assert(frame.at(x, y) == GREEN, "%d, %d is not drawn", x, y);
+
+    assert(frame.at(8, 10) == GREEN && frame.at(31, 10) == GREEN,
+           "round caps are missing");
+    assert(frame.at(7, 10) == WHITE && frame.at(32, 10) == WHITE,
+           "line is too long");
+    assert(frame.at(20, 7) == WHITE && frame.at(20, 13) == WHITE,
+           "line is too thick");
+
+    /* a disk of radius 10 covers about 314 pixels */
+    size_t disk = frame.count(BLACK);
+    double area = M_PI * 10 * 10;
+    assert(std::abs(double(disk) - area) < 15, "disk has %zu pixels", disk);
+    assert(frame.at(70, 30) == BLACK && frame.at(70, 19) == WHITE,
+           "disk is misplaced");
+
+    assert(frame.count(WHITE) + frame.count(GREEN) + disk ==
+           size_t(frame.width * frame.height), "frame is not cleared");
+}
+
+void test_diagonal() {
+    Raster raster { 1 };
+    Frame frame { 64, 64 };
+
+    raster.begin(frame.pixels.data(), frame.width, frame.height, frame.stride,
+                 WHITE);
+    raster.capsule(0, 0, 64, 64, 1, BLACK);
+    raster.end();
+
+    /* pixels along the diagonal, not the ones far from it */
+    for (int i = 0; i < 64; i++) {
+        assert(frame.at(i, i) == BLACK, "%d, %d is not on the line", i, i);
+
+        if (i + 3 < 64)
+            assert(frame.at(i + 3, i) == WHITE, "%d, %d is drawn", i + 3, i);
+    }
+}
+
+void test_order() {
+    Raster raster { 1 };
+    Frame frame { 200, 200 };
+
+    /* later capsules paint over earlier ones, across tile edges too */
+    raster.begin(frame.pixels.data(), frame.width, frame.height, frame.stride,
+                 WHITE);
+    raster.capsule(0, 64, 200, 64, 5, BLACK);
+    raster.capsule(64, 0, 64, 200, 5, GREEN);
+    raster.end();
+
+    assert(frame.at(64, 64) == GREEN && frame.at(63, 63) == GREEN,
+           "later capsule is drawn below");
+    assert(frame.at(100, 64) == BLACK, "earlier capsule is lost");
+
+    assert(raster.capsule_count() == 2, "capsules are lost");
+}
+
+void test_clipping() {
+    Raster raster { 1 };
+    Frame frame { 70, 70, 6 };
+
+    /* outside, partly outside, and around the whole frame */
+    raster.begin(frame.pixels.data(), frame.width, frame.height, frame.stride,
+                 WHITE);
+    raster.capsule(-100, -100, -50, -40, 3, BLACK);
+    raster.capsule(-1e9, 35, 1e9, 35, 0.5, BLACK);
+    raster.capsule(60, 60, 500, 900, 20, GREEN);
+    raster.capsule(1000, 1000, 2000, 2000, 4, BLACK);
+    raster.end();
+
+    for (int x = 0; x < frame.width; x++)
+        assert(frame.at(x, 35) == BLACK || frame.at(x, 35) == GREEN,
+               "%d, 35 is not drawn", x);
+
+    assert(frame.at(69, 69) == GREEN, "partly visible capsule is not drawn");
+
+    for (int y = 0; y < frame.height; y++)
+        for (int x = frame.width; x < int(frame.stride); x++)
+            assert(frame.at(x, y) == 0xdeadbeef, "padding %d, %d is drawn",
+                   x, y);
+
+    /* an empty frame draws nothing */
+    raster.begin(nullptr, 0, 0, 0, WHITE);
+    raster.capsule(0, 0, 10, 10, 1, BLACK);
+    raster.end();
+}
+
+/* threads draw the same pixels as a single one */
+void test_threads() {
+    std::mt19937 rng { 7 };
+    std::uniform_real_distribution<float> pos { -50, 650 };
+    std::uniform_real_distribution<float> radius { 0, 8 };
+
+    vector<Capsule> capsules;
+    for (size_t i = 0; i < 2000; i++)
+        capsules.push_back(Capsule { pos(rng), pos(rng), pos(rng), pos(rng),
+                                     radius(rng), uint32_t(rng()) });
+
+    vector<Frame> frames;
+    for (size_t threads : { 1, 4, 16 }) {
+        Raster raster { threads };
+        Frame &frame = frames.emplace_back(600, 500, 3);
+
+        raster.begin(frame.pixels.data(), frame.width, frame.height,
+                     frame.stride, WHITE);
+        for (auto &c : capsules)
+            raster.capsule(c.x0, c.y0, c.x1, c.y1, c.radius, c.color);
+        raster.end();
+    }
+
+    for (size_t i = 1; i < frames.size(); i++)
+        assert(frames[i].pixels == frames[0].pixels,
+               "frame %zu differs from a single thread", i);
+
+    /* a pixel has the color of the last capsule within reach of its center,
+     * unless one is too close to tell */
+    for (size_t sample = 0; sample < 5000; sample++) {
+        int x = rng() % 600, y = rng() % 500;
+        uint32_t expected = WHITE;
+        bool edge = false;
+
+        for (auto &c : capsules) {
+            float d = distance(c, x + 0.5f, y + 0.5f) - c.radius;
+
+            if (std::abs(d) < 1e-3)
+                edge = true;
+            else if (d < 0)
+                expected = c.color, edge = false;
+        }
+
+        if (!edge)
+            assert(frames[0].at(x, y) == expected, "%d, %d has another color",
+                   x, y);
+    }
+}
+
+int main() {
+    test_shapes();
+    test_diagonal();
+    test_order();
+    test_clipping();
+    test_threads();
+}
@@ -0,0 +1,111 @@
+#include "../include/reload.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/lex.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+
+#include <rdesc/rdesc.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using std::string;
+using std::stringstream;
+using std::ofstream, std::ifstream;
+using std::make_shared;
+
+
+void write_file(const string &path, const char *content) {
+    ofstream file { path };
+    file << content;
+}
+
+string dump(const Interpreter &intr, const Lex &lex) {
+    stringstream ss;
+    intr.dump(ss, lex);
+
+    return ss.str();
+}
+
+int main() {
+    string path = "target/reload.test.hdl";
+
+    write_file(path,
+        "lut<2, 1> gate = (0b1000);\n"
+        "wire a = 1; wire b = 0; wire c = 0;\n"
+        "unit<gate> u = (a, b) -> (c);\n");
+
+    ifstream file { path };
+    auto lex = make_shared<Lex>(file);
+    auto intr = make_shared<Interpreter>(global_cfg()->new_parser());
+
+    struct rdesc_cfg_token tk;
+    while ((tk = lex->next()).id != TK_EOF)
+        assert(intr->pump(tk) != RDESC_NOMATCH,
+               "syntax error");
+
+    Simulation sim { *intr };
+    HotReload reload { path, intr, lex };
+
+    /* lut is replaced, unit and its output are kept */
+    write_file(path,
+        "lut<2, 1> gate = (0b1110);\n"
+        "wire a = 1; wire b = 0; wire c = 0;\n"
+        "unit<gate> u = (a, b) -> (c);\n");
+
+    assert(reload.reload(sim), "could not reload");
+    sim.stabilize();
+
+    auto patched = dump(*intr, *lex);
+    assert(patched.find("(0b1110)") != string::npos, "lut is not replaced");
+    assert(patched.find("wire c /*w4*/ = 1") != string::npos,
+           "affected cone is not re-evaluated");
+
+    /* unit refers to an unknown wire, netlist should be kept */
+    write_file(path,
+        "lut<2, 1> gate = (0b1110);\n"
+        "wire a = 1; wire b = 0;\n"
+        "unit<gate> u = (a, b) -> (c);\n");
+
+    assert(!reload.reload(sim), "invalid netlist is reloaded");
+    assert(dump(*intr, *lex) == patched, "netlist is not rolled back");
+
+    /* lut size no longer matches an unchanged unit */
+    write_file(path,
+        "lut<1, 1> gate = (0b01);\n"
+        "wire a = 1; wire b = 0; wire c = 1;\n"
+        "unit<gate> u = (a, b) -> (c);\n");
+
+    assert(!reload.reload(sim), "invalid netlist is reloaded");
+    assert(dump(*intr, *lex) == patched, "netlist is not rolled back");
+
+    /* unit is replaced, its new input is re-evaluated */
+    write_file(path,
+        "lut<2, 1> gate = (0b1110);\n"
+        "wire a = 1; wire b = 0; wire c = 1;\n"
+        "wire d = 0;\n"
+        "unit<gate> u = (b, d) -> (c);\n");
+
+    assert(reload.reload(sim), "could not reload");
+    sim.stabilize();
+
+    assert(dump(*intr, *lex).find("wire c /*w4*/ = 0") != string::npos,
+           "replaced unit is not re-evaluated");
+
+    /* only metadata of an output changes, its driver is re-evaluated */
+    write_file(path,
+        "lut<2, 1> gate = (0b1110);\n"
+        "wire a = 1; wire b = 0; wire c = 1 { _path: [(1, 2), (3, 4)] };\n"
+        "wire d = 0;\n"
+        "unit<gate> u = (b, d) -> (c);\n");
+
+    assert(reload.reload(sim), "could not reload");
+    sim.stabilize();
+
+    assert(dump(*intr, *lex).find("wire c /*w4*/ = 0") != string::npos,
+           "driver of a replaced wire is not re-evaluated");
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,132 @@
+#include "../include/checkpoint.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/profile.hpp"
+#include "../include/renumber.hpp"
+#include "../bench/generator.hpp"
+#include "../src/detail.h"  // IWYU pragma: keep
+#include "../src/testing.h"
+
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+
+static void test_numbering(const Interpreter &intr) {
+    auto &wires = intr.get_wires();
+    auto &units = intr.get_units();
+    Renumbering bfs { wires, units };
+
+    assert(bfs.wire_ids.size() == wires.size() &&
+           bfs.unit_ids.size() == units.size(),
+           "numbering misses objects");
+
+    for (size_t i = 0; i < bfs.wire_ids.size(); i++)
+        assert(bfs.wire(bfs.wire_ids[i]) == i, "wire %zu maps back wrong", i);
+    for (size_t i = 0; i < bfs.unit_ids.size(); i++)
+        assert(bfs.unit(bfs.unit_ids[i]) == i, "unit %zu maps back wrong", i);
+
+    assert(bfs.wire(wires.rbegin()->first + 1) == Renumbering::NONE,
+           "unknown wire is numbered");
+
+    /* undriven wires are where the search starts */
+    auto inputs = undriven(intr);
+    for (size_t i = 0; i < inputs.size(); i++)
+        assert(bfs.wire_ids[i] == inputs[i], "input %zu is not first", i);
+
+    /* units reading the first input come first */
+    size_t reader = 0;
+    for (UnitId id : wires.at(inputs[0]).affects)
+        assert(bfs.unit(id) == reader++, "unit %zu is not first", id);
+
+    Renumbering plain { wires, units, false };
+    size_t i = 0;
+    for (auto &[id, _] : wires)
+        assert(plain.wire_ids[i++] == id, "identifier order differs");
+}
+
+/* renumbered engines end in the same states as engines in identifier
+ * order and as one counting into a profile, also once states are written by
+ * cycles and checkpoints */
+static void test_engines(const string &source, bool clocked) {
+    Interpreter a { global_cfg()->new_parser() };
+    Interpreter b { global_cfg()->new_parser() };
+    Interpreter c { global_cfg()->new_parser() };
+    load(a, source);
+    load(b, source);
+    load(c, source);
+
+    Simulation sim_a { a }, sim_b { b }, sim_c { c };
+    sim_b.set_renumbering(false);
+
+    Profile profile;
+    sim_c.set_profile(&profile);
+
+    auto inputs = undriven(a);
+    std::mt19937 rng { 5 };
+
+    auto round = [&]() {
+        vector<Stimulus> stimuli;
+        for (size_t i = 0; i < 4; i++)
+            stimuli.emplace_back(inputs[rng() % inputs.size()], rng() & 1);
+
+        auto changed = sim_c.apply(stimuli);
+
+        assert(sim_a.apply(stimuli) == changed &&
+               sim_b.apply(stimuli) == changed,
+               "compiled simulation changes other wires");
+    };
+
+    for (size_t i = 0; i < 16; i++)
+        round();
+
+    Checkpoint before = sim_a.checkpoint();
+
+    if (clocked) {
+        sim_a.run_cycles(5);
+        sim_b.run_cycles(5);
+        sim_c.run_cycles(5);
+    }
+
+    for (size_t i = 0; i < 16; i++)
+        round();
+
+    sim_a.restore(before);
+    sim_b.restore(sim_b.checkpoint());
+    sim_b.restore(before);
+    sim_c.restore(before);
+
+    for (size_t i = 0; i < 16; i++)
+        round();
+
+    auto it_b = b.get_wires().begin(), it_c = c.get_wires().begin();
+    for (auto &[id, wire] : a.get_wires())
+        assert(wire.state == (it_b++)->second.state &&
+               wire.state == (it_c++)->second.state, "wire %zu differs", id);
+
+    assert(sim_a.evaluation_count() == sim_b.evaluation_count() &&
+           sim_a.evaluation_count() == sim_c.evaluation_count(),
+           "evaluation counts differ");
+}
+
+int main() {
+    for (const char *kind : { "ripple", "cla", "dag", "fanout" }) {
+        stringstream design;
+        Generator { design, 2 }.generate(kind, 64);
+
+        Interpreter intr { global_cfg()->new_parser() };
+        load(intr, design.str());
+
+        test_numbering(intr);
+        test_engines(design.str(), false);
+    }
+
+    stringstream pipeline;
+    Generator { pipeline, 2 }.generate("pipeline", 8);
+    test_engines(pipeline.str(), true);
+}
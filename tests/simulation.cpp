@@ -5,10 +5,12 @@
 
 #include <rdesc/rdesc.h>
 
+#include <set>
 #include <sstream>
 #include <string>
 #include <utility>
 
+using std::set;
 using std::string;
 using std::stringstream;
 
@@ -53,4 +55,19 @@ int main() {
 
     sim.set_wire_state(10, 1);
     sim.stabilize();
+
+    auto id = [&](const char *name) { return lex.get_ident_id(name); };
+
+    auto changed = sim.apply({ { id("a1"), 0 }, { id("b1"), 0 } });
+    assert((set<WireId> { changed.begin(), changed.end() } ==
+            set { id("a1"), id("b1"), id("d1"), id("d2") }),
+           "unexpected wires changed");
+
+    changed = sim.apply({ { id("c1"), 0 }, { id("c1"), 1 } });
+    assert(changed.size() == 0, "glitch reported as change");
+
+    changed = sim.apply({ { id("c1"), 0 } });
+    assert((set<WireId> { changed.begin(), changed.end() } ==
+            set { id("c1"), id("e2"), id("o") }),
+           "unexpected wires changed");
 }